@@ -120,40 +120,119 @@ static void config_verbose_printf( config_ref_t id, int level )
     }
 }
 
-static config_result_t load_config_file( config_ref_t id, const char *filename )
+/* set by "load --json" and "dump --json" */
+static int use_json = 0;
+
+/* Read all of filename ("-" for standard input) into a malloc()ed buffer. */
+static char *read_whole_file( const char *filename, size_t *len )
 {
-    int          retval = CONFIG_ERR_NO_RESOURCES;
-    FILE        *fp;
+    FILE                *fp = strcmp( filename, "-" ) ? fopen( filename, "rb" ) : stdin;
+    char                *data = NULL, *bigger;
+    size_t              size = 0, n;
 
-    if ( NULL != (fp = fopen(filename, "r")) )
+    *len = 0;
+    if ( NULL == fp )
     {
-        char            *txt;
-        long             txtlen;
-
-        fseek( fp, 0, SEEK_END );
-        txtlen = ftell(fp);
-        rewind(fp);
-        if ( NULL != (txt = malloc(txtlen+1)) )
+        printf("ERR: could not open \"%s\"\n", filename );
+        return NULL;
+    }
+    do
+    {
+        if ( *len == size )
         {
-            if ( txtlen == (long) fread( txt, 1, txtlen, fp ) )
+            size = size ? 2 * size : 65536;
+            if ( NULL == (bigger = realloc( data, size )) )
             {
-                /* add an (unnecessary) null term */
-                txt[txtlen] = '\0';
-
-                retval = config_load( id, txt, txtlen );
+                free( data );
+                data = NULL;
+                break;
             }
-
-            free(txt);
+            data = bigger;
         }
+        n = fread( data + *len, 1, size - *len, fp );
+        *len += n;
+    } while ( n > 0 );
 
-        fclose(fp);
+    if ( NULL == data || ferror( fp ) )
+    {
+        printf("ERR: could not read \"%s\"\n", filename );
+        free( data );
+        data = NULL;
     }
-    else
+    if ( stdin != fp )
+        fclose( fp );
+
+    return data;
+}
+
+static config_result_t load_json_file( config_ref_t id, const char *filename )
+{
+    config_result_t     retval = CONFIG_ERR_INVALID_REFERENCE;
+    char                *data;
+    size_t              len;
+
+    if ( NULL != (data = read_whole_file( filename, &len )) )
+    {
+        retval = config_load_json( id, data, len );
+        if ( CONFIG_SUCCESS != retval )
+            printf("ERR: \"%s\" is not a JSON object the database can hold\n", filename );
+        free( data );
+    }
+
+    return retval;
+}
+
+static config_result_t update_from_file( config_ref_t id, const char *filename )
+{
+    config_result_t     retval = CONFIG_ERR_INVALID_REFERENCE;
+    char                *data;
+    size_t              len;
+
+    if ( NULL != (data = read_whole_file( filename, &len )) )
+    {
+        retval = config_load_flat( id, data, len );
+        if ( CONFIG_SUCCESS != retval )
+            printf("ERR: could not apply the updates in \"%s\"\n", filename );
+        free( data );
+    }
+
+    return retval;
+}
+
+static config_result_t load_config_file( config_ref_t id, const char *filename )
+{
+    if ( use_json )
+        return load_json_file( id, filename );
+    return config_load_file( id, filename );
+}
+
+static config_result_t dump_json( config_ref_t id )
+{
+    config_result_t     retval;
+    char                *buf = NULL, *bigger;
+    size_t              size = 4096, len = 0;
+
+    /* grow the buffer to whatever the export reports it needs */
+    for ( ;; )
     {
-        printf("could not open file \"%s\"\n", filename );
+        if ( NULL == (bigger = realloc( buf, size )) )
+        {
+            retval = CONFIG_ERR_NO_RESOURCES;
+            break;
+        }
+        buf = bigger;
+        retval = config_export_json( id, buf, size, &len );
+        if ( CONFIG_ERR_NO_RESOURCES != retval || len <= size )
+            break;
+        size = len;
     }
+    if ( CONFIG_SUCCESS == retval )
+        printf( "%s\n", buf );
+    else
+        printf("ERR: could not export the database as JSON\n" );
+    free( buf );
 
-    return(retval);
+    return retval;
 }
 
 static config_result_t execute_config_commands( config_ref_t id )
@@ -240,13 +319,14 @@ static config_result_t execute_config_commands( config_ref_t id )
 
 static config_result_t memory_config( void )
 {
-    config_ref_t        node;
+    config_ref_t        layout, node;
     config_result_t     result;
+    long long           total;
 
-    result = config_node_find( ROOT_NODE, "platform.memory.layout", &node );
+    result = config_node_find( ROOT_NODE, "platform.memory.layout", &layout );
     if ( CONFIG_SUCCESS == result )
     {
-        result = config_node_first_child( node, &node );
+        result = config_node_first_child( layout, &node );
 
         if ( (CONFIG_SUCCESS == result) && node )
         {
@@ -282,6 +362,12 @@ static config_result_t memory_config( void )
             printf("ERR: \"platform.memory.layout\" has no entries\n" );
             result = CONFIG_ERR_NOT_FOUND;
         }
+
+        if ( CONFIG_SUCCESS == result &&
+             CONFIG_SUCCESS == config_aggregate( layout, "size", CONFIG_AGGREGATE_SUM, &total ) )
+        {
+            printf( "\t%20s: size %08llx\n", "total", (unsigned long long) total );
+        }
     }
     else
     {
@@ -291,6 +377,222 @@ static config_result_t memory_config( void )
     return( result );
 }
 
+static config_result_t index_stats( void )
+{
+    config_index_stats_t    stats;
+    config_result_t         result;
+    int                     i;
+
+    result = config_index_stats( &stats );
+    if ( CONFIG_SUCCESS == result )
+    {
+        printf( "\t%20s: %u\n", "buckets", stats.buckets );
+        printf( "\t%20s: %u\n", "entries", stats.entries );
+        printf( "\t%20s: %u.%02u\n", "load factor", stats.load_factor / 100, stats.load_factor % 100 );
+        printf( "\t%20s: %u\n", "tombstones", stats.tombstones );
+        printf( "\t%20s: %u\n", "max chain", stats.max_chain );
+        printf( "\t%20s: %u\n", "max probe", stats.max_probe );
+        printf( "\t%20s: %s\n", "rehashing", stats.rehashing ? "yes" : "no" );
+        printf( "\t%20s: %u (%u misses)\n", "lookups", stats.lookups, stats.misses );
+        printf( "\t%20s: %u\n", "rekeys", stats.rekeys );
+        printf( "\t%20s:", "chain histogram" );
+        for ( i = 0; i < CONFIG_INDEX_HISTOGRAM_SIZE; i++ )
+        {
+            printf( " [%d%s]=%u", i, (i == CONFIG_INDEX_HISTOGRAM_SIZE - 1) ? "+" : "", stats.chain_histogram[i] );
+        }
+        printf( "\n" );
+    }
+    else
+    {
+        printf("ERR: could not read index statistics\n" );
+    }
+
+    return( result );
+}
+
+static config_result_t overlay_config( int argc, const char *argv[] )
+{
+    config_ref_t            layer_ref;
+    config_result_t         result = CONFIG_ERR_NOT_FOUND;
+
+    if ( argc > 3 && ! strcmp( argv[2], "push" ) )
+    {
+        if ( CONFIG_SUCCESS != (result = config_overlay_push( argv[3], &layer_ref )) )
+            printf("ERR: could not push overlay layer \"%s\"\n", argv[3] );
+        else if ( argc > 4 )
+        {
+            printf("/* LOAD \"%s\" to overlay layer \"%s\"*/\n", argv[4], argv[3] );
+            result = load_config_file( layer_ref, argv[4] );
+        }
+    }
+    else if ( argc > 3 && ! strcmp( argv[2], "drop" ) )
+    {
+        if ( CONFIG_SUCCESS != (result = config_overlay_drop( argv[3] )) )
+            printf("ERR: no overlay layer \"%s\"\n", argv[3] );
+    }
+    else
+    {
+        printf("ERR: overlay needs \"push <name> [filename]\" or \"drop <name>\"\n" );
+    }
+
+    return( result );
+}
+
+static config_result_t journal_config( int argc, const char *argv[] )
+{
+    config_result_t         result = CONFIG_ERR_NOT_FOUND;
+    char                    *data = NULL, *bigger;
+    size_t                  size = 4096, len = 0;
+    FILE                    *fp;
+
+    if ( argc > 3 && ! strcmp( argv[2], "start" ) )
+    {
+        if ( CONFIG_SUCCESS != (result = config_journal_start( strtoul( argv[3], NULL, 0 ) )) )
+            printf("ERR: could not start a journal of %s bytes\n", argv[3] );
+    }
+    else if ( argc > 2 && ! strcmp( argv[2], "stop" ) )
+    {
+        result = config_journal_start( 0 );
+    }
+    else if ( argc > 3 && ! strcmp( argv[2], "save" ) )
+    {
+        /* grow the buffer to whatever the journal reports it needs */
+        for ( ;; )
+        {
+            if ( NULL == (bigger = realloc( data, size )) )
+            {
+                result = CONFIG_ERR_NO_RESOURCES;
+                break;
+            }
+            data = bigger;
+            result = config_journal_save( data, size, &len );
+            if ( CONFIG_ERR_NO_RESOURCES != result || len <= size )
+                break;
+            size = len;
+        }
+        if ( CONFIG_SUCCESS != result )
+            printf("ERR: could not save the journal (not started, or it overflowed)\n" );
+        else if ( NULL == (fp = fopen( argv[3], "wb" )) )
+        {
+            printf("ERR: could not open file \"%s\"\n", argv[3] );
+            result = CONFIG_ERR_NOT_FOUND;
+        }
+        else
+        {
+            if ( fwrite( data, 1, len, fp ) != len )
+                result = CONFIG_ERR_NO_RESOURCES;
+            if ( fclose( fp ) )
+                result = CONFIG_ERR_NO_RESOURCES;
+            if ( CONFIG_SUCCESS != result )
+                printf("ERR: could not write file \"%s\"\n", argv[3] );
+        }
+        free( data );
+    }
+    else if ( argc > 3 && ! strcmp( argv[2], "replay" ) )
+    {
+        if ( NULL != (data = read_whole_file( argv[3], &len )) )
+        {
+            if ( CONFIG_SUCCESS != (result = config_journal_replay( data, len )) )
+                printf("ERR: \"%s\" is not a valid journal\n", argv[3] );
+            free( data );
+        }
+    }
+    else
+    {
+        printf("ERR: journal needs \"start <size>\", \"stop\", \"save <filename>\" or \"replay <filename|->\"\n" );
+    }
+
+    return( result );
+}
+
+static config_result_t query_config( int argc, const char *argv[] )
+{
+    static const struct { const char *name; config_query_op_t op; } ops[] = {
+        { "==", CONFIG_QUERY_EQ }, { "!=", CONFIG_QUERY_NE }, { "<", CONFIG_QUERY_LT },
+        { "<=", CONFIG_QUERY_LE }, { ">", CONFIG_QUERY_GT }, { ">=", CONFIG_QUERY_GE },
+    };
+    config_query_result_t   results[64];
+    config_query_pred_t     pred;
+    config_result_t         result;
+    unsigned int            i, count;
+    char                    name[64];
+
+    memset( &pred, 0, sizeof(pred) );
+    if ( argc > 5 )
+    {
+        /* "." tests the matching node itself */
+        pred.key = strcmp( argv[3], "." ) ? argv[3] : NULL;
+        pred.value = strtol( argv[5], NULL, 0 );
+        for ( i = 0; i < sizeof(ops) / sizeof(ops[0]); i++ )
+            if ( ! strcmp( argv[4], ops[i].name ) )
+                pred.op = ops[i].op;
+        if ( CONFIG_QUERY_ANY == pred.op )
+        {
+            printf("ERR: unknown comparison \"%s\"\n", argv[4] );
+            return( CONFIG_ERR_NOT_FOUND );
+        }
+    }
+
+    result = config_query( ROOT_NODE, argv[2], &pred, results, sizeof(results) / sizeof(results[0]), &count );
+    if ( CONFIG_SUCCESS != result )
+    {
+        printf("ERR: could not run query \"%s\"\n", argv[2] );
+        return( result );
+    }
+
+    name[sizeof(name) - 1] = '\0';
+    for ( i = 0; i < count && i < sizeof(results) / sizeof(results[0]); i++ )
+    {
+        if ( CONFIG_SUCCESS != config_node_get_name( results[i].node_ref, name, sizeof(name) - 1 ) )
+            name[0] = '\0';
+        if ( results[i].has_value )
+            printf( "\t%20s: 0x%08x /* id %d */\n", name, results[i].value, results[i].node_ref );
+        else
+            printf( "\t%20s: /* id %d */\n", name, results[i].node_ref );
+    }
+    if ( count > i )
+        printf( "\t... %u more\n", count - i );
+
+    return( result );
+}
+
+static config_result_t dedup_config( const char *mode )
+{
+    config_dedup_stats_t    stats;
+    config_result_t         result = CONFIG_SUCCESS;
+
+    if ( NULL != mode )
+    {
+        if ( ! strcmp( mode, "on" ) )
+            result = config_dedup_enable( 1 );
+        else if ( ! strcmp( mode, "off" ) )
+            result = config_dedup_enable( 0 );
+        else
+        {
+            printf("ERR: dedup mode must be \"on\" or \"off\"\n" );
+            return( CONFIG_ERR_NOT_FOUND );
+        }
+    }
+
+    if ( CONFIG_SUCCESS == result )
+        result = config_dedup_stats( &stats );
+
+    if ( CONFIG_SUCCESS == result )
+    {
+        printf( "\t%20s: %s\n", "dedup", stats.enabled ? "on" : "off" );
+        printf( "\t%20s: %u\n", "shared subtrees", stats.canonical );
+        printf( "\t%20s: %u\n", "aliases", stats.aliases );
+        printf( "\t%20s: %u\n", "nodes saved", stats.nodes_saved );
+        printf( "\t%20s: %u\n", "copy-on-write splits", stats.copies );
+    }
+    else
+    {
+        printf("ERR: could not access deduplication state\n" );
+    }
+
+    return( result );
+}
+
 int main( int argc, const char *argv[] )
 {
     int                 err = 0,print_help = 0;
@@ -301,15 +603,31 @@ int main( int argc, const char *argv[] )
 
         base_id = ROOT_NODE;
 
+        if ( argc > 2 && ! strcmp( argv[2], "--json" ) &&
+             ( ! strcmp( argv[1], "load" ) || ! strcmp( argv[1], "dump" ) || ! strcmp( argv[1], "reload" ) ) )
+        {
+            /* drop the option so the commands below see their usual arguments */
+            use_json = 1;
+            memmove( &argv[2], &argv[3], (argc - 2) * sizeof(argv[0]) );
+            argc--;
+        }
+
         if ( ! strcmp( argv[1], "dump" ) )        /* dump <location> */
         {
             if ( argc > 2 )
             {
                 if ( CONFIG_SUCCESS == config_node_find( base_id, argv[2], &base_id ) )
                 {
-                    printf("/* DUMP of config database location \"%s\"*/\n", argv[2] );
+                    if ( use_json )
+                    {
+                        err = ( CONFIG_SUCCESS != dump_json( base_id ) );
+                    }
+                    else
+                    {
+                        printf("/* DUMP of config database location \"%s\"*/\n", argv[2] );
 
-                    config_verbose_printf( base_id, 0 );
+                        config_verbose_printf( base_id, 0 );
+                    }
                 }
                 else
                 {
@@ -317,6 +635,10 @@ int main( int argc, const char *argv[] )
                     err = 1;
                 }
             }
+            else if ( use_json )
+            {
+                err = ( CONFIG_SUCCESS != dump_json( base_id ) );
+            }
             else
             {
                 config_verbose_printf( base_id, 0 );
@@ -370,6 +692,18 @@ int main( int argc, const char *argv[] )
                 print_help = 1;
             }
         }
+        else if ( ! strcmp( argv[1], "update" ) && argc > 2 )    /* update <filename|-> [location] */
+        {
+            if ( argc > 3 && CONFIG_SUCCESS != config_node_find( base_id, argv[3], &base_id ) )
+            {
+                printf("ERR: could not find config database location \"%s\"\n", argv[3] );
+                err = 1;
+            }
+            else if ( CONFIG_SUCCESS != update_from_file( base_id, argv[2] ) )
+            {
+                err = 1;
+            }
+        }
         else if ( ! strcmp( argv[1], "set_int" ) )    /* set_int <location> <value>*/
         {
            int   new_value = 0;
@@ -447,6 +781,58 @@ int main( int argc, const char *argv[] )
                 print_help = 1;
             }
         }
+        else if ( ! strcmp( argv[1], "move" ) && argc > 4 )    /* move <location> <new_parent_location|.> <new_name> */
+        {
+            config_ref_t    parent_id = base_id;
+
+            err = 1;    /* default err */
+
+            if ( CONFIG_SUCCESS != config_node_find( base_id, argv[2], &base_id ) )
+            {
+                printf("ERR: could not find config database location \"%s\"\n", argv[2] );
+            }
+            else if ( strcmp( argv[3], "." ) && CONFIG_SUCCESS != config_node_find( parent_id, argv[3], &parent_id ) )
+            {
+                printf("ERR: could not find config database location \"%s\"\n", argv[3] );
+            }
+            else if ( CONFIG_SUCCESS != config_node_move( base_id, parent_id, argv[4] ) )
+            {
+                printf("ERR: could not move \"%s\" to \"%s\"\n", argv[2], argv[4] );
+            }
+            else
+            {
+                err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "children" ) )    /* children [location|.] [first] [count] */
+        {
+            unsigned int    first = (argc > 3) ? strtoul( argv[3], NULL, 0 ) : 0;
+            unsigned int    total, i, n;
+            config_ref_t    child;
+            char            name[64];
+
+            err = 1;    /* default err */
+
+            if ( argc > 2 && strcmp( argv[2], "." ) && CONFIG_SUCCESS != config_node_find( base_id, argv[2], &base_id ) )
+            {
+                printf("ERR: could not find config database location \"%s\"\n", argv[2] );
+            }
+            else if ( CONFIG_SUCCESS == config_node_child_count( base_id, &total ) )
+            {
+                /* one page of the list, without stepping over the children before it */
+                n = (argc > 4) ? strtoul( argv[4], NULL, 0 ) : total;
+                for ( i = first; i < total && i - first < n; i++ )
+                {
+                    if ( CONFIG_SUCCESS != config_node_child_at( base_id, i, &child )
+                      || CONFIG_SUCCESS != config_node_get_name( child, name, sizeof(name) ) )
+                        break;
+                    name[sizeof(name) - 1] = '\0';
+                    printf( "%u %s\n", i, name );
+                }
+                printf( "%u of %u\n", (i > first) ? i - first : 0, total );
+                err = 0;
+            }
+        }
         else if ( ! strcmp( argv[1], "memory" ) )    /* memory */
         {
             err = 1;    /* default err */
@@ -456,6 +842,116 @@ int main( int argc, const char *argv[] )
                err = 0;
             }
         }
+        else if ( ! strcmp( argv[1], "overlay" ) )    /* overlay push <name> [filename] | overlay drop <name> */
+        {
+            err = 1;    /* default err */
+
+            if ( CONFIG_SUCCESS == overlay_config( argc, argv ) )
+            {
+               err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "journal" ) )    /* journal start <size> | stop | save <file> | replay <file|-> */
+        {
+            err = 1;    /* default err */
+
+            if ( CONFIG_SUCCESS == journal_config( argc, argv ) )
+            {
+               err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "hash" ) )    /* hash [location] */
+        {
+            unsigned long long  hash;
+
+            err = 1;    /* default err */
+
+            if ( argc > 2 && CONFIG_SUCCESS != config_node_find( base_id, argv[2], &base_id ) )
+            {
+                printf("ERR: could not find config database location \"%s\"\n", argv[2] );
+            }
+            else if ( CONFIG_SUCCESS == config_subtree_hash( base_id, &hash ) )
+            {
+                printf( "%016llx\n", hash );
+                err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "reload" ) && argc > 2 )    /* reload [--json] <filename|-> [location] */
+        {
+            config_ref_t    stage_id;
+
+            err = 1;    /* default err */
+
+            /* build the new content off to the side, then swap it in so readers never see it half loaded */
+            if ( argc > 3 && CONFIG_SUCCESS != config_node_find( base_id, argv[3], &base_id ) )
+            {
+                printf("ERR: could not find config database location \"%s\"\n", argv[3] );
+            }
+            else if ( CONFIG_SUCCESS != config_stage_prepare( &stage_id ) )
+            {
+                printf("ERR: could not prepare a tree to load into\n" );
+            }
+            else if ( CONFIG_SUCCESS != load_config_file( stage_id, argv[2] ) )
+            {
+                config_private_tree_remove( stage_id );
+            }
+            else if ( CONFIG_SUCCESS != config_stage_publish( base_id, stage_id ) )
+            {
+                printf("ERR: could not publish \"%s\"\n", argv[2] );
+                config_private_tree_remove( stage_id );
+            }
+            else
+            {
+                err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "layout_pa" ) && argc > 2 )    /* layout_pa <physical address> */
+        {
+            config_ref_t    entry;
+            unsigned long   offset;
+            char            name[64];
+
+            err = 1;    /* default err */
+
+            name[sizeof(name) - 1] = '\0';
+            if ( CONFIG_SUCCESS == config_layout_lookup_pa( strtoul( argv[2], NULL, 0 ), &entry, &offset ) &&
+                 CONFIG_SUCCESS == config_node_get_name( entry, name, sizeof(name) - 1 ) )
+            {
+                printf( "\t%20s: offset %08lx\n", name, offset );
+                err = 0;
+            }
+            else
+            {
+                printf("ERR: no memory layout entry contains \"%s\"\n", argv[2] );
+            }
+        }
+        else if ( ! strcmp( argv[1], "query" ) && argc > 2 )    /* query <pattern> [<key> <op> <value>] */
+        {
+            err = 1;    /* default err */
+
+            if ( CONFIG_SUCCESS == query_config( argc, argv ) )
+            {
+               err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "dedup" ) )    /* dedup <on|off> */
+        {
+            err = 1;    /* default err */
+
+            if ( CONFIG_SUCCESS == dedup_config( (argc > 2) ? argv[2] : NULL ) )
+            {
+               err = 0;
+            }
+        }
+        else if ( ! strcmp( argv[1], "indexstats" ) )    /* indexstats */
+        {
+            err = 1;    /* default err */
+
+            if ( CONFIG_SUCCESS == index_stats() )
+            {
+               err = 0;
+            }
+        }
         else
         {
             print_help = 1;
@@ -470,14 +966,28 @@ int main( int argc, const char *argv[] )
     {
         printf(
             "usage for %s:   <location> optional parameter (default root_node)\n"
-            "  %s load [filename] <location>\n"
-            "  %s dump <location>\n"
+            "  %s load [--json] [filename] <location>\n"
+            "  %s dump [--json] <location>\n"
+            "  %s reload [--json] <filename|-> [location]   (replace location's content in one step)\n"
+            "  %s update <filename|-> [location]   (lines of \"dotted.path = value\")\n"
             "  %s set_int <location> <int value>\n"
             "  %s execute [location]\n"
             "  %s remove [location]\n"
+            "  %s move <location> <new_parent_location|.> <new_name>\n"
+            "  %s children [location|.] [first] [count]\n"
             "  %s memshift [offset_in_MB]\n"
-            "  %s memory \n",
-            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+            "  %s memory \n"
+            "  %s indexstats \n"
+            "  %s dedup <on|off>\n"
+            "  %s overlay push <name> [filename]\n"
+            "  %s overlay drop <name>\n"
+            "  %s journal start <size> | journal stop\n"
+            "  %s journal save <filename> | journal replay <filename|->\n"
+            "  %s query <pattern> [<key> <op> <value>]\n"
+            "  %s layout_pa <physical address>\n"
+            "  %s hash [location]\n",
+            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0],
+            argv[0], argv[0]);
     }
 
     return( err );
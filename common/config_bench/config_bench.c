@@ -0,0 +1,959 @@
+/***********************************************************************
+  This file is provided under a dual BSD/LGPLv2.1 license.  When using
+  or redistributing this file, you may do so under either license.
+
+  LGPL LICENSE SUMMARY
+
+  Copyright(c) <2007-2012>. Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of version 2.1 of the GNU Lesser General Public
+  License as published by the Free Software Foundation.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA. The full GNU Lesser General Public License is included in this
+  distribution in the file called LICENSE.LGPL.
+
+  Contact Information:
+      Intel Corporation
+      2200 Mission College Blvd.
+      Santa Clara, CA  97052
+
+  BSD LICENSE
+
+  Copyright (c) <2007-2012>. Intel Corporation. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+    - Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+************************************************************************/
+
+/*-----------------------------------------------------------------------
+ Program Description:
+
+ config_bench times the platform configuration core.  It links the core
+ library directly instead of going through the driver, so the numbers are
+ the core's own and not those of the ioctl path.  Each benchmark is a
+ subcommand and prints one table; run it without arguments for the list.
+
+ The trees are generated: groups of BENCH_FANOUT leaves below "bench", with
+ short names ("g12", "p7") like those of the real driver trees.
+-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "platform_config.h"
+
+#ifdef VER
+const char *config_bench_version_string = "#@# config_bench " VER;
+#endif
+
+/* Leaves per group in a generated tree */
+#define BENCH_FANOUT        100
+
+/* Lookups timed per measurement, and distinct paths they cycle through */
+#define BENCH_LOOKUPS       200000
+#define BENCH_SAMPLES       65536
+
+#define BENCH_PATH_LEN      48
+
+/* Groups below "stress" that the stress benchmark removes and reloads, and readers it runs */
+#define BENCH_STRESS_GROUPS     16
+#define BENCH_STRESS_READERS    4
+#define BENCH_STRESS_LEAVES     8
+
+/* Tree sizes the scaling benchmarks run through */
+static const unsigned int bench_sizes[] = { 100, 1000, 10000, 100000, 1000000 };
+#define BENCH_NUM_SIZES     (sizeof(bench_sizes) / sizeof(bench_sizes[0]))
+
+static char bench_paths[ BENCH_SAMPLES ][ BENCH_PATH_LEN ];
+
+/* Leaf names are this followed by the leaf's number within its group */
+static const char *bench_leaf = "p";
+
+static double bench_now_ns( void )
+{
+    struct timespec     ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Small deterministic generator, so every run looks up the same nodes. */
+static unsigned int bench_random( unsigned int *state )
+{
+    *state = *state * 1103515245 + 12345;
+    return *state >> 8;
+}
+
+/* Path of leaf i of a generated tree, from the root. */
+static void bench_path( char *buf, unsigned int i )
+{
+    sprintf( buf, "bench.g%u.%s%u", i / BENCH_FANOUT, bench_leaf, i % BENCH_FANOUT );
+}
+
+/* Fill bench_paths with random leaves of an n leaf tree. */
+static void bench_pick_paths( unsigned int n )
+{
+    unsigned int        i, seed = 1;
+
+    for ( i = 0; i < BENCH_SAMPLES; i++ )
+        bench_path( bench_paths[i], bench_random( &seed ) % n );
+}
+
+/*
+ * Text of an n leaf tree below "bench", in the native format or as JSON;
+ * free it with free().  Returns NULL when out of memory.
+ */
+static char *bench_text( unsigned int n, int json, size_t *len )
+{
+    char                *text, *p;
+    unsigned int        i;
+
+    if ( NULL == (text = malloc( (size_t) n * (32 + strlen( bench_leaf )) + 64 )) )
+    {
+        printf("ERR: out of memory\n");
+        return NULL;
+    }
+    p = text + sprintf( text, json ? "{\"bench\":{" : "bench {" );
+    for ( i = 0; i < n; i++ )
+    {
+        if ( json && 0 == i % BENCH_FANOUT )
+            p += sprintf( p, "%s\"g%u\":{", i ? "}," : "", i / BENCH_FANOUT );
+        else if ( 0 == i % BENCH_FANOUT )
+            p += sprintf( p, "%s g%u {", i ? " }" : "", i / BENCH_FANOUT );
+        if ( json )
+            p += sprintf( p, "%s\"%s%u\":%u", i % BENCH_FANOUT ? "," : "", bench_leaf, i % BENCH_FANOUT, i );
+        else
+            p += sprintf( p, " %s%u = %u", bench_leaf, i % BENCH_FANOUT, i );
+    }
+    p += sprintf( p, json ? "}}}" : " } }" );
+
+    *len = p - text;
+    return text;
+}
+
+/* Load an n leaf tree below "bench" with one config_load(), the way a driver tree comes in. */
+static int bench_build( unsigned int n )
+{
+    char                *text;
+    size_t              len;
+    config_result_t     err;
+
+    if ( NULL == (text = bench_text( n, 0, &len )) )
+        return 0;
+    err = config_load( ROOT_NODE, text, len );
+    free( text );
+    if ( CONFIG_SUCCESS != err )
+        printf("ERR: could not load a %u node tree\n", n );
+    return CONFIG_SUCCESS == err;
+}
+
+/* Visit every node below node_ref through the public enumeration calls; returns how many. */
+static unsigned int bench_enumerate( config_ref_t node_ref )
+{
+    unsigned int        count = 0;
+    config_ref_t        child;
+
+    if ( CONFIG_SUCCESS != config_node_first_child( node_ref, &child ) )
+        return 0;
+    while ( 0 != child )
+    {
+        count += 1 + bench_enumerate( child );
+        if ( CONFIG_SUCCESS != config_node_next_sibling( child, &child ) )
+            break;
+    }
+    return count;
+}
+
+/* Average ns per config_get_int() of the paths in bench_paths. */
+static double bench_lookups( config_ref_t base_ref )
+{
+    unsigned int        i;
+    int                 val;
+    double              start = bench_now_ns();
+
+    for ( i = 0; i < BENCH_LOOKUPS; i++ )
+    {
+        if ( CONFIG_SUCCESS != config_get_int( base_ref, bench_paths[ i % BENCH_SAMPLES ], &val ) )
+        {
+            printf("ERR: lookup of \"%s\" failed\n", bench_paths[ i % BENCH_SAMPLES ] );
+            return 0;
+        }
+    }
+    return (bench_now_ns() - start) / BENCH_LOOKUPS;
+}
+
+/*
+ * nodes: grow the database one set at a time from 100 to 1M leaves, timing
+ * every insert, then time random lookups.  The index resizes itself as it
+ * grows; flat lookup times and a small worst insert show that it neither
+ * degrades nor stalls on a rehash.
+ */
+static int bench_nodes( int argc, char *argv[] )
+{
+    unsigned int            max = argc > 0 ? strtoul( argv[0], NULL, 0 ) : bench_sizes[ BENCH_NUM_SIZES - 1 ];
+    unsigned int            s, i;
+    char                    path[ BENCH_PATH_LEN ];
+    double                  start, t, worst, total;
+    config_index_stats_t    stats;
+
+    printf("%10s %12s %14s %12s %10s %10s\n", "nodes", "insert ns", "worst insert", "lookup ns", "max chain", "load x100");
+    for ( s = 0; s < BENCH_NUM_SIZES && bench_sizes[s] <= max; s++ )
+    {
+        if ( CONFIG_SUCCESS != config_initialize() )
+        {
+            printf("ERR: could not initialize the core\n");
+            return 1;
+        }
+
+        worst = total = 0;
+        for ( i = 0; i < bench_sizes[s]; i++ )
+        {
+            bench_path( path, i );
+            start = bench_now_ns();
+            if ( CONFIG_SUCCESS != config_set_int( ROOT_NODE, path, i ) )
+            {
+                printf("ERR: could not set \"%s\"\n", path );
+                config_deinitialize();
+                return 1;
+            }
+            t = bench_now_ns() - start;
+            total += t;
+            if ( t > worst )
+                worst = t;
+        }
+
+        bench_pick_paths( bench_sizes[s] );
+        t = bench_lookups( ROOT_NODE );
+        config_index_stats( &stats );
+        printf("%10u %12.0f %11.1f us %12.0f %10u %10u\n", bench_sizes[s], total / bench_sizes[s], worst / 1000,
+               t, stats.max_chain, stats.load_factor );
+
+        config_deinitialize();
+    }
+    return 0;
+}
+
+/*
+ * iterate: load trees of 100 to 1M leaves and time a full enumeration with
+ * config_node_first_child()/config_node_next_sibling(), a positional pass
+ * with config_node_child_at(), and random lookups.
+ */
+static int bench_iterate( int argc, char *argv[] )
+{
+    unsigned int        max = argc > 0 ? strtoul( argv[0], NULL, 0 ) : bench_sizes[ BENCH_NUM_SIZES - 1 ];
+    unsigned int        s, i, g, groups, count, visited;
+    config_ref_t        bench, group, leaf;
+    double              start, walk, at, lookup;
+
+    printf("%10s %16s %16s %12s\n", "nodes", "enumerate ns", "child_at ns", "lookup ns");
+    for ( s = 0; s < BENCH_NUM_SIZES && bench_sizes[s] <= max; s++ )
+    {
+        if ( CONFIG_SUCCESS != config_initialize() )
+        {
+            printf("ERR: could not initialize the core\n");
+            return 1;
+        }
+        if ( ! bench_build( bench_sizes[s] ) || CONFIG_SUCCESS != config_node_find( ROOT_NODE, "bench", &bench ) )
+        {
+            config_deinitialize();
+            return 1;
+        }
+
+        /* the first pass fills whatever the core caches; time the second */
+        bench_enumerate( bench );
+        start = bench_now_ns();
+        visited = bench_enumerate( bench );
+        walk = (bench_now_ns() - start) / visited;
+
+        config_node_child_count( bench, &groups );
+        visited = 0;
+        start = bench_now_ns();
+        for ( g = 0; g < groups; g++ )
+        {
+            config_node_child_at( bench, g, &group );
+            config_node_child_count( group, &count );
+            for ( i = 0; i < count; i++ )
+                config_node_child_at( group, i, &leaf );
+            visited += 1 + count;
+        }
+        at = (bench_now_ns() - start) / visited;
+
+        bench_pick_paths( bench_sizes[s] );
+        lookup = bench_lookups( ROOT_NODE );
+        printf("%10u %16.1f %16.1f %12.0f\n", bench_sizes[s], walk, at, lookup );
+
+        config_deinitialize();
+    }
+    return 0;
+}
+
+/*
+ * names: the same tree twice, once with leaf names short enough to be kept
+ * inline in an index entry and once with names that need a heap copy, timing
+ * the load and random lookups of each.
+ */
+static int bench_names( int argc, char *argv[] )
+{
+    static const char   *leaves[] = { "p", "parameter_number_" };
+    unsigned int        n = argc > 0 ? strtoul( argv[0], NULL, 0 ) : 100000;
+    unsigned int        k;
+    double              start, load, lookup;
+
+    printf("%20s %10s %12s %12s\n", "leaf names", "nodes", "load ns", "lookup ns");
+    for ( k = 0; k < sizeof(leaves) / sizeof(leaves[0]); k++ )
+    {
+        bench_leaf = leaves[k];
+        if ( CONFIG_SUCCESS != config_initialize() )
+        {
+            printf("ERR: could not initialize the core\n");
+            return 1;
+        }
+        start = bench_now_ns();
+        if ( ! bench_build( n ) )
+        {
+            config_deinitialize();
+            return 1;
+        }
+        load = (bench_now_ns() - start) / n;
+
+        bench_pick_paths( n );
+        lookup = bench_lookups( ROOT_NODE );
+        printf("%19sN %10u %12.0f %12.0f\n", leaves[k], n, load, lookup );
+
+        config_deinitialize();
+    }
+    bench_leaf = leaves[0];
+    return 0;
+}
+
+/*
+ * layers: load a tree into the database, then push overlay layers one at a
+ * time, each overriding one leaf of its own group, and time random lookups
+ * from ROOT_NODE after every push.  Nearly all of them miss in every layer
+ * and fall through to the database.
+ */
+static int bench_layers( int argc, char *argv[] )
+{
+    unsigned int        n = argc > 0 ? strtoul( argv[0], NULL, 0 ) : 100000;
+    unsigned int        k;
+    char                name[ CONFIG_OVERLAY_MAX_NAME + 1 ];
+    char                path[ BENCH_PATH_LEN ];
+    config_ref_t        layer;
+    double              t, base = 0;
+
+    if ( CONFIG_SUCCESS != config_initialize() )
+    {
+        printf("ERR: could not initialize the core\n");
+        return 1;
+    }
+    if ( ! bench_build( n ) )
+    {
+        config_deinitialize();
+        return 1;
+    }
+    bench_pick_paths( n );
+
+    printf("%10s %10s %12s %12s\n", "layers", "nodes", "lookup ns", "vs no layer");
+    for ( k = 0; k <= CONFIG_OVERLAY_MAX_LAYERS; k++ )
+    {
+        if ( k > 0 )
+        {
+            sprintf( name, "bench%u", k );
+            bench_path( path, (k * BENCH_FANOUT) % n );
+            if ( CONFIG_SUCCESS != config_overlay_push( name, &layer ) ||
+                 CONFIG_SUCCESS != config_set_int( layer, path, -1 ) )
+            {
+                printf("ERR: could not push layer %u\n", k );
+                config_deinitialize();
+                return 1;
+            }
+        }
+        t = bench_lookups( ROOT_NODE );
+        if ( 0 == k )
+            base = t;
+        printf("%10u %10u %12.0f %11.2fx\n", k, n, t, t / base );
+    }
+
+    config_deinitialize();
+    return 0;
+}
+
+/* Walk visitor: read the node's name and value, and emit them when asked to. */
+static config_result_t bench_visit( config_ref_t node_ref, unsigned int depth, config_walk_buf_t *out, void *ctx )
+{
+    char                line[ 64 ];
+    int                 val = 0;
+    size_t              len;
+
+    (void) ctx;
+    if ( CONFIG_SUCCESS != config_node_get_name( node_ref, line, 32 ) )
+        return CONFIG_ERR_NOT_FOUND;
+    config_node_get_int( node_ref, &val );
+    len = strlen( line );
+    len += sprintf( line + len, " %u %d\n", depth, val );
+    return config_walk_emit( out, line, len );
+}
+
+/*
+ * parallel: load a tree and walk it with config_walk_parallel() on 1, 2,
+ * 4, ... threads, once unordered and once collecting ordered output, and
+ * report the time per node and the speedup over one thread.
+ */
+static int bench_parallel( int argc, char *argv[] )
+{
+    unsigned int        n = argc > 0 ? strtoul( argv[0], NULL, 0 ) : 1000000;
+    unsigned int        max = argc > 1 ? strtoul( argv[1], NULL, 0 ) : 8;
+    unsigned int        threads;
+    config_ref_t        bench;
+    char                *output;
+    size_t              output_len;
+    double              start, plain, ordered, plain1 = 0, ordered1 = 0;
+
+    if ( CONFIG_SUCCESS != config_initialize() )
+    {
+        printf("ERR: could not initialize the core\n");
+        return 1;
+    }
+    if ( ! bench_build( n ) || CONFIG_SUCCESS != config_node_find( ROOT_NODE, "bench", &bench ) )
+    {
+        config_deinitialize();
+        return 1;
+    }
+    n += n / BENCH_FANOUT + (n % BENCH_FANOUT ? 1 : 0) + 1;
+
+    printf("%10s %10s %12s %10s %12s %10s\n", "threads", "nodes", "walk ns", "speedup", "ordered ns", "speedup");
+    for ( threads = 1; threads <= max; threads *= 2 )
+    {
+        start = bench_now_ns();
+        if ( CONFIG_SUCCESS != config_walk_parallel( bench, bench_visit, NULL, threads, NULL, NULL ) )
+        {
+            printf("ERR: walk on %u threads failed\n", threads );
+            break;
+        }
+        plain = (bench_now_ns() - start) / n;
+
+        start = bench_now_ns();
+        if ( CONFIG_SUCCESS != config_walk_parallel( bench, bench_visit, NULL, threads, &output, &output_len ) )
+        {
+            printf("ERR: ordered walk on %u threads failed\n", threads );
+            break;
+        }
+        ordered = (bench_now_ns() - start) / n;
+        free( output );
+
+        if ( 1 == threads )
+        {
+            plain1 = plain;
+            ordered1 = ordered;
+        }
+        printf("%10u %10u %12.1f %9.2fx %12.1f %9.2fx\n", threads, n, plain, plain1 / plain, ordered, ordered1 / ordered );
+    }
+
+    config_deinitialize();
+    return 0;
+}
+
+/*
+ * json: load the same tree from native text with config_load() and from
+ * JSON with config_load_json(), each into a fresh database, and compare the
+ * time per node and the size of the text.
+ */
+static int bench_json( int argc, char *argv[] )
+{
+    unsigned int        max = argc > 0 ? strtoul( argv[0], NULL, 0 ) : bench_sizes[ BENCH_NUM_SIZES - 1 ];
+    unsigned int        s;
+    int                 json;
+    char                *text;
+    size_t              len[2];
+    double              start, t[2];
+    config_result_t     err;
+
+    printf("%10s %12s %12s %12s %12s %10s\n", "nodes", "hcfg bytes", "json bytes", "hcfg ns", "json ns", "json/hcfg");
+    for ( s = 0; s < BENCH_NUM_SIZES && bench_sizes[s] <= max; s++ )
+    {
+        for ( json = 0; json < 2; json++ )
+        {
+            if ( CONFIG_SUCCESS != config_initialize() )
+            {
+                printf("ERR: could not initialize the core\n");
+                return 1;
+            }
+            if ( NULL == (text = bench_text( bench_sizes[s], json, &len[json] )) )
+            {
+                config_deinitialize();
+                return 1;
+            }
+            start = bench_now_ns();
+            err = json ? config_load_json( ROOT_NODE, text, len[json] ) : config_load( ROOT_NODE, text, len[json] );
+            t[json] = (bench_now_ns() - start) / bench_sizes[s];
+            free( text );
+            config_deinitialize();
+            if ( CONFIG_SUCCESS != err )
+            {
+                printf("ERR: could not load a %u node tree as %s\n", bench_sizes[s], json ? "JSON" : "hcfg" );
+                return 1;
+            }
+        }
+        printf("%10u %12lu %12lu %12.0f %12.0f %9.2fx\n", bench_sizes[s], (unsigned long) len[0], (unsigned long) len[1],
+               t[0], t[1], t[1] / t[0] );
+    }
+    return 0;
+}
+
+/*
+ * bulk: load the same tree into an empty database, which takes the bulk
+ * path that indexes every new edge in one pass, and into one that already
+ * holds a node, which takes the generic path.  Then time a first read of
+ * every leaf, the pass that the bulk index saves.
+ */
+static int bench_bulk( int argc, char *argv[] )
+{
+    unsigned int        max = argc > 0 ? strtoul( argv[0], NULL, 0 ) : bench_sizes[ BENCH_NUM_SIZES - 1 ];
+    unsigned int        s, i;
+    int                 bulk, val;
+    char                *text;
+    char                path[ BENCH_PATH_LEN ];
+    size_t              len;
+    double              start, load[2], read[2];
+    config_result_t     err;
+
+    printf("%10s %14s %14s %17s %17s\n", "nodes", "bulk load ns", "bulk read ns", "generic load ns", "generic read ns");
+    for ( s = 0; s < BENCH_NUM_SIZES && bench_sizes[s] <= max; s++ )
+    {
+        for ( bulk = 0; bulk < 2; bulk++ )
+        {
+            if ( CONFIG_SUCCESS != config_initialize() )
+            {
+                printf("ERR: could not initialize the core\n");
+                return 1;
+            }
+            if ( ( ! bulk && CONFIG_SUCCESS != config_set_int( ROOT_NODE, "other", 0 ) ) ||
+                 NULL == (text = bench_text( bench_sizes[s], 0, &len )) )
+            {
+                config_deinitialize();
+                return 1;
+            }
+            start = bench_now_ns();
+            err = config_load( ROOT_NODE, text, len );
+            load[bulk] = (bench_now_ns() - start) / bench_sizes[s];
+            free( text );
+
+            start = bench_now_ns();
+            for ( i = 0; CONFIG_SUCCESS == err && i < bench_sizes[s]; i++ )
+            {
+                bench_path( path, i );
+                err = config_get_int( ROOT_NODE, path, &val );
+            }
+            read[bulk] = (bench_now_ns() - start) / bench_sizes[s];
+            config_deinitialize();
+            if ( CONFIG_SUCCESS != err )
+            {
+                printf("ERR: %s load of %u nodes failed\n", bulk ? "bulk" : "generic", bench_sizes[s] );
+                return 1;
+            }
+        }
+        printf("%10u %14.0f %14.0f %17.0f %17.0f\n", bench_sizes[s], load[1], read[1], load[0], read[0] );
+    }
+    return 0;
+}
+
+/* FNV-1a seeded with the parent reference, as the name index used to pick buckets */
+static unsigned int bench_fnv( config_ref_t parent, const char *name )
+{
+    unsigned int        h = 2166136261u ^ (parent * 0x9e3779b1u);
+
+    while ( *name )
+    {
+        h ^= (unsigned char) *name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * collide: load n children below one node twice, once with names chosen to
+ * share their low 16 hash bits under the index's former unkeyed FNV-1a
+ * hash, once with ordinary names, and time lookups of all of them.  Under
+ * the keyed hash the crafted names spread like any others: the longest
+ * chain and probe count stay short and no rekey is needed.
+ */
+static int bench_collide( int argc, char *argv[] )
+{
+    unsigned int            n = argc > 0 ? strtoul( argv[0], NULL, 0 ) : 4000;
+    unsigned int            i, k, pass;
+    unsigned long           c;
+    int                     crafted, val;
+    char                    (*names)[ 16 ], *text, *p;
+    config_ref_t            parent;
+    config_index_stats_t    stats;
+    config_result_t         err = CONFIG_SUCCESS;
+    double                  start, load, lookup;
+
+    if ( NULL == (names = malloc( (size_t) n * sizeof(*names) )) || NULL == (text = malloc( (size_t) n * 32 )) )
+    {
+        printf("ERR: out of memory\n");
+        free( names );
+        return 1;
+    }
+
+    printf("%10s %10s %10s %12s %10s %10s %8s\n", "names", "count", "load ns", "lookup ns", "max chain", "max probe", "rekeys");
+    for ( crafted = 1; crafted >= 0 && CONFIG_SUCCESS == err; crafted-- )
+    {
+        if ( CONFIG_SUCCESS != config_initialize() )
+        {
+            printf("ERR: could not initialize the core\n");
+            break;
+        }
+        if ( CONFIG_SUCCESS != (err = config_set_int( ROOT_NODE, "collide.seed", 0 )) ||
+             CONFIG_SUCCESS != (err = config_node_find( ROOT_NODE, "collide", &parent )) )
+        {
+            config_deinitialize();
+            break;
+        }
+
+        for ( k = 0, c = 0; k < n; c++ )
+        {
+            sprintf( names[k], "n%lx", c );
+            if ( ! crafted || 0x1234 == (bench_fnv( parent, names[k] ) & 0xffff) )
+                k++;
+        }
+        for ( p = text, i = 0; i < n; i++ )
+            p += sprintf( p, "%s %u ", names[i], i );
+
+        start = bench_now_ns();
+        err = config_load( parent, text, p - text );
+        load = (bench_now_ns() - start) / n;
+
+        start = bench_now_ns();
+        for ( pass = 0; pass < 5 && CONFIG_SUCCESS == err; pass++ )
+            for ( i = 0; i < n && CONFIG_SUCCESS == err; i++ )
+                err = config_get_int( parent, names[i], &val );
+        lookup = (bench_now_ns() - start) / (5.0 * n);
+
+        config_index_stats( &stats );
+        config_deinitialize();
+        if ( CONFIG_SUCCESS != err )
+            printf("ERR: could not load or look up the %s names\n", crafted ? "crafted" : "ordinary" );
+        else
+            printf("%10s %10u %10.0f %12.0f %10u %10u %8u\n", crafted ? "crafted" : "ordinary", n, load, lookup,
+                   stats.max_chain, stats.max_probe, stats.rekeys );
+    }
+
+    free( text );
+    free( names );
+    return CONFIG_SUCCESS != err;
+}
+
+static volatile int     bench_stop;
+static unsigned long    bench_errors;
+
+/*
+ * Reader half of the stress benchmark: inside an epoch section, take a
+ * reference to a random group and read every leaf through it again and
+ * again, while the writer may remove the group under it.  Returns the
+ * number of sections.
+ */
+static void *bench_stress_reader( void *arg )
+{
+    unsigned int        seed = (unsigned int) (size_t) arg;
+    unsigned long       sections = 0;
+    unsigned int        epoch, i, pass;
+    char                path[ BENCH_PATH_LEN ];
+    config_ref_t        group, leaf;
+    int                 val;
+
+    while ( ! bench_stop )
+    {
+        sprintf( path, "stress.g%u", bench_random( &seed ) % BENCH_STRESS_GROUPS );
+        config_epoch_enter( &epoch );
+        if ( CONFIG_SUCCESS == config_node_find( ROOT_NODE, path, &group ) )
+        {
+            /* the group may be removed and recreated meanwhile, but the reference must stay usable */
+            for ( pass = 0; pass < 4; pass++ )
+                for ( i = 0; i < BENCH_STRESS_LEAVES; i++ )
+                {
+                    sprintf( path, "p%u", i );
+                    if ( CONFIG_SUCCESS == config_node_find( group, path, &leaf ) )
+                        config_node_get_int( leaf, &val );
+                }
+        }
+        if ( CONFIG_SUCCESS != config_epoch_exit( epoch ) )
+            __sync_fetch_and_add( &bench_errors, 1 );
+        sections++;
+    }
+    return (void *) sections;
+}
+
+/*
+ * stress: reader threads hold references across calls inside epoch
+ * sections while the main thread removes random groups and recreates them
+ * with loads and sets.  Every remove, load and set must succeed however
+ * the readers are placed; the benchmark counts the operations of each side.
+ */
+static int bench_stress( int argc, char *argv[] )
+{
+    unsigned int        rounds = argc > 0 ? strtoul( argv[0], NULL, 0 ) : 100000;
+    unsigned int        readers = argc > 1 ? strtoul( argv[1], NULL, 0 ) : BENCH_STRESS_READERS;
+    unsigned int        seed = 1, r, g, i;
+    unsigned long       sections = 0;
+    pthread_t           threads[ 64 ];
+    char                text[ 256 ], path[ BENCH_PATH_LEN ], *p;
+    config_ref_t        group;
+    config_result_t     err = CONFIG_SUCCESS;
+    double              start, elapsed;
+    void                *ret;
+
+    if ( readers > sizeof(threads) / sizeof(threads[0]) )
+        readers = sizeof(threads) / sizeof(threads[0]);
+    if ( CONFIG_SUCCESS != config_initialize() )
+    {
+        printf("ERR: could not initialize the core\n");
+        return 1;
+    }
+
+    bench_stop = 0;
+    for ( r = 0; r < readers; r++ )
+        pthread_create( &threads[r], NULL, bench_stress_reader, (void *) (size_t) (r + 1) );
+
+    start = bench_now_ns();
+    for ( r = 0; r < rounds && CONFIG_SUCCESS == err; r++ )
+    {
+        g = bench_random( &seed ) % BENCH_STRESS_GROUPS;
+        sprintf( path, "stress.g%u", g );
+        if ( CONFIG_SUCCESS == config_node_find( ROOT_NODE, path, &group ) &&
+             CONFIG_SUCCESS != (err = config_private_tree_remove( group )) )
+            break;
+
+        /* bring the group back one way or another */
+        switch ( r % 3 )
+        {
+        case 0:
+            p = text + sprintf( text, "stress { g%u {", g );
+            for ( i = 0; i < BENCH_STRESS_LEAVES; i++ )
+                p += sprintf( p, " p%u = %u", i, r );
+            p += sprintf( p, " } }" );
+            err = config_load( ROOT_NODE, text, p - text );
+            break;
+        case 1:
+            for ( i = 0; i < BENCH_STRESS_LEAVES && CONFIG_SUCCESS == err; i++ )
+            {
+                sprintf( path, "stress.g%u.p%u", g, i );
+                err = config_set_int( ROOT_NODE, path, r );
+            }
+            break;
+        default:
+            /* an unrelated load alongside the recreated group */
+            sprintf( path, "stress.g%u.p0", g );
+            if ( CONFIG_SUCCESS == (err = config_set_int( ROOT_NODE, path, r )) )
+                err = config_load( ROOT_NODE, "other { x = 1 }", 15 );
+            break;
+        }
+    }
+    elapsed = bench_now_ns() - start;
+
+    bench_stop = 1;
+    for ( i = 0; i < readers; i++ )
+    {
+        pthread_join( threads[i], &ret );
+        sections += (unsigned long) ret;
+    }
+    config_deinitialize();
+
+    if ( CONFIG_SUCCESS != err )
+        printf("ERR: writer failed with %d in round %u\n", err, r );
+    if ( bench_errors )
+        printf("ERR: %lu epoch sections did not close\n", bench_errors );
+    printf("%10s %10s %14s %16s\n", "rounds", "readers", "round ns", "reader sections");
+    printf("%10u %10u %14.0f %16lu\n", r, readers, elapsed / (r ? r : 1), sections );
+    return CONFIG_SUCCESS != err || 0 != bench_errors;
+}
+
+/*
+ * Per-unit parameter blocks of the smd drivers, shaped after the driver
+ * tree in platform_config_paths.h.  A platform with several demux or
+ * decoder units repeats the same block below each unit's name.
+ */
+static const struct
+{
+    const char  *driver;
+    const char  *unit;
+} bench_drivers[] =
+{
+    { "demux",      "num_filters = 32 num_pids = 64 buffer_size = 0x10000 dma { channels = 4 burst = 64 }" },
+    { "mux",        "num_streams = 8 pcr_interval = 40 dma { channels = 2 burst = 64 }" },
+    { "viddec",     "max_width = 1920 max_height = 1088 num_frames = 8 codecs { h264 = 1 mpeg2 = 1 vc1 = 1 }" },
+    { "videnc",     "max_width = 1920 max_height = 1088 gop = 30 bitrate = 8000000" },
+    { "vidpproc",   "deinterlace = 1 scaler_taps = 4 num_frames = 4" },
+    { "vidrend",    "max_hold_time = 6000 num_planes = 2" },
+    { "tsout",      "clock = 27000000 packet_size = 188" },
+    { "audrend",    "num_channels = 6 spdif_userdata = \"Intel CE Device\" mixer { inputs = 4 rate = 48000 }" },
+};
+#define BENCH_NUM_DRIVERS   (sizeof(bench_drivers) / sizeof(bench_drivers[0]))
+
+/* A driver tree with units copies of every smd unit block and one memory layout entry per unit.  Free with free(). */
+static char *bench_driver_text( unsigned int units, size_t *len )
+{
+    char                *text, *p;
+    unsigned int        d, u;
+
+    if ( NULL == (text = malloc( (size_t) units * (BENCH_NUM_DRIVERS * 160 + 64) + 512 )) )
+    {
+        printf("ERR: out of memory\n");
+        return NULL;
+    }
+    p = text + sprintf( text, "platform { memory { layout {" );
+    for ( u = 0; u < units; u++ )
+        p += sprintf( p, " smd_unit%u { base = 0x%08x size = 0x00400000 }", u, 0x08000000u + u * 0x00400000u );
+    p += sprintf( p, " } } software { drivers { osal { } pal { } sven { dismask = 0xffffffff debug_level = 0 num_bufs = 2 }"
+                     " smd { core { allow_memory_overlap = 1 }" );
+    for ( d = 0; d < BENCH_NUM_DRIVERS; d++ )
+    {
+        p += sprintf( p, " %s {", bench_drivers[d].driver );
+        for ( u = 0; u < units; u++ )
+            p += sprintf( p, " unit%u { %s }", u, bench_drivers[d].unit );
+        p += sprintf( p, " }" );
+    }
+    p += sprintf( p, " } } } }" );
+
+    *len = p - text;
+    return text;
+}
+
+/*
+ * dedup: load the driver tree with 1 to max units per smd driver, with
+ * subtree deduplication off and on, and report how many of the nodes the
+ * database presents sharing releases, with the load time and the cost of
+ * reading every unit's first parameter by path through the shared copy
+ * (both per node).
+ */
+static int bench_dedup( int argc, char *argv[] )
+{
+    static const unsigned int   units[] = { 1, 2, 4, 8, 16, 64 };
+    unsigned int                max = argc > 0 ? strtoul( argv[0], NULL, 0 ) : 64;
+    unsigned int                s, d, u, nodes = 0;
+    int                         on, val;
+    char                        *text;
+    char                        path[ BENCH_PATH_LEN + 32 ];
+    size_t                      len;
+    double                      start, load[2], read[2];
+    config_dedup_stats_t        stats;
+    config_result_t             err = CONFIG_SUCCESS;
+
+    printf("%10s %10s %12s %8s %14s %14s %14s %14s\n", "units", "nodes", "nodes saved", "saved",
+           "load ns", "dedup load ns", "read ns", "dedup read ns");
+    for ( s = 0; s < sizeof(units) / sizeof(units[0]) && units[s] <= max && CONFIG_SUCCESS == err; s++ )
+    {
+        for ( on = 0; on < 2 && CONFIG_SUCCESS == err; on++ )
+        {
+            if ( CONFIG_SUCCESS != config_initialize() )
+            {
+                printf("ERR: could not initialize the core\n");
+                return 1;
+            }
+            if ( NULL == (text = bench_driver_text( units[s], &len )) )
+            {
+                config_deinitialize();
+                return 1;
+            }
+            config_dedup_enable( on );
+            start = bench_now_ns();
+            err = config_load( ROOT_NODE, text, len );
+            load[on] = bench_now_ns() - start;
+            free( text );
+
+            start = bench_now_ns();
+            for ( d = 0; d < BENCH_NUM_DRIVERS && CONFIG_SUCCESS == err; d++ )
+            {
+                for ( u = 0; u < units[s] && CONFIG_SUCCESS == err; u++ )
+                {
+                    sprintf( path, "platform.software.drivers.smd.%s.unit%u.%.*s", bench_drivers[d].driver, u,
+                             (int) strcspn( bench_drivers[d].unit, " " ), bench_drivers[d].unit );
+                    err = config_get_int( ROOT_NODE, path, &val );
+                }
+            }
+            read[on] = (bench_now_ns() - start) / (BENCH_NUM_DRIVERS * units[s]);
+
+            /* enumerating would give every alias its own copy again, so count the plain tree */
+            if ( ! on )
+                nodes = bench_enumerate( ROOT_NODE );
+            config_dedup_stats( &stats );
+            config_deinitialize();
+            if ( CONFIG_SUCCESS != err )
+                printf("ERR: could not load or read the driver tree with %u units\n", units[s] );
+        }
+        if ( CONFIG_SUCCESS == err )
+            printf("%10u %10u %12u %7.1f%% %14.0f %14.0f %14.0f %14.0f\n", units[s], nodes, stats.nodes_saved,
+                   nodes ? 100.0 * stats.nodes_saved / nodes : 0.0, load[0] / nodes, load[1] / nodes, read[0], read[1] );
+    }
+    return CONFIG_SUCCESS != err;
+}
+
+static const struct
+{
+    const char  *name;
+    const char  *args;
+    int         (*run)( int argc, char *argv[] );
+    const char  *what;
+} benchmarks[] =
+{
+    { "nodes",      "[max nodes]",  bench_nodes,    "insert and lookup latency from 100 to 1M nodes" },
+    { "iterate",    "[max nodes]",  bench_iterate,  "enumeration, positional access and lookup per node" },
+    { "names",      "[nodes]",      bench_names,    "inline against heap-allocated index names" },
+    { "layers",     "[nodes]",      bench_layers,   "lookup cost against the number of overlay layers" },
+    { "parallel",   "[nodes] [max threads]", bench_parallel, "config_walk_parallel() scaling with the thread count" },
+    { "json",       "[max nodes]",  bench_json,     "config_load_json() against config_load() of the same tree" },
+    { "bulk",       "[max nodes]",  bench_bulk,     "loading into an empty node against the generic load path" },
+    { "stress",     "[rounds] [readers]", bench_stress, "removes and reloads racing readers inside epoch sections" },
+    { "collide",    "[names]",      bench_collide,  "names crafted to collide under an unkeyed hash" },
+    { "dedup",      "[max units]",  bench_dedup,    "nodes subtree deduplication saves on a driver tree" },
+};
+
+int main( int argc, char *argv[] )
+{
+    unsigned int    i;
+
+    for ( i = 0; argc > 1 && i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++ )
+        if ( ! strcmp( argv[1], benchmarks[i].name ) )
+            return benchmarks[i].run( argc - 2, argv + 2 );
+
+    printf("usage: %s <benchmark> [args]\n", argv[0] );
+    for ( i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++ )
+        printf("    %-10s %-22s %s\n", benchmarks[i].name, benchmarks[i].args, benchmarks[i].what );
+    return 1;
+}
@@ -0,0 +1,694 @@
+/***********************************************************************
+  This file is provided under a dual BSD/LGPLv2.1 license.  When using
+  or redistributing this file, you may do so under either license.
+
+  LGPL LICENSE SUMMARY
+
+  Copyright(c) <2007-2011>. Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of version 2.1 of the GNU Lesser General Public
+  License as published by the Free Software Foundation.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA. The full GNU Lesser General Public License is included in this
+  distribution in the file called LICENSE.LGPL.
+
+  Contact Information:
+      Intel Corporation
+      2200 Mission College Blvd.
+      Santa Clara, CA  97052
+
+  BSD LICENSE
+
+  Copyright (c) <2007-2011>. Intel Corporation. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+    - Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+************************************************************************/
+
+/*
+ * File loading with include directives.
+ *
+ * config_load_file() reads a configuration file and expands, anywhere a
+ * statement may appear,
+ *
+ *     include "fragment.hcfg"                    splice the fragment in place
+ *     include "fragment.hcfg" at "a.b.c"         load it into node a.b.c
+ *
+ * Relative file names are taken from the directory of the including file;
+ * "at" locations are relative to the node the including file is loaded into
+ * and are created when missing.  An include that leads back to a file still
+ * being expanded is an error.
+ *
+ * Statements take effect in file order.  The expanded text is split at each
+ * "at" include and loaded one piece at a time, the fragment in between; a
+ * split inside blocks closes them and opens them again after it, so such an
+ * include cannot sit in an unnamed block.
+ *
+ * Every expanded file is kept in a cache keyed by a hash of its content (and
+ * its directory, against which its own includes resolve).  A fragment that
+ * is included again, by the same or a later load in this process, is spliced
+ * from the cache instead of being scanned again.  Its own includes are still
+ * read and hashed, so an edit anywhere below it is picked up.  Only the
+ * expansion is cached: the text is parsed again by every load.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "platform_config.h"
+
+typedef struct include_frag include_frag_t;
+
+typedef struct include_ref {
+	char				*path;
+	char				*location;		/* NULL when spliced in place */
+	include_frag_t		*frag;
+	unsigned int		gen;			/* frag->gen when it was used */
+	struct include_ref	*next;
+} include_ref_t;
+
+/* a fragment loaded at a location once text[0..offset) is in */
+typedef struct include_at {
+	size_t				offset;
+	char				*location;
+	include_frag_t		*frag;
+	struct include_at	*next;
+} include_at_t;
+
+struct include_frag {
+	unsigned long long	hash;			/* of raw[0..rawlen) */
+	char				*raw;
+	size_t				rawlen;
+	char				*dir;
+	char				*text;			/* raw with in-place includes spliced */
+	size_t				textlen;
+	include_ref_t		*includes;		/* in file order */
+	include_at_t		*ats;			/* by offset, those of in-place includes too */
+	unsigned int		gen;			/* unique per expansion */
+	include_frag_t		*next;
+};
+
+/* files currently being expanded, innermost first */
+typedef struct include_stack {
+	const char				*path;
+	struct include_stack	*outer;
+} include_stack_t;
+
+typedef struct {
+	char	*data;
+	size_t	len;
+	size_t	size;
+} include_buf_t;
+
+/* blocks open at the current point of an expansion */
+typedef struct {
+	include_buf_t	reopen;			/* "name { " per block, outermost first */
+	unsigned int	depth;
+	unsigned int	unnamed;
+} include_blocks_t;
+
+static include_frag_t *frag_cache;
+static unsigned int   frag_generation;
+
+static unsigned long long include_hash( const char *data, size_t len )
+{
+	unsigned long long h = 14695981039346656037ULL;
+
+	while ( len-- )
+	{
+		h ^= (unsigned char) *data++;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static int include_append( include_buf_t *buf, const char *data, size_t len )
+{
+	if ( buf->len + len + 1 > buf->size )
+	{
+		size_t	size = buf->size ? buf->size : 256;
+		char	*grown;
+
+		while ( buf->len + len + 1 > size )
+			size *= 2;
+		if ( NULL == (grown = realloc( buf->data, size )) )
+			return 0;
+		buf->data = grown;
+		buf->size = size;
+	}
+	memcpy( buf->data + buf->len, data, len );
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+	return 1;
+}
+
+static int include_is_ident( char c )
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || '_' == c;
+}
+
+static int include_is_space( char c )
+{
+	return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+static int include_is_name( char c )
+{
+	return include_is_ident( c ) || '.' == c;
+}
+
+static int include_block_open( include_blocks_t *blocks, const char *name, size_t len )
+{
+	if ( 0 == len )
+		blocks->unnamed++;
+	if ( ! include_append( &blocks->reopen, name, len ) || ! include_append( &blocks->reopen, len ? " { " : "{ ", len ? 3 : 2 ) )
+		return 0;
+	blocks->depth++;
+	return 1;
+}
+
+static void include_block_close( include_blocks_t *blocks )
+{
+	include_buf_t	*r = &blocks->reopen;
+	size_t			end;
+
+	if ( 0 == blocks->depth )
+		return;
+	blocks->depth--;
+
+	/* drop the last "{ " and the name in front of it, if any */
+	end = r->len - 2;
+	if ( 0 == end || '{' == r->data[end - 2] )
+		blocks->unnamed--;
+	else
+		for ( end--; end > 0 && ' ' != r->data[end - 1]; end-- )
+			;
+	r->len = end;
+	r->data[end] = '\0';
+}
+
+/* Length of the quoted string starting at text[0] == '"', quotes included; 0 if unterminated. */
+static size_t include_string_len( const char *text, size_t len )
+{
+	size_t i;
+
+	for ( i = 1; i < len; i++ )
+	{
+		if ( '\\' == text[i] )
+			i++;
+		else if ( '"' == text[i] )
+			return i + 1;
+	}
+	return 0;
+}
+
+/* Length of the comment starting at text[0], or 0 if there is none. */
+static size_t include_comment_len( const char *text, size_t len )
+{
+	size_t i;
+
+	if ( len < 2 || '/' != text[0] )
+		return 0;
+	if ( '/' == text[1] )
+	{
+		for ( i = 2; i < len && '\n' != text[i]; i++ )
+			;
+		return i;
+	}
+	if ( '*' == text[1] )
+	{
+		for ( i = 2; i + 1 < len; i++ )
+			if ( '*' == text[i] && '/' == text[i + 1] )
+				return i + 2;
+		return len;
+	}
+	return 0;
+}
+
+static char *include_strndup( const char *text, size_t len )
+{
+	char *copy = malloc( len + 1 );
+
+	if ( copy )
+	{
+		memcpy( copy, text, len );
+		copy[len] = '\0';
+	}
+	return copy;
+}
+
+static char *include_read( const char *path, size_t *len )
+{
+	FILE	*fp;
+	char	*data = NULL;
+	long	size;
+
+	if ( NULL == (fp = fopen( path, "r" )) )
+		return NULL;
+
+	fseek( fp, 0, SEEK_END );
+	size = ftell( fp );
+	rewind( fp );
+	if ( size >= 0 && NULL != (data = malloc( size + 1 )) )
+	{
+		if ( size == (long) fread( data, 1, size, fp ) )
+		{
+			data[size] = '\0';
+			*len = size;
+		}
+		else
+		{
+			free( data );
+			data = NULL;
+		}
+	}
+	fclose( fp );
+	return data;
+}
+
+/*
+ * If text[0..len) starts with  include "name" [at "location"]  return the
+ * directive's length and the positions of the two (quoted) strings.
+ */
+static size_t include_directive( const char *text, size_t len, size_t *name, size_t *name_len, size_t *loc, size_t *loc_len )
+{
+	size_t p = 7, q, end;
+
+	if ( len < p || strncmp( text, "include", p ) || (p < len && include_is_ident( text[p] )) )
+		return 0;
+
+	while ( p < len && include_is_space( text[p] ) )
+		p++;
+	if ( p == len || '"' != text[p] || 0 == (*name_len = include_string_len( text + p, len - p )) )
+		return 0;
+	*name = p;
+	end = p + *name_len;
+
+	*loc_len = 0;
+	for ( q = end; q < len && include_is_space( text[q] ); q++ )
+		;
+	if ( q + 2 < len && ! strncmp( text + q, "at", 2 ) && include_is_space( text[q + 2] ) )
+	{
+		for ( q += 2; q < len && include_is_space( text[q] ); q++ )
+			;
+		if ( q < len && '"' == text[q] && 0 != (*loc_len = include_string_len( text + q, len - q )) )
+		{
+			*loc = q;
+			end = q + *loc_len;
+		}
+	}
+	return end;
+}
+
+/* Split out at the current point: close the open blocks, load frag at location there, open them again. */
+static config_result_t include_split( include_buf_t *out, const include_blocks_t *blocks, include_at_t ***tail,
+									  const char *location, size_t loc_len, include_frag_t *frag )
+{
+	include_at_t	*at;
+	unsigned int	i;
+
+	if ( blocks->unnamed )
+	{
+		printf("ERR: include at \"%.*s\" inside an unnamed block\n", (int) loc_len, location );
+		return CONFIG_ERR_INVALID_REFERENCE;
+	}
+
+	for ( i = 0; i < blocks->depth; i++ )
+		if ( ! include_append( out, " }", 2 ) )
+			return CONFIG_ERR_NO_RESOURCES;
+
+	if ( NULL == (at = calloc( 1, sizeof(*at) )) || NULL == (at->location = include_strndup( location, loc_len )) )
+	{
+		free( at );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	at->offset = out->len;
+	at->frag = frag;
+	**tail = at;
+	*tail = &at->next;
+
+	if ( blocks->depth && ! include_append( out, blocks->reopen.data, blocks->reopen.len ) )
+		return CONFIG_ERR_NO_RESOURCES;
+	return CONFIG_SUCCESS;
+}
+
+static include_frag_t *include_expand_file( const char *path, include_stack_t *outer, config_result_t *err );
+
+/*
+ * Expand the directives in frag->raw into frag->text, frag->includes and
+ * frag->ats; strings and comments are copied through untouched.  Block
+ * names are followed well enough to reopen the blocks around a split.
+ */
+static config_result_t include_expand( include_frag_t *frag, include_stack_t *stack )
+{
+	include_buf_t		out;
+	include_blocks_t	blocks;
+	include_ref_t		**tail = &frag->includes, *inc;
+	include_at_t		**at_tail = &frag->ats, *at;
+	include_frag_t		*child;
+	const char			*raw = frag->raw;
+	size_t				len = frag->rawlen, pos = 0, skip, from;
+	size_t				name, name_len, loc, loc_len;
+	size_t				last = 0, last_len = 0;
+	int					naming = 0;		/* 1 after a name, 2 after "name =" */
+	char				file[PATH_MAX];
+	config_result_t		err = CONFIG_SUCCESS;
+
+	memset( &out, 0, sizeof(out) );
+	memset( &blocks, 0, sizeof(blocks) );
+	if ( ! include_append( &out, "", 0 ) || ! include_append( &blocks.reopen, "", 0 ) )
+	{
+		free( out.data );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	while ( pos < len && CONFIG_SUCCESS == err )
+	{
+		if ( '"' == raw[pos] )
+		{
+			skip = include_string_len( raw + pos, len - pos );
+			naming = 0;
+		}
+		else
+			skip = include_comment_len( raw + pos, len - pos );
+
+		if ( 0 == skip && include_is_ident( raw[pos] )
+		  && 0 != (skip = include_directive( raw + pos, len - pos, &name, &name_len, &loc, &loc_len )) )
+		{
+			/* file names are relative to the including file */
+			if ( '/' == raw[pos + name + 1] )
+				snprintf( file, sizeof(file), "%.*s", (int) name_len - 2, raw + pos + name + 1 );
+			else
+				snprintf( file, sizeof(file), "%s/%.*s", frag->dir, (int) name_len - 2, raw + pos + name + 1 );
+
+			if ( NULL == (child = include_expand_file( file, stack, &err )) )
+				break;
+
+			if ( NULL == (inc = calloc( 1, sizeof(*inc) )) || NULL == (inc->path = include_strndup( file, strlen( file ) ))
+			  || (loc_len && NULL == (inc->location = include_strndup( raw + pos + loc + 1, loc_len - 2 ))) )
+			{
+				if ( inc )
+					free( inc->path );
+				free( inc );
+				err = CONFIG_ERR_NO_RESOURCES;
+				break;
+			}
+			inc->frag = child;
+			inc->gen = child->gen;
+			*tail = inc;
+			tail = &inc->next;
+
+			if ( loc_len )
+				err = include_split( &out, &blocks, &at_tail, inc->location, loc_len - 2, child );
+			else
+			{
+				/* the child's own splits land here, in the blocks open at the directive */
+				for ( from = 0, at = child->ats; at && CONFIG_SUCCESS == err; from = at->offset, at = at->next )
+				{
+					if ( ! include_append( &out, child->text + from, at->offset - from ) )
+						err = CONFIG_ERR_NO_RESOURCES;
+					else
+						err = include_split( &out, &blocks, &at_tail, at->location, strlen( at->location ), at->frag );
+				}
+				if ( CONFIG_SUCCESS == err && ! include_append( &out, child->text + from, child->textlen - from ) )
+					err = CONFIG_ERR_NO_RESOURCES;
+			}
+			naming = 0;
+			pos += skip;
+			continue;
+		}
+
+		if ( 0 == skip && include_is_ident( raw[pos] ) )
+		{
+			for ( skip = 1; pos + skip < len && include_is_name( raw[pos + skip] ); skip++ )
+				;
+			/* a name, unless it is the value of the one before */
+			naming = ! naming;
+			last = pos;
+			last_len = skip;
+		}
+		else if ( 0 == skip )
+		{
+			/* an unterminated string runs to the end; htuple reports it */
+			skip = ( '"' == raw[pos] ) ? len - pos : 1;
+
+			if ( '{' == raw[pos] )
+			{
+				if ( ! include_block_open( &blocks, raw + last, naming ? last_len : 0 ) )
+					err = CONFIG_ERR_NO_RESOURCES;
+				naming = 0;
+			}
+			else if ( '}' == raw[pos] )
+			{
+				include_block_close( &blocks );
+				naming = 0;
+			}
+			else if ( '=' == raw[pos] )
+				naming = ( naming ) ? 2 : 0;
+			else if ( ! include_is_space( raw[pos] ) && 2 != naming )
+				naming = 0;
+		}
+
+		if ( ! include_append( &out, raw + pos, skip ) )
+			err = CONFIG_ERR_NO_RESOURCES;
+		pos += skip;
+	}
+
+	free( blocks.reopen.data );
+	frag->text = out.data;
+	frag->textlen = out.len;
+	frag->gen = ++frag_generation;
+	return err;
+}
+
+/* Release what include_expand() built. */
+static void include_clear( include_frag_t *frag )
+{
+	while ( frag->ats )
+	{
+		include_at_t *next = frag->ats->next;
+
+		free( frag->ats->location );
+		free( frag->ats );
+		frag->ats = next;
+	}
+	while ( frag->includes )
+	{
+		include_ref_t *next = frag->includes->next;
+
+		free( frag->includes->path );
+		free( frag->includes->location );
+		free( frag->includes );
+		frag->includes = next;
+	}
+	free( frag->text );
+	frag->text = NULL;
+	frag->textlen = 0;
+}
+
+static void include_free( include_frag_t *frag )
+{
+	include_clear( frag );
+	free( frag->raw );
+	free( frag->dir );
+	free( frag );
+}
+
+/* 1 if every file frag includes still expands to what was spliced, 0 if not, -1 on error. */
+static int include_current( include_frag_t *frag, include_stack_t *stack, config_result_t *err )
+{
+	include_ref_t	*inc;
+	include_frag_t	*child;
+
+	for ( inc = frag->includes; inc; inc = inc->next )
+	{
+		if ( NULL == (child = include_expand_file( inc->path, stack, err )) )
+			return -1;
+		/* generations are never reused, so a match means the very same expansion */
+		if ( child->gen != inc->gen )
+			return 0;
+	}
+	return 1;
+}
+
+static include_frag_t *include_expand_file( const char *path, include_stack_t *outer, config_result_t *err )
+{
+	include_stack_t		stack, *s;
+	include_frag_t		*frag;
+	char				real[PATH_MAX], dir[PATH_MAX];
+	unsigned long long	hash;
+	size_t				rawlen;
+	char				*raw;
+
+	if ( NULL == realpath( path, real ) || NULL == (raw = include_read( real, &rawlen )) )
+	{
+		printf("could not open file \"%s\"\n", path );
+		*err = CONFIG_ERR_NOT_FOUND;
+		return NULL;
+	}
+
+	for ( s = outer; s; s = s->outer )
+		if ( ! strcmp( s->path, real ) )
+		{
+			printf("ERR: \"%s\" includes itself\n", real );
+			free( raw );
+			*err = CONFIG_ERR_INVALID_REFERENCE;
+			return NULL;
+		}
+
+	/* realpath() results are absolute, so there is always a slash */
+	strcpy( dir, real );
+	*strrchr( dir, '/' ) = '\0';
+	if ( '\0' == dir[0] )
+		strcpy( dir, "/" );
+
+	stack.path = real;
+	stack.outer = outer;
+
+	hash = include_hash( raw, rawlen );
+	for ( frag = frag_cache; frag; frag = frag->next )
+		if ( frag->hash == hash && frag->rawlen == rawlen && ! memcmp( frag->raw, raw, rawlen ) && ! strcmp( frag->dir, dir ) )
+			break;
+
+	if ( frag )
+	{
+		include_frag_t **pprev;
+		int current = include_current( frag, &stack, err );
+
+		free( raw );
+		if ( current > 0 )
+			return frag;
+
+		/* something it includes has changed: expand it again, in place */
+		if ( 0 == current )
+		{
+			include_clear( frag );
+			if ( CONFIG_SUCCESS == (*err = include_expand( frag, &stack )) )
+				return frag;
+		}
+
+		for ( pprev = &frag_cache; *pprev != frag; pprev = &(*pprev)->next )
+			;
+		*pprev = frag->next;
+		include_free( frag );
+		return NULL;
+	}
+
+	if ( NULL == (frag = calloc( 1, sizeof(*frag) )) || NULL == (frag->dir = include_strndup( dir, strlen( dir ) )) )
+	{
+		free( frag );
+		free( raw );
+		*err = CONFIG_ERR_NO_RESOURCES;
+		return NULL;
+	}
+	frag->raw = raw;
+	frag->rawlen = rawlen;
+	frag->hash = hash;
+
+	if ( CONFIG_SUCCESS != (*err = include_expand( frag, &stack )) )
+	{
+		include_free( frag );
+		return NULL;
+	}
+
+	frag->next = frag_cache;
+	frag_cache = frag;
+	return frag;
+}
+
+/* Load text[from..to) at base_ref, unless there is nothing but blanks in it. */
+static config_result_t include_load_text( config_ref_t base_ref, const char *text, size_t from, size_t to )
+{
+	size_t i;
+
+	for ( i = from; i < to && include_is_space( text[i] ); i++ )
+		;
+	return ( i < to ) ? config_load( base_ref, text + from, to - from ) : CONFIG_SUCCESS;
+}
+
+static config_result_t include_load( config_ref_t base_ref, const include_frag_t *frag )
+{
+	config_result_t	err = CONFIG_SUCCESS;
+	include_at_t	*at;
+	config_ref_t	loc_ref;
+	size_t			from = 0;
+
+	/* the text up to each split goes in before the fragment loaded there */
+	for ( at = frag->ats; at && CONFIG_SUCCESS == err; from = at->offset, at = at->next )
+	{
+		if ( CONFIG_SUCCESS != (err = include_load_text( base_ref, frag->text, from, at->offset )) )
+			break;
+
+		/* Does the target location exist already?  NO?: Create the location */
+		if ( CONFIG_SUCCESS != config_node_find( base_ref, at->location, &loc_ref )
+		  && ( CONFIG_SUCCESS != (err = config_set_int( base_ref, at->location, 0 ))
+		    || CONFIG_SUCCESS != (err = config_node_find( base_ref, at->location, &loc_ref )) ) )
+		{
+			printf("ERR: could not find/create config database location \"%s\"\n", at->location );
+			break;
+		}
+		err = include_load( loc_ref, at->frag );
+	}
+	if ( CONFIG_SUCCESS == err )
+		err = include_load_text( base_ref, frag->text, from, frag->textlen );
+	return err;
+}
+
+/* Load a configuration file, expanding its include directives, into the specified reference node. */
+config_result_t config_load_file( config_ref_t base_ref, const char *filename )
+{
+	config_result_t	err = CONFIG_SUCCESS;
+	include_frag_t	*frag;
+
+	if ( NULL == (frag = include_expand_file( filename, NULL, &err )) )
+		return err;
+
+	return include_load( base_ref, frag );
+}
+
+/* Release every cached fragment. */
+void config_load_file_cache_clear( void )
+{
+	while ( frag_cache )
+	{
+		include_frag_t *next = frag_cache->next;
+
+		include_free( frag_cache );
+		frag_cache = next;
+	}
+}
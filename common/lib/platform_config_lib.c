@@ -130,6 +130,91 @@ config_result_t config_get_str( config_ref_t base_ref, const char *name, char *s
     return CONFIG_SUCCESS;
 }
 
+/* Start at the specified reference node, locate the sub-node with the specified name, and copy out up to max elements of its integer array. */
+config_result_t config_get_int_array( config_ref_t base_ref, const char *name, int *values, unsigned int max, unsigned int *count )
+{
+
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.const_name	= name;
+	ioctl_args.data_ptr		= values;
+	ioctl_args.bufsize		= max;
+	ioctl_args.val_ptr		= (int *) count;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_GET_INT_ARRAY, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Start at the specified reference node, locate the sub-node with the specified name, and return one element of its integer array. */
+config_result_t config_get_int_array_elem( config_ref_t base_ref, const char *name, unsigned int index, int *val )
+{
+
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.const_name	= name;
+	ioctl_args.val			= (int) index;
+	ioctl_args.val_ptr		= val;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_GET_INT_ARRAY_ELEM, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Start at the specified reference node and fill the fields of out described by desc[0..count). */
+config_result_t config_bind_struct( config_ref_t base_ref, const config_bind_desc_t *desc, unsigned int count, void *out, unsigned int *present )
+{
+	unsigned int	i, found = 0;
+	size_t			extent = 0;
+
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	/* the driver copies the structure in and out, up to the end of the last described field */
+	for ( i = 0; i < count; i++ )
+	{
+		size_t end = desc[i].offset + ((CONFIG_BIND_INT == desc[i].type) ? sizeof(int) : desc[i].size);
+
+		if ( end > extent )
+			extent = end;
+	}
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.data_ptr		= (void *) desc;
+	ioctl_args.val			= (int) count;
+	ioctl_args.string		= out;
+	ioctl_args.bufsize		= extent;
+	ioctl_args.val_ptr		= (int *) &found;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_BIND_STRUCT, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+	if ( present )
+		*present = found;
+    return CONFIG_SUCCESS;
+}
+
 /* Start at the specified reference node, locate or create the sub-node with the specified name, and assign the integer value to that name. */
 config_result_t config_set_int( config_ref_t base_ref, const char *name, int val )
 {
@@ -247,6 +332,47 @@ config_result_t config_node_next_sibling( config_ref_t node_ref, config_ref_t *c
    	return CONFIG_SUCCESS;
 }
 
+/* Return the number of children of the specified reference node. */
+config_result_t config_node_child_count( config_ref_t node_ref, unsigned int *count )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.base_ref		= node_ref;
+	ioctl_args.val_ptr		= (int *) count;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_NODE_CHILD_COUNT, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Find the child at the specified position under the specified reference node, and return a reference to that child. */
+config_result_t config_node_child_at( config_ref_t node_ref, unsigned int index, config_ref_t *child_ref )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.base_ref		= node_ref;
+	ioctl_args.val			= index;
+	ioctl_args.node_ptr		= child_ref;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_NODE_CHILD_AT, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_NOT_FOUND;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
 /* Return the name of the specified reference node. */
 config_result_t config_node_get_name( config_ref_t node_ref, char *name, size_t bufsize )
 {
@@ -340,6 +466,12 @@ config_result_t config_node_tree_remove( config_ref_t node_ref )
     return CONFIG_SUCCESS;
 }
 
+/* Remove the subtree rooted at the specified reference node, under the name the public header declares. */
+config_result_t config_private_tree_remove( config_ref_t base_ref )
+{
+    return config_node_tree_remove( base_ref );
+}
+
 /* Parse the specified string of configuration data and insert it into the dictionary at the specified reference node. */
 config_result_t config_load( config_ref_t base_ref, const char *config_data, size_t datalength )
 {
@@ -364,6 +496,480 @@ config_result_t config_load( config_ref_t base_ref, const char *config_data, siz
     return CONFIG_SUCCESS;
 }
 
+/* Report the health of the core name index. */
+config_result_t config_index_stats( config_index_stats_t *stats )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.data_ptr		= stats;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_INDEX_STATS, &ioctl_args) < 0)
+    {
+    	return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Stack a new, empty overlay layer on top of the database. */
+config_result_t config_overlay_push( const char *name, config_ref_t *layer_ref )
+{
+	config_ref_t	root = 0;
+
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.const_name	= name;
+	ioctl_args.node_ptr		= &root;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_OVERLAY_PUSH, &ioctl_args) < 0)
+    {
+    	return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+	if ( layer_ref )
+		*layer_ref = root;
+    return CONFIG_SUCCESS;
+}
+
+/* Remove an overlay layer and everything loaded into it. */
+config_result_t config_overlay_drop( const char *name )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.const_name	= name;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_OVERLAY_DROP, &ioctl_args) < 0)
+    {
+    	return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Return the root node of an overlay layer. */
+config_result_t config_overlay_find( const char *name, config_ref_t *layer_ref )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.const_name	= name;
+	ioctl_args.node_ptr		= layer_ref;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_OVERLAY_FIND, &ioctl_args) < 0)
+    {
+    	return CONFIG_ERR_NOT_FOUND;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Start at the specified reference node and return the nodes matching pattern that pass pred. */
+config_result_t config_query( config_ref_t base_ref, const char *pattern, const config_query_pred_t *pred, config_query_result_t *results, unsigned int max, unsigned int *count )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.const_name	= pattern;
+	ioctl_args.config_data	= (const char *) pred;
+	ioctl_args.data_ptr		= results;
+	ioctl_args.bufsize		= results ? max : 0;
+	ioctl_args.val_ptr		= (int *) count;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_QUERY, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Reduce the integer value of child_key under each child of the specified reference node. */
+config_result_t config_aggregate( config_ref_t base_ref, const char *child_key, config_aggregate_op_t op, long long *result )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.const_name	= child_key ? child_key : "";
+	ioctl_args.val			= op;
+	ioctl_args.data_ptr		= result;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_AGGREGATE, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_NOT_FOUND;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Find the memory layout entry containing the physical address pa. */
+config_result_t config_layout_lookup_pa( unsigned long pa, config_ref_t *node_ref, unsigned long *offset )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.bufsize		= pa;
+	ioctl_args.node_ptr		= node_ref;
+	ioctl_args.data_ptr		= offset;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_LAYOUT_LOOKUP_PA, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_NOT_FOUND;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Return the content hash of the subtree rooted at the specified reference node. */
+config_result_t config_subtree_hash( config_ref_t node_ref, unsigned long long *hash )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= node_ref;
+	ioctl_args.data_ptr		= hash;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_SUBTREE_HASH, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Compare two subtrees, descending only into children whose hashes differ. */
+config_result_t config_subtree_diff( config_ref_t a_ref, config_ref_t b_ref, config_diff_t *diffs, unsigned int max, unsigned int *count )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= a_ref;
+	ioctl_args.val			= (int) b_ref;
+	ioctl_args.data_ptr		= diffs;
+	ioctl_args.bufsize		= diffs ? max : 0;
+	ioctl_args.val_ptr		= (int *) count;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_SUBTREE_DIFF, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Parse the specified JSON object and insert its members into the dictionary at the specified reference node. */
+config_result_t config_load_json( config_ref_t base_ref, const char *json, size_t len )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.config_data	= json;
+	ioctl_args.bufsize		= len;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_LOAD_JSON, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Parse the specified flat "dotted.path = value" lines and apply them as one batch at the specified reference node. */
+config_result_t config_load_flat( config_ref_t base_ref, const char *data, size_t len )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.config_data	= data;
+	ioctl_args.bufsize		= len;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_LOAD_FLAT, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Write the subtree rooted at the specified reference node as JSON. */
+config_result_t config_export_json( config_ref_t base_ref, char *buf, size_t bufsize, size_t *len )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.base_ref 	= base_ref;
+	ioctl_args.string		= buf;
+	ioctl_args.bufsize		= buf ? bufsize : 0;
+	ioctl_args.data_ptr		= len;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_EXPORT_JSON, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return ( *len > ioctl_args.bufsize ) ? CONFIG_ERR_NO_RESOURCES : CONFIG_SUCCESS;
+}
+
+/* Record every change to the database from now on in a journal of the specified size; 0 stops and discards it. */
+config_result_t config_journal_start( size_t size )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.bufsize		= size;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_JOURNAL_START, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_NO_RESOURCES;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Copy the journal out, to be replayed later. */
+config_result_t config_journal_save( char *buf, size_t bufsize, size_t *len )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.string		= buf;
+	ioctl_args.bufsize		= buf ? bufsize : 0;
+	ioctl_args.data_ptr		= len;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_JOURNAL_SAVE, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return ( *len > ioctl_args.bufsize ) ? CONFIG_ERR_NO_RESOURCES : CONFIG_SUCCESS;
+}
+
+/* Apply a saved journal to the database, coalescing superseded sets. */
+config_result_t config_journal_replay( const char *data, size_t len )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.config_data	= data;
+	ioctl_args.bufsize		= len;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_JOURNAL_REPLAY, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Create an empty tree to build a replacement in, off the live database. */
+config_result_t config_stage_prepare( config_ref_t *stage_ref )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.node_ptr		= stage_ref;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_STAGE_PREPARE, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_NO_RESOURCES;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Replace everything below base_ref with a tree built under stage_ref, in one step. */
+config_result_t config_stage_publish( config_ref_t base_ref, config_ref_t stage_ref )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.base_ref		= base_ref;
+	ioctl_args.val			= stage_ref;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_STAGE_PUBLISH, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Move the subtree at src_ref below new_parent_ref as new_name, without copying it. */
+config_result_t config_node_move( config_ref_t src_ref, config_ref_t new_parent_ref, const char *new_name )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.base_ref		= src_ref;
+	ioctl_args.val			= new_parent_ref;
+	ioctl_args.const_name	= new_name;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_NODE_MOVE, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Give this process's handle a private namespace: writes through it stay private until published. */
+config_result_t config_namespace_create( unsigned int *ns )
+{
+	int id = 0;
+
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.val_ptr		= &id;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_NS_CREATE, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_NO_RESOURCES;
+    }
+
+	*ns = id;
+    return CONFIG_SUCCESS;
+}
+
+/* Write everything in the handle's namespace to the shared tree. */
+config_result_t config_namespace_publish( unsigned int ns )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.val			= ns;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_NS_PUBLISH, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Discard the handle's namespace and everything written to it. */
+config_result_t config_namespace_destroy( unsigned int ns )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+	ioctl_args.val			= ns;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_NS_DISCARD, &ioctl_args) < 0)
+    {
+		return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Turn sharing of identical subtrees on subsequent loads on or off. */
+config_result_t config_dedup_enable( int enable )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.val			= enable;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_DEDUP_ENABLE, &ioctl_args) < 0)
+    {
+    	return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
+/* Report how many subtrees are shared and how many nodes that saves. */
+config_result_t config_dedup_stats( config_dedup_stats_t *stats )
+{
+	if ( pc_handle < 0)
+    {
+//  	OS_DEBUG("platform_config: Not initialized\n");
+        return CONFIG_ERR_NOT_INITIALIZED;
+    }
+
+    ioctl_args.data_ptr		= stats;
+
+    if (ioctl(pc_handle, PLATFORM_CONFIG_IOC_DEDUP_STATS, &ioctl_args) < 0)
+    {
+    	return CONFIG_ERR_INVALID_REFERENCE;
+    }
+
+    return CONFIG_SUCCESS;
+}
+
 /* initialize memory layout internal hash table */
 config_result_t config_initialize( void )
 {
@@ -0,0 +1,493 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Packed integer arrays.
+ *
+ * A configuration file may give a node a list of integers:
+ *
+ *     gains = [ 0x10, 0x20, -3, 42 ]
+ *
+ * htuple only knows integers and strings, so config_load() first rewrites each
+ * such list into a string value tagged with ARRAY_TAG ("\x1f[0x10,0x20,-3,42]")
+ * and, once htuple has parsed the text, looks for the tagged values among the
+ * new nodes and records those nodes as arrays.  Whether a node is an array is
+ * kept here, not read back from its text, so a string that happens to look
+ * like a list stays a string.  Writing any other value to the node, removing
+ * it or loading over it ends the array.  A load into a node that already has
+ * content is parsed into a scratch tree and merged in (config_tree_merge())
+ * whenever lists or arrays are involved, so that each value written can take
+ * or drop the array type.
+ *
+ * The first time an array is read the string is decoded into a contiguous
+ * vector, which is kept until the node's value changes or the node is
+ * removed.  Reads after that cost one path lookup and a copy, however many
+ * elements there are.  Elements are 32-bit integers, like int node values.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+#define ARRAY_OPEN		'['
+#define ARRAY_CLOSE		']'
+#define ARRAY_SEP		','
+
+#define ARRAY_TAG		CONFIG_ARRAY_TAG
+
+typedef struct {
+	unsigned int	count;
+	int				values[1];
+} config_array_t;
+
+/* array node reference -> its decoded config_array_t *, or 0 until it is first read */
+static config_refmap_t array_nodes;
+
+static int array_is_space( char c )
+{
+	return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+/* Length of the comment starting at text[0], 0 if there is none. */
+static size_t array_comment_len( const char *text, size_t len )
+{
+	size_t i;
+
+	if ( len < 2 || '/' != text[0] )
+		return 0;
+	if ( '/' == text[1] )
+	{
+		for ( i = 2; i < len && '\n' != text[i]; i++ )
+			;
+		return i;
+	}
+	if ( '*' == text[1] )
+	{
+		for ( i = 2; i + 1 < len; i++ )
+			if ( '*' == text[i] && '/' == text[i + 1] )
+				return i + 2;
+		return len;
+	}
+	return 0;
+}
+/* Parse one decimal or 0x-prefixed element, optionally signed, spanning exactly text[0..len). */
+int config_array_parse_int( const char *text, size_t len, int *val )
+{
+	unsigned long long	v = 0;
+	unsigned int		base = 10;
+	int					negative = 0;
+	size_t				i = 0;
+
+	if ( i < len && ('-' == text[i] || '+' == text[i]) )
+		negative = ('-' == text[i++]);
+
+	if ( i + 1 < len && '0' == text[i] && ('x' == text[i + 1] || 'X' == text[i + 1]) )
+	{
+		base = 16;
+		i += 2;
+	}
+
+	if ( i == len )
+		return 0;
+
+	for ( ; i < len; i++ )
+	{
+		char			c = text[i];
+		unsigned int	digit;
+
+		if ( c >= '0' && c <= '9' )
+			digit = c - '0';
+		else if ( 16 == base && c >= 'a' && c <= 'f' )
+			digit = c - 'a' + 10;
+		else if ( 16 == base && c >= 'A' && c <= 'F' )
+			digit = c - 'A' + 10;
+		else
+			return 0;
+
+		v = v * base + digit;
+		/* anything that fits in 32 bits like an int node value: up to 0xffffffff, down to INT_MIN */
+		if ( v > (negative ? 0x80000000ULL : 0xffffffffULL) )
+			return 0;
+	}
+
+	*val = (int) (unsigned int) (negative ? 0ULL - v : v);
+	return 1;
+}
+
+/*
+ * Walk the elements of the list text[0..len), which starts just after the
+ * opening bracket and ends at the closing one.  Each element is passed to
+ * visit() (when not NULL) trimmed of white space.  Returns the number of
+ * elements, or -1 if one of them is not an integer.
+ */
+static long array_scan( const char *text, size_t len, void (*visit)( void *ctx, const char *elem, size_t elen ), void *ctx )
+{
+	long	count = 0;
+	size_t	pos = 0;
+
+	while ( pos < len )
+	{
+		size_t	start, end;
+		int		val;
+
+		while ( pos < len && array_is_space( text[pos] ) )
+			pos++;
+		if ( pos == len )
+			break;
+
+		start = pos;
+		while ( pos < len && ARRAY_SEP != text[pos] )
+			pos++;
+		end = pos;
+		while ( end > start && array_is_space( text[end - 1] ) )
+			end--;
+
+		if ( ! config_array_parse_int( text + start, end - start, &val ) )
+			return -1;
+		if ( visit )
+			visit( ctx, text + start, end - start );
+		count++;
+
+		if ( pos < len )
+			pos++;	/* separator; a trailing one is allowed */
+	}
+	return count;
+}
+
+typedef struct {
+	char	*out;
+	size_t	pos;
+	int		first;
+} array_emit_t;
+
+static void array_emit( void *ctx, const char *elem, size_t elen )
+{
+	array_emit_t *emit = ctx;
+
+	if ( ! emit->first )
+		emit->out[emit->pos++] = ARRAY_SEP;
+	memcpy( emit->out + emit->pos, elem, elen );
+	emit->pos += elen;
+	emit->first = 0;
+}
+
+static void array_store( void *ctx, const char *elem, size_t elen )
+{
+	config_array_t *array = ctx;
+
+	config_array_parse_int( elem, elen, &array->values[array->count++] );
+}
+
+/* Release node_ref's decoded vector; it stays an array unless untype is set. */
+static void array_free( config_ref_t node_ref, int untype )
+{
+	unsigned long array;
+
+	if ( ! config_refmap_get( &array_nodes, node_ref, &array ) )
+		return;
+
+	if ( array )
+		CONFIG_FREE( (config_array_t *) array );
+	if ( untype )
+		config_refmap_del( &array_nodes, node_ref );
+	else if ( array )
+		config_refmap_put( &array_nodes, node_ref, 0 );
+}
+
+static void array_free_tree( config_ref_t root_ref, int untype )
+{
+	config_ref_t child;
+
+	array_free( root_ref, untype );
+	for ( child = htuple_first_child( root_ref ); child; child = htuple_next_sibling( child ) )
+		array_free_tree( child, untype );
+}
+
+/* Record the nodes below node_ref whose values a rewritten list became, until *left of them are found. */
+static config_result_t array_find_tagged( config_ref_t node_ref, unsigned int *left )
+{
+	config_ref_t	child;
+	config_result_t	err = CONFIG_SUCCESS;
+	const char		*str;
+
+	for ( child = htuple_first_child( node_ref ); child && *left && CONFIG_SUCCESS == err; child = htuple_next_sibling( child ) )
+	{
+		if ( CONFIG_SUCCESS == htuple_node_str_value( child, &str ) && ARRAY_TAG == str[0] )
+		{
+			err = config_refmap_put( &array_nodes, child, 0 );
+			(*left)--;
+		}
+		if ( CONFIG_SUCCESS == err )
+			err = array_find_tagged( child, left );
+	}
+	return err;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_array_rewrite( const char *data, size_t len, char **out, size_t *out_len, unsigned int *lists )
+{
+	array_emit_t	emit;
+	size_t			pos, skip, opens = 0;
+	int				in_string = 0;
+
+	*out = NULL;
+	*lists = 0;
+
+	for ( pos = 0; pos < len; pos++ )
+		if ( ARRAY_OPEN == data[pos] )
+			opens++;
+	if ( 0 == opens )
+		return CONFIG_SUCCESS;
+
+	/* each list gains two quotes and the tag, and never grows otherwise */
+	if ( NULL == (emit.out = CONFIG_ALLOC( len + 3 * opens + 1 )) )
+		return CONFIG_ERR_NO_RESOURCES;
+	emit.pos = 0;
+
+	for ( pos = 0; pos < len; pos++ )
+	{
+		char c = data[pos];
+
+		if ( ! in_string && 0 != (skip = array_comment_len( data + pos, len - pos )) )
+		{
+			/* a quote or a list in a comment is not one */
+			memcpy( emit.out + emit.pos, data + pos, skip );
+			emit.pos += skip;
+			pos += skip - 1;
+			continue;
+		}
+
+		emit.out[emit.pos++] = c;
+
+		if ( in_string )
+		{
+			if ( '\\' == c && pos + 1 < len )
+				emit.out[emit.pos++] = data[++pos];
+			else if ( '"' == c )
+				in_string = 0;
+		}
+		else if ( '"' == c )
+		{
+			/* the tag marks the lists rewritten here, and nothing else */
+			if ( pos + 1 < len && ARRAY_TAG == data[pos + 1] )
+			{
+				CONFIG_FREE( emit.out );
+				return CONFIG_ERR_INVALID_REFERENCE;
+			}
+			in_string = 1;
+		}
+		else if ( '=' == c )
+		{
+			size_t open = pos + 1, close;
+
+			while ( open < len && array_is_space( data[open] ) )
+				open++;
+			if ( open == len || ARRAY_OPEN != data[open] )
+				continue;
+			for ( close = open + 1; close < len && ARRAY_CLOSE != data[close]; close++ )
+				;
+			/* leave anything that is not a list of integers for htuple to reject */
+			if ( close == len || array_scan( data + open + 1, close - open - 1, NULL, NULL ) < 0 )
+				continue;
+
+			emit.out[emit.pos++] = '"';
+			emit.out[emit.pos++] = ARRAY_TAG;
+			emit.out[emit.pos++] = ARRAY_OPEN;
+			emit.first = 1;
+			array_scan( data + open + 1, close - open - 1, array_emit, &emit );
+			emit.out[emit.pos++] = ARRAY_CLOSE;
+			emit.out[emit.pos++] = '"';
+			pos = close;
+			(*lists)++;
+		}
+	}
+
+	emit.out[emit.pos] = '\0';
+	*out = emit.out;
+	*out_len = emit.pos;
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_array_loaded( config_ref_t root_ref, unsigned int lists )
+{
+	return lists ? array_find_tagged( root_ref, &lists ) : CONFIG_SUCCESS;
+}
+
+int config_array_is( config_ref_t node_ref )
+{
+	return array_nodes.count && config_refmap_get( &array_nodes, node_ref, NULL );
+}
+
+int config_array_present( void )
+{
+	return 0 != array_nodes.count;
+}
+
+config_result_t config_array_mark( config_ref_t parent_ref, const char *name, size_t len, int is_array )
+{
+	config_ref_t node_ref;
+
+	if ( ! is_array && 0 == array_nodes.count )
+		return CONFIG_SUCCESS;
+	if ( 0 == (node_ref = htuple_find_child( parent_ref, name, len )) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	array_free( node_ref, 1 );
+	return is_array ? config_refmap_put( &array_nodes, node_ref, 0 ) : CONFIG_SUCCESS;
+}
+
+config_result_t config_array_get( config_ref_t node_ref, const int **values, unsigned int *count )
+{
+	config_array_t	*array;
+	unsigned long	cached;
+	const char		*str;
+	size_t			len;
+	long			n;
+
+	if ( ! config_array_is( node_ref ) )
+		return CONFIG_ERR_NOT_FOUND;
+
+	config_refmap_get( &array_nodes, node_ref, &cached );
+	if ( cached )
+	{
+		array = (config_array_t *) cached;
+		*values = array->values;
+		*count = array->count;
+		return CONFIG_SUCCESS;
+	}
+
+	if ( CONFIG_SUCCESS != htuple_node_str_value( node_ref, &str ) || ARRAY_TAG != str[0] )
+		return CONFIG_ERR_NOT_FOUND;
+
+	len = strlen( ++str );
+	if ( len < 2 || ARRAY_OPEN != str[0] || ARRAY_CLOSE != str[len - 1] )
+		return CONFIG_ERR_NOT_FOUND;
+	if ( (n = array_scan( str + 1, len - 2, NULL, NULL )) < 0 )
+		return CONFIG_ERR_NOT_FOUND;
+
+	if ( NULL == (array = CONFIG_ALLOC( sizeof(*array) + n * sizeof(array->values[0]) )) )
+		return CONFIG_ERR_NO_RESOURCES;
+	array->count = 0;
+	array_scan( str + 1, len - 2, array_store, array );
+
+	if ( CONFIG_SUCCESS != config_refmap_put( &array_nodes, node_ref, (unsigned long) array ) )
+	{
+		CONFIG_FREE( array );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	*values = array->values;
+	*count = array->count;
+	return CONFIG_SUCCESS;
+}
+
+const char *config_array_list( config_ref_t node_ref )
+{
+	const char *str;
+
+	if ( ! config_array_is( node_ref ) || CONFIG_SUCCESS != htuple_node_str_value( node_ref, &str ) || ARRAY_TAG != str[0] )
+		return NULL;
+	return str + 1;
+}
+
+void config_array_invalidate( config_ref_t node_ref )
+{
+	if ( array_nodes.count )
+		array_free( node_ref, 1 );
+}
+
+void config_array_forget( config_ref_t root_ref )
+{
+	if ( array_nodes.count )
+		array_free_tree( root_ref, 0 );
+}
+
+void config_array_deleted( config_ref_t root_ref )
+{
+	if ( array_nodes.count )
+		array_free_tree( root_ref, 1 );
+}
+
+void config_array_flush( void )
+{
+	unsigned int	pos = 0;
+	config_ref_t	node_ref;
+	unsigned long	array;
+
+	while ( config_refmap_next( &array_nodes, &pos, &node_ref, &array ) )
+	{
+		if ( array )
+		{
+			CONFIG_FREE( (config_array_t *) array );
+			config_refmap_put( &array_nodes, node_ref, 0 );
+		}
+	}
+}
+
+void config_array_deinit( void )
+{
+	config_array_flush();
+	config_refmap_free( &array_nodes );
+}
@@ -0,0 +1,180 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Positional child access.
+ *
+ * htuple keeps a node's children in a linked list, so reaching the k-th
+ * entry of an ordered list (the actions of a startup block, say) takes k
+ * sibling steps, and k ioctls from userspace.  The first positional read of
+ * a node collects its children, in enumeration order, into a vector that is
+ * kept until the node's children change; reads after that index it
+ * directly, and the count is the vector's length.
+ *
+ * A vector belongs to the node whose children it lists, so aliases of a
+ * shared subtree and a node a staged tree was published to use the vector
+ * of what they present.  While layers are pushed or namespaces exist, what
+ * a node presents depends on the caller, so no vector is kept and each read
+ * walks the list.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+typedef struct {
+	unsigned int	count;
+	config_ref_t	children[1];
+} config_children_t;
+
+/* node reference -> config_children_t * */
+static config_refmap_t children_cache;
+
+static void children_free( config_ref_t node_ref )
+{
+	unsigned long vec;
+
+	if ( config_refmap_get( &children_cache, node_ref, &vec ) )
+	{
+		config_refmap_del( &children_cache, node_ref );
+		CONFIG_FREE( (config_children_t *) vec );
+	}
+}
+
+/* node_ref's vector, built on first use.  NULL if none can be kept. */
+static config_children_t *children_vector( config_ref_t node_ref )
+{
+	config_children_t	*vec;
+	unsigned long		cached;
+	unsigned int		n = 0;
+	config_ref_t		child;
+
+	if ( config_overlay_active() )
+		return NULL;
+
+	node_ref = config_dedup_redirect( node_ref );
+	if ( config_refmap_get( &children_cache, node_ref, &cached ) )
+		return (config_children_t *) cached;
+
+	for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+		n++;
+	if ( NULL == (vec = CONFIG_ALLOC( sizeof(*vec) + n * sizeof(vec->children[0]) )) )
+		return NULL;
+	vec->count = 0;
+	for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+		vec->children[vec->count++] = child;
+
+	if ( CONFIG_SUCCESS != config_refmap_put( &children_cache, node_ref, (unsigned long) vec ) )
+	{
+		CONFIG_FREE( vec );
+		return NULL;
+	}
+	return vec;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+unsigned int config_children_count( config_ref_t node_ref )
+{
+	config_children_t	*vec = children_vector( node_ref );
+	unsigned int		n = 0;
+	config_ref_t		child;
+
+	if ( vec )
+		return vec->count;
+
+	for ( child = config_overlay_first_child( node_ref ); child; child = config_overlay_next_sibling( child ) )
+		n++;
+	return n;
+}
+
+config_ref_t config_children_at( config_ref_t node_ref, unsigned int index )
+{
+	config_children_t	*vec = children_vector( node_ref );
+	config_ref_t		child;
+
+	if ( vec )
+		return (index < vec->count) ? vec->children[index] : 0;
+
+	for ( child = config_overlay_first_child( node_ref ); child && index; child = config_overlay_next_sibling( child ) )
+		index--;
+	return child;
+}
+
+void config_children_invalidate( config_ref_t node_ref )
+{
+	if ( children_cache.count )
+		children_free( config_dedup_redirect( node_ref ) );
+}
+
+void config_children_flush( void )
+{
+	unsigned int	pos = 0;
+	config_ref_t	node_ref;
+	unsigned long	vec;
+
+	while ( config_refmap_next( &children_cache, &pos, &node_ref, &vec ) )
+		CONFIG_FREE( (config_children_t *) vec );
+	config_refmap_free( &children_cache );
+}
@@ -0,0 +1,461 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Subtree deduplication (hash-consing).
+ *
+ * When enabled, every config_load() is followed by a scan of the loaded
+ * subtree.  An interior node whose children are structurally identical to
+ * those of a node already in the database becomes an alias: its htuple
+ * children are released and lookups through it are redirected to the
+ * canonical copy.  The node itself, with its own name and value, stays put.
+ *
+ * Sharing is copy-on-write.  Writing through an alias first gives the alias
+ * a private copy of the canonical children; writing inside a canonical
+ * subtree first moves the unchanged content to one of its aliases, which
+ * becomes the canonical copy for the rest.  Either way exactly one copy is
+ * made.  Writers reach these hooks through config_resolve() and
+ * config_dedup_own().
+ *
+ * A reference names one node, and the canonical nodes belong to the place
+ * they were loaded at, so no reference below an alias may leave the core:
+ * writes through it would land in the canonical copy.  Finding, enumerating,
+ * querying or walking below an alias therefore materializes it first
+ * (config_dedup_unalias()).  Reads by path, hashing and export go through
+ * the redirect and keep the subtree shared.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+static int					dedup_enabled;
+static config_refmap_t		dedup_alias;		/* alias -> canonical root */
+static config_refmap_t		dedup_canonical;	/* canonical root -> number of aliases */
+static config_refmap_t		dedup_members;		/* node in a canonical subtree -> canonical root */
+static config_refmap_t		dedup_candidates;	/* content signature -> node */
+static config_refmap_t		dedup_candidate_sig;	/* node -> its signature in dedup_candidates */
+static unsigned int			dedup_nodes_saved;
+static unsigned int			dedup_copies;
+
+static unsigned int dedup_mix( unsigned int h, const void *data, size_t len )
+{
+	const unsigned char *p = data;
+
+	while ( len-- )
+	{
+		h ^= *p++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void dedup_unsave( unsigned int nodes )
+{
+	dedup_nodes_saved -= (nodes < dedup_nodes_saved) ? nodes : dedup_nodes_saved;
+}
+
+/* Mark (or unmark, root_ref == 0) every node of a canonical subtree. */
+static void dedup_mark_members( config_ref_t node_ref, config_ref_t root_ref )
+{
+	config_ref_t child;
+
+	if ( root_ref )
+		config_refmap_put( &dedup_members, node_ref, root_ref );
+	else
+		config_refmap_del( &dedup_members, node_ref );
+
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		dedup_mark_members( child, root_ref );
+}
+
+static void dedup_add_alias( config_ref_t alias_ref, config_ref_t canonical_ref )
+{
+	unsigned long count = 0;
+
+	config_refmap_put( &dedup_alias, alias_ref, canonical_ref );
+	if ( ! config_refmap_get( &dedup_canonical, canonical_ref, &count ) )
+		dedup_mark_members( canonical_ref, canonical_ref );
+	config_refmap_put( &dedup_canonical, canonical_ref, count + 1 );
+}
+
+static void dedup_drop_alias( config_ref_t alias_ref )
+{
+	unsigned long canonical, count;
+
+	if ( ! config_refmap_get( &dedup_alias, alias_ref, &canonical ) )
+		return;
+
+	config_refmap_del( &dedup_alias, alias_ref );
+	config_refmap_get( &dedup_canonical, canonical, &count );
+	if ( --count )
+		config_refmap_put( &dedup_canonical, canonical, count );
+	else
+	{
+		config_refmap_del( &dedup_canonical, canonical );
+		dedup_mark_members( canonical, 0 );
+	}
+}
+
+/* Give an alias its own copy of the canonical children. */
+static void dedup_materialize( config_ref_t alias_ref )
+{
+	config_ref_t	canonical = config_dedup_redirect( alias_ref );
+
+	dedup_drop_alias( alias_ref );
+	dedup_unsave( config_tree_copy( alias_ref, canonical ) );
+	dedup_copies++;
+}
+
+/* A canonical subtree is about to change: hand its current content to one alias and point the others there. */
+static void dedup_unshare( config_ref_t canonical_ref )
+{
+	unsigned int	pos = 0;
+	config_ref_t	alias, heir = 0;
+	unsigned long	target, moved = 0;
+
+	while ( 0 == heir && config_refmap_next( &dedup_alias, &pos, &alias, &target ) )
+		if ( (config_ref_t) target == canonical_ref )
+			heir = alias;
+	if ( 0 == heir )
+		return;
+	dedup_materialize( heir );
+
+	/* repointing updates keys in place, so one pass over the map finds every other alias */
+	for ( pos = 0; config_refmap_next( &dedup_alias, &pos, &alias, &target ); )
+	{
+		if ( (config_ref_t) target != canonical_ref )
+			continue;
+		config_refmap_put( &dedup_alias, alias, heir );
+		moved++;
+	}
+	if ( 0 == moved )
+		return;
+
+	config_refmap_del( &dedup_canonical, canonical_ref );
+	dedup_mark_members( canonical_ref, 0 );
+	config_refmap_put( &dedup_canonical, heir, moved );
+	dedup_mark_members( heir, heir );
+}
+
+/* Drop node_ref from the candidates a later scan could share with. */
+static void dedup_drop_candidate( config_ref_t node_ref )
+{
+	unsigned long sig, candidate;
+
+	if ( ! config_refmap_get( &dedup_candidate_sig, node_ref, &sig ) )
+		return;
+	if ( config_refmap_get( &dedup_candidates, sig, &candidate ) && (config_ref_t) candidate == node_ref )
+		config_refmap_del( &dedup_candidates, sig );
+	config_refmap_del( &dedup_candidate_sig, node_ref );
+}
+
+static void dedup_forget_candidates( config_ref_t node_ref )
+{
+	config_ref_t child;
+
+	if ( 0 == dedup_candidate_sig.count )
+		return;
+
+	dedup_drop_candidate( node_ref );
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		dedup_forget_candidates( child );
+}
+
+/* Children of a and b are identical, and neither side contains shared state or nodes on their way out. */
+static int dedup_equal( config_ref_t a, config_ref_t b )
+{
+	config_ref_t ca = htuple_first_child( a ), cb = htuple_first_child( b );
+
+	while ( ca && cb )
+	{
+		const char	*na, *nb, *sa, *sb;
+		int			ia, ib, has_ia, has_ib, has_sa, has_sb;
+
+		if ( config_refmap_get( &dedup_alias, ca, NULL ) || config_refmap_get( &dedup_alias, cb, NULL ) ||
+			 config_refmap_get( &dedup_canonical, ca, NULL ) || config_refmap_get( &dedup_canonical, cb, NULL ) ||
+			 config_epoch_retired( ca ) || config_epoch_retired( cb ) || config_stage_hidden( ca ) || config_stage_hidden( cb ) )
+			return 0;
+
+		if ( CONFIG_SUCCESS != htuple_node_name( ca, &na ) || CONFIG_SUCCESS != htuple_node_name( cb, &nb ) || strcmp( na, nb ) )
+			return 0;
+
+		has_ia = (CONFIG_SUCCESS == htuple_node_int_value( ca, &ia ));
+		has_ib = (CONFIG_SUCCESS == htuple_node_int_value( cb, &ib ));
+		if ( has_ia != has_ib || (has_ia && ia != ib) )
+			return 0;
+
+		has_sa = (CONFIG_SUCCESS == htuple_node_str_value( ca, &sa ));
+		has_sb = (CONFIG_SUCCESS == htuple_node_str_value( cb, &sb ));
+		if ( has_sa != has_sb || (has_sa && strcmp( sa, sb )) || config_array_is( ca ) != config_array_is( cb ) )
+			return 0;
+
+		if ( ! dedup_equal( ca, cb ) )
+			return 0;
+
+		ca = htuple_next_sibling( ca );
+		cb = htuple_next_sibling( cb );
+	}
+	return ca == cb;
+}
+
+/* Post-order pass: record the content signature of every interior node under node_ref. */
+static unsigned int dedup_signature( config_ref_t node_ref, config_refmap_t *sigs )
+{
+	unsigned int	h = 2166136261u;
+	config_ref_t	child;
+	unsigned long	target;
+
+	if ( config_refmap_get( &dedup_alias, node_ref, &target ) )
+		return dedup_mix( h, &target, sizeof(target) );
+
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+	{
+		const char		*name, *str;
+		int				ival;
+		unsigned int	sub;
+
+		if ( CONFIG_SUCCESS == htuple_node_name( child, &name ) )
+			h = dedup_mix( h, name, strlen( name ) + 1 );
+		if ( CONFIG_SUCCESS == htuple_node_int_value( child, &ival ) )
+			h = dedup_mix( h, &ival, sizeof(ival) );
+		else if ( CONFIG_SUCCESS == htuple_node_str_value( child, &str ) )
+			h = dedup_mix( h, str, strlen( str ) + 1 );
+
+		sub = dedup_signature( child, sigs );
+		h = dedup_mix( h, &sub, sizeof(sub) );
+	}
+
+	if ( htuple_first_child( node_ref ) )
+		config_refmap_put( sigs, node_ref, h );
+	return h;
+}
+
+/* Replace the children of node_ref by a reference to canonical_ref. */
+static void dedup_share( config_ref_t node_ref, config_ref_t canonical_ref )
+{
+	config_ref_t child = htuple_first_child( node_ref );
+
+	while ( child )
+	{
+		config_ref_t next = htuple_next_sibling( child );
+
+		dedup_nodes_saved += 1 + config_tree_count( child );
+		dedup_forget_candidates( child );
+		config_cache_forget( child );
+		config_array_deleted( child );
+		htuple_delete_private_tree( child );
+		child = next;
+	}
+	dedup_add_alias( node_ref, canonical_ref );
+}
+
+/* Pre-order pass: share the largest duplicated subtrees first, remember the rest as candidates. */
+static void dedup_scan( config_ref_t node_ref, config_refmap_t *sigs )
+{
+	unsigned long	sig, candidate;
+	config_ref_t	child;
+
+	/* removed and staged subtrees are not in the database, so nothing may share with them */
+	if ( ! config_refmap_get( sigs, node_ref, &sig ) || config_epoch_retired( node_ref ) || config_stage_hidden( node_ref ) )
+		return;
+
+	if ( ! config_refmap_get( &dedup_members, node_ref, NULL ) &&
+		 ! config_refmap_get( &dedup_alias, node_ref, NULL ) &&
+		 config_refmap_get( &dedup_candidates, sig, &candidate ) &&
+		 (config_ref_t) candidate != node_ref &&
+		 ! config_refmap_get( &dedup_alias, candidate, NULL ) &&
+		 ( ! config_refmap_get( &dedup_members, candidate, NULL ) || config_refmap_get( &dedup_canonical, candidate, NULL ) ) &&
+		 dedup_equal( node_ref, candidate ) )
+	{
+		dedup_share( node_ref, candidate );
+		return;
+	}
+
+	/* a candidate's signature is kept with it, so that it can be dropped when the node goes */
+	dedup_drop_candidate( node_ref );
+	if ( ! config_refmap_get( &dedup_candidates, sig, &candidate ) )
+		candidate = 0;
+	if ( CONFIG_SUCCESS == config_refmap_put( &dedup_candidate_sig, node_ref, sig ) )
+	{
+		if ( CONFIG_SUCCESS != config_refmap_put( &dedup_candidates, sig, node_ref ) )
+			config_refmap_del( &dedup_candidate_sig, node_ref );
+		else if ( candidate )
+			config_refmap_del( &dedup_candidate_sig, candidate );
+	}
+
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		dedup_scan( child, sigs );
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_ref_t config_dedup_redirect( config_ref_t node_ref )
+{
+	unsigned long target;
+
+	node_ref = config_stage_forward( node_ref );
+	if ( config_refmap_get( &dedup_alias, node_ref, &target ) )
+		return (config_ref_t) target;
+	return node_ref;
+}
+
+config_ref_t config_dedup_own( config_ref_t node_ref )
+{
+	unsigned long root;
+
+	/* writes through a node a staged tree was published to land in that tree */
+	node_ref = config_stage_forward( node_ref );
+	if ( config_refmap_get( &dedup_alias, node_ref, NULL ) )
+		dedup_materialize( node_ref );
+	else if ( config_refmap_get( &dedup_members, node_ref, &root ) )
+		dedup_unshare( (config_ref_t) root );
+
+	return node_ref;
+}
+
+void config_dedup_unalias( config_ref_t node_ref )
+{
+	if ( 0 == dedup_alias.count )
+		return;
+
+	node_ref = config_stage_forward( node_ref );
+	if ( config_refmap_get( &dedup_alias, node_ref, NULL ) )
+		dedup_materialize( node_ref );
+}
+
+void config_dedup_forget( config_ref_t root_ref )
+{
+	unsigned long	canonical;
+	config_ref_t	child;
+
+	if ( 0 == dedup_alias.count )
+	{
+		dedup_forget_candidates( root_ref );
+		return;
+	}
+	dedup_drop_candidate( root_ref );
+
+	if ( config_refmap_get( &dedup_alias, root_ref, &canonical ) )
+	{
+		dedup_unsave( config_tree_count( (config_ref_t) canonical ) );
+		dedup_drop_alias( root_ref );
+	}
+	else if ( config_refmap_get( &dedup_members, root_ref, &canonical ) )
+		dedup_unshare( (config_ref_t) canonical );
+
+	for ( child = htuple_first_child( root_ref ); child; child = htuple_next_sibling( child ) )
+		config_dedup_forget( child );
+}
+
+void config_dedup_loaded( config_ref_t base_ref )
+{
+	config_refmap_t	sigs;
+	config_ref_t	child;
+
+	if ( ! dedup_enabled )
+		return;
+
+	memset( &sigs, 0, sizeof(sigs) );
+	dedup_signature( base_ref, &sigs );
+
+	/* the load target itself is never replaced, only what was loaded into it */
+	for ( child = htuple_first_child( base_ref ); child; child = htuple_next_sibling( child ) )
+		dedup_scan( child, &sigs );
+
+	config_refmap_free( &sigs );
+}
+
+void config_dedup_deinit( void )
+{
+	config_refmap_free( &dedup_alias );
+	config_refmap_free( &dedup_canonical );
+	config_refmap_free( &dedup_members );
+	config_refmap_free( &dedup_candidates );
+	config_refmap_free( &dedup_candidate_sig );
+	dedup_nodes_saved = 0;
+	dedup_copies = 0;
+}
+
+void config_dedup_set_enabled( int enable )
+{
+	dedup_enabled = enable;
+	if ( ! enable )
+		config_refmap_free( &dedup_candidates );
+	config_refmap_free( &dedup_candidate_sig );
+}
+
+int config_dedup_active( void )
+{
+	return 0 != dedup_alias.count;
+}
+
+void config_dedup_get_stats( config_dedup_stats_t *stats )
+{
+	stats->enabled = dedup_enabled;
+	stats->canonical = dedup_canonical.count;
+	stats->aliases = dedup_alias.count;
+	stats->nodes_saved = dedup_nodes_saved;
+	stats->copies = dedup_copies;
+}
@@ -0,0 +1,305 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Epoch-based deferred reclamation of removed subtrees.
+ *
+ * A caller that keeps node references across API calls brackets that use
+ * with config_epoch_enter()/config_epoch_exit().  Removing a subtree then
+ * "retires" it instead of deleting it: the core forgets everything it has
+ * cached about the subtree and hides its root from every lookup and
+ * enumeration at once, but the htuple nodes, and with them the references
+ * a reader may still hold, stay valid until every reader that could have
+ * seen them has left.
+ *
+ * This is the usual three-epoch scheme.  Readers are counted against the
+ * global epoch they entered in, which can be the current one or the one
+ * before it.  The epoch advances only once nobody is left in the previous
+ * one, so whatever was retired two epochs before the new one can no longer
+ * be reached and is deleted.  Retired roots are kept per epoch and the epoch
+ * is only pushed forward once CONFIG_EPOCH_BATCH of them have piled up (or
+ * when something needs them gone), so deletions run in batches.  Lists are
+ * reclaimed in the order they were retired, so a subtree removed from
+ * inside an already retired one is deleted before its ancestor is.
+ *
+ * htuple cannot unlink a node without deleting it, and writes create nodes
+ * by name, so a write that would recreate a retired name first forces
+ * reclamation.  If a reader still pins the retired subtree, its root is
+ * brought back instead: each of its children is retired on its own, so
+ * readers keep them, and the root itself stops being hidden and takes the
+ * write.  A retired root that is brought back is skipped when its list is
+ * reclaimed; the retirement epoch kept with it tells a stale list entry
+ * from a later retirement of the same node.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+#define EPOCH_SLOTS				3
+
+/* Retired subtrees collected before the epoch is pushed forward */
+#define CONFIG_EPOCH_BATCH		32
+
+typedef struct {
+	config_ref_t	*roots;
+	unsigned int	count;
+	unsigned int	capacity;
+} epoch_list_t;
+
+static unsigned int		epoch_current;
+static unsigned int		epoch_readers[EPOCH_SLOTS];		/* readers by entry epoch, mod 3 */
+static epoch_list_t		epoch_lists[EPOCH_SLOTS];		/* roots by retirement epoch, mod 3 */
+static config_refmap_t	epoch_retired;					/* retired root -> epoch it was retired in */
+
+static void epoch_delete( config_ref_t root_ref )
+{
+	/* pinned readers may have had the core learn about the subtree again */
+	config_dedup_forget( root_ref );
+	config_cache_forget( root_ref );
+	config_array_deleted( root_ref );
+	htuple_delete_private_tree( root_ref );
+}
+
+static void epoch_reclaim_list( epoch_list_t *list, unsigned int epoch )
+{
+	unsigned long	retired;
+	unsigned int	i;
+
+	for ( i = 0; i < list->count; i++ )
+	{
+		/* brought back since, and maybe retired again later */
+		if ( ! config_refmap_get( &epoch_retired, list->roots[i], &retired ) || retired != epoch )
+			continue;
+		config_refmap_del( &epoch_retired, list->roots[i] );
+		epoch_delete( list->roots[i] );
+	}
+	list->count = 0;
+}
+
+/* Move to the next epoch if nobody is left in the previous one.  Returns 0 if readers are in the way. */
+static int epoch_advance( void )
+{
+	if ( epoch_readers[(epoch_current + EPOCH_SLOTS - 1) % EPOCH_SLOTS] )
+		return 0;
+
+	epoch_current++;
+	/* the slot about to take new retirements holds those from two epochs back */
+	epoch_reclaim_list( &epoch_lists[(epoch_current + 1) % EPOCH_SLOTS], epoch_current - 2 );
+	return 1;
+}
+
+/* Delete every retired subtree no reader can still see. */
+static void epoch_reclaim( void )
+{
+	unsigned int i;
+
+	for ( i = 0; i < EPOCH_SLOTS && epoch_retired.count; i++ )
+		if ( ! epoch_advance() )
+			break;
+}
+
+/* Make room for one more root, so that the add that follows cannot fail. */
+static config_result_t epoch_list_reserve( epoch_list_t *list )
+{
+	config_ref_t	*grown;
+	unsigned int	capacity;
+
+	if ( list->count < list->capacity )
+		return CONFIG_SUCCESS;
+
+	capacity = list->capacity ? list->capacity * 2 : CONFIG_EPOCH_BATCH;
+	if ( NULL == (grown = CONFIG_ALLOC_LARGE( capacity * sizeof(*grown) )) )
+		return CONFIG_ERR_NO_RESOURCES;
+	if ( list->roots )
+	{
+		memcpy( grown, list->roots, list->count * sizeof(*grown) );
+		CONFIG_FREE_LARGE( list->roots );
+	}
+	list->roots = grown;
+	list->capacity = capacity;
+	return CONFIG_SUCCESS;
+}
+
+/* A write is reusing the name of root_ref, which readers still pin: retire its children instead and unhide it. */
+static config_result_t epoch_revive( config_ref_t root_ref )
+{
+	config_ref_t	child, next;
+	config_result_t	err;
+
+	for ( child = htuple_first_child( root_ref ); child; child = next )
+	{
+		next = htuple_next_sibling( child );
+		if ( ! config_epoch_retired( child ) && CONFIG_SUCCESS != (err = config_epoch_retire( child )) )
+			return err;
+	}
+	config_refmap_del( &epoch_retired, root_ref );
+	return CONFIG_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+unsigned int config_epoch_pin( void )
+{
+	epoch_readers[epoch_current % EPOCH_SLOTS]++;
+	return epoch_current;
+}
+
+config_result_t config_epoch_unpin( unsigned int epoch )
+{
+	unsigned int *readers = &epoch_readers[epoch % EPOCH_SLOTS];
+
+	/* a live ticket is from the current epoch or the one before */
+	if ( (epoch != epoch_current && epoch + 1 != epoch_current) || 0 == *readers )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	if ( 0 == --*readers && epoch_retired.count )
+		epoch_advance();
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_epoch_retire( config_ref_t root_ref )
+{
+	epoch_list_t	*list = &epoch_lists[epoch_current % EPOCH_SLOTS];
+	const char		*name;
+
+	if ( CONFIG_SUCCESS != htuple_node_name( root_ref, &name ) || config_epoch_retired( root_ref ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	/* room for the record is made first: past this point the retirement cannot fail, so a failed one forgets nothing */
+	if ( CONFIG_SUCCESS != config_refmap_reserve( &epoch_retired, 1 ) || CONFIG_SUCCESS != epoch_list_reserve( list ) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	/* nothing may hand out references to the subtree from now on; aliases are unshared while it is still visible */
+	config_dedup_forget( root_ref );
+	config_cache_forget( root_ref );
+
+	/* a reader may be inside the subtree, so it cannot be deleted here instead */
+	config_refmap_put( &epoch_retired, root_ref, epoch_current );
+	list->roots[list->count++] = root_ref;
+
+	if ( list->count >= CONFIG_EPOCH_BATCH )
+		epoch_advance();
+	return CONFIG_SUCCESS;
+}
+
+int config_epoch_retired( config_ref_t node_ref )
+{
+	return epoch_retired.count && config_refmap_get( &epoch_retired, node_ref, NULL );
+}
+
+config_result_t config_epoch_claim( config_ref_t parent_ref, const char *name, size_t len )
+{
+	config_ref_t	child;
+	config_result_t	err;
+	size_t			start, end;
+
+	if ( 0 == epoch_retired.count && ! config_stage_hiding() )
+		return CONFIG_SUCCESS;
+
+	/* htuple creates or reuses every component of a dotted name */
+	for ( start = 0; start < len; start = end + 1 )
+	{
+		for ( end = start; end < len && CONFIG_PATH_SEPARATOR != name[end]; end++ )
+			;
+		if ( 0 == (child = htuple_find_child( parent_ref, name + start, end - start )) )
+			return CONFIG_SUCCESS;
+		/* content moved away from here still sits under the name: copy it out first */
+		if ( config_stage_hidden( child ) && CONFIG_SUCCESS != config_stage_evict( child ) )
+			return CONFIG_ERR_NO_RESOURCES;
+		if ( config_epoch_retired( child ) )
+		{
+			epoch_reclaim();
+			if ( 0 == (child = htuple_find_child( parent_ref, name + start, end - start )) )
+				return CONFIG_SUCCESS;
+			if ( config_epoch_retired( child ) && CONFIG_SUCCESS != (err = epoch_revive( child )) )
+				return err;
+		}
+		parent_ref = child;
+	}
+	return CONFIG_SUCCESS;
+}
+
+int config_epoch_lingering( void )
+{
+	if ( epoch_retired.count )
+		epoch_reclaim();
+	return 0 != epoch_retired.count;
+}
+
+void config_epoch_deinit( void )
+{
+	unsigned int i;
+
+	/* htuple_deinitialize() takes the retired trees with everything else */
+	for ( i = 0; i < EPOCH_SLOTS; i++ )
+	{
+		if ( epoch_lists[i].roots )
+			CONFIG_FREE_LARGE( epoch_lists[i].roots );
+		memset( &epoch_lists[i], 0, sizeof(epoch_lists[i]) );
+		epoch_readers[i] = 0;
+	}
+	config_refmap_free( &epoch_retired );
+	epoch_current = 0;
+}
@@ -0,0 +1,235 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Flat update format: one "dotted.path = value" per line, where value is an
+ * integer (decimal or 0x-prefixed) or a double-quoted string with \" \\ \n
+ * and \t escapes.  Blank lines and lines starting with '#' are skipped:
+ *
+ *     # provisioning
+ *     platform.software.drivers.sven.debug_level = 3
+ *     platform.software.drivers.sven.name = "sven"
+ *
+ * The whole text is parsed before anything is applied, so a malformed line
+ * leaves the database untouched.  The parsed updates are sorted by path,
+ * which puts every update below a given node next to each other; the core
+ * then resolves each shared ancestor once for the whole run of updates.
+ */
+
+#include "platform_config_core_private.h"
+
+static int flat_space( char c )
+{
+	return ' ' == c || '\t' == c || '\r' == c;
+}
+
+/* Parse the line [p, end) into *entry, copying path and string into *out.  Returns 0 if it is malformed. */
+static int flat_line( const char *p, const char *end, char **out, config_flat_entry_t *entry )
+{
+	const char	*path, *path_end, *value;
+	char		*o = *out;
+	size_t		i;
+
+	path = p;
+	while ( p < end && ! flat_space( *p ) && '=' != *p )
+		p++;
+	path_end = p;
+	while ( p < end && flat_space( *p ) )
+		p++;
+	if ( p == end || '=' != *p++ )
+		return 0;
+	while ( p < end && flat_space( *p ) )
+		p++;
+	while ( end > p && flat_space( end[-1] ) )
+		end--;
+
+	/* no empty components */
+	if ( path == path_end || CONFIG_PATH_SEPARATOR == *path || CONFIG_PATH_SEPARATOR == path_end[-1] )
+		return 0;
+	for ( i = 1; path + i < path_end; i++ )
+		if ( CONFIG_PATH_SEPARATOR == path[i] && CONFIG_PATH_SEPARATOR == path[i - 1] )
+			return 0;
+
+	memcpy( o, path, path_end - path );
+	o[path_end - path] = '\0';
+	entry->path = o;
+	o += path_end - path + 1;
+
+	if ( p < end && '"' == *p )
+	{
+		value = o;
+		for ( p++; p < end && '"' != *p; p++ )
+		{
+			if ( '\\' == *p )
+			{
+				if ( ++p == end )
+					return 0;
+				switch ( *p )
+				{
+				case 'n':	*o++ = '\n';	break;
+				case 't':	*o++ = '\t';	break;
+				case '"':
+				case '\\':	*o++ = *p;		break;
+				default:	return 0;
+				}
+			}
+			else
+				*o++ = *p;
+		}
+		/* the closing quote must end the line */
+		if ( p + 1 != end )
+			return 0;
+		entry->str = value;
+		entry->str_len = o - value;
+		*o++ = '\0';
+	}
+	else
+	{
+		if ( ! config_array_parse_int( p, end - p, &entry->val ) )
+			return 0;
+		entry->str = NULL;
+		entry->str_len = 0;
+	}
+
+	*out = o;
+	return 1;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+void config_flat_sort( config_flat_entry_t *e, config_flat_entry_t *tmp, unsigned int n )
+{
+	unsigned int width, lo, i, j, k, mid, hi;
+
+	for ( width = 1; width < n; width *= 2 )
+	{
+		for ( lo = 0; lo < n; lo += 2 * width )
+		{
+			mid = (lo + width < n) ? lo + width : n;
+			hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+			for ( i = lo, j = mid, k = lo; k < hi; k++ )
+			{
+				if ( i < mid && (j == hi || strcmp( e[i].path, e[j].path ) <= 0) )
+					tmp[k] = e[i++];
+				else
+					tmp[k] = e[j++];
+			}
+		}
+		memcpy( e, tmp, n * sizeof(*e) );
+	}
+}
+
+config_result_t config_flat_parse( const char *data, size_t len, config_flat_batch_t *batch )
+{
+	const char			*p, *end = data + len, *eol;
+	config_flat_entry_t	*tmp;
+	unsigned int		lines = 1;
+	char				*out;
+
+	memset( batch, 0, sizeof(*batch) );
+
+	for ( p = data; p < end; p++ )
+		if ( '\n' == *p )
+			lines++;
+
+	/* every copied path or string, NUL included, is no longer than the line it came from */
+	batch->text = CONFIG_ALLOC_LARGE( len + 1 );
+	batch->entries = CONFIG_ALLOC_LARGE( 2 * lines * sizeof(config_flat_entry_t) );
+	if ( NULL == batch->text || NULL == batch->entries )
+	{
+		config_flat_free( batch );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	out = batch->text;
+	for ( p = data; p < end; p = eol + 1 )
+	{
+		for ( eol = p; eol < end && '\n' != *eol; eol++ )
+			;
+		while ( p < eol && flat_space( *p ) )
+			p++;
+		if ( p < eol && '#' != *p && ! flat_line( p, eol, &out, &batch->entries[batch->count++] ) )
+		{
+			config_flat_free( batch );
+			return CONFIG_ERR_INVALID_REFERENCE;
+		}
+		if ( eol == end )
+			break;
+	}
+
+	/* the second half of the entry array is the sort's scratch space */
+	tmp = batch->entries + lines;
+	config_flat_sort( batch->entries, tmp, batch->count );
+	return CONFIG_SUCCESS;
+}
+
+void config_flat_free( config_flat_batch_t *batch )
+{
+	if ( batch->text )
+		CONFIG_FREE_LARGE( batch->text );
+	if ( batch->entries )
+		CONFIG_FREE_LARGE( batch->entries );
+	memset( batch, 0, sizeof(*batch) );
+}
@@ -0,0 +1,348 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Merkle subtree hashes.
+ *
+ * The hash of a node covers its own value and, for every child, the child's
+ * name and hash.  Children are combined by addition, so two trees holding the
+ * same names and values hash alike whatever order they were loaded in.
+ *
+ * Hashes are computed on demand and kept per node together with the node's
+ * parent, as seen while hashing.  A set invalidates the node it wrote and
+ * every cached hash on the way up to the root, so rehashing afterwards only
+ * revisits the changed path; everything beside it is answered from the
+ * cache.  Changes whose extent is not known (loads, removals, and writes that
+ * create overlay or dedup copies) drop the whole cache instead.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+#define HASH_FNV_OFFSET		0xcbf29ce484222325ULL
+#define HASH_FNV_PRIME		0x100000001b3ULL
+
+#define HASH_KNOWN			0x01		/* hash holds the subtree hash */
+#define HASH_HAS_PARENT		0x02
+
+typedef struct {
+	unsigned long long	hash;
+	config_ref_t		parent;
+	unsigned char		flags;
+} config_hash_rec_t;
+
+static config_refmap_t		hash_slot;			/* node -> index in hash_recs */
+static config_hash_rec_t	*hash_recs;
+static unsigned int			hash_count;
+static unsigned int			hash_capacity;
+static int					hash_shared;		/* some node was reached from two parents */
+
+static unsigned long long hash_mix( unsigned long long h, const void *data, size_t len )
+{
+	const unsigned char *p = data;
+
+	while ( len-- )
+	{
+		h ^= *p++;
+		h *= HASH_FNV_PRIME;
+	}
+	return h;
+}
+
+/* Spread the bits of h so that sums of child hashes do not cancel. */
+static unsigned long long hash_final( unsigned long long h )
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Hash of node_ref's own value: a tag for its type, then the value. */
+static unsigned long long hash_value( config_ref_t node_ref )
+{
+	unsigned long long	h = HASH_FNV_OFFSET;
+	const char			*str;
+	int					ival;
+
+	if ( CONFIG_SUCCESS == htuple_node_int_value( node_ref, &ival ) )
+		return hash_mix( hash_mix( h, "i", 1 ), &ival, sizeof(ival) );
+	if ( CONFIG_SUCCESS == htuple_node_str_value( node_ref, &str ) )
+		return hash_mix( hash_mix( h, "s", 1 ), str, strlen(str) );
+	return hash_mix( h, "n", 1 );
+}
+
+static config_hash_rec_t *hash_rec( config_ref_t node_ref, int create )
+{
+	unsigned long		slot;
+	config_hash_rec_t	*grown;
+
+	/* a forwarding node presents its content, whose record survives the node being moved */
+	node_ref = config_stage_forward( node_ref );
+	if ( config_refmap_get( &hash_slot, node_ref, &slot ) )
+		return &hash_recs[slot];
+	if ( ! create )
+		return NULL;
+
+	if ( hash_count == hash_capacity )
+	{
+		unsigned int capacity = hash_capacity ? hash_capacity * 2 : 64;
+
+		if ( NULL == (grown = CONFIG_ALLOC_LARGE( capacity * sizeof(*grown) )) )
+			return NULL;
+		if ( hash_recs )
+		{
+			memcpy( grown, hash_recs, hash_count * sizeof(*grown) );
+			CONFIG_FREE_LARGE( hash_recs );
+		}
+		hash_recs = grown;
+		hash_capacity = capacity;
+	}
+	if ( CONFIG_SUCCESS != config_refmap_put( &hash_slot, node_ref, hash_count ) )
+		return NULL;
+
+	memset( &hash_recs[hash_count], 0, sizeof(*hash_recs) );
+	return &hash_recs[hash_count++];
+}
+
+static unsigned long long hash_node( config_ref_t node_ref )
+{
+	unsigned long long	h, sum = 0;
+	config_hash_rec_t	*rec = hash_rec( node_ref, 1 );
+	config_ref_t		child, self = config_stage_forward( node_ref );
+	const char			*name;
+
+	if ( rec && (rec->flags & HASH_KNOWN) )
+		return rec->hash;
+
+	for ( child = config_overlay_first_child( node_ref ); child; child = config_overlay_next_sibling( child ) )
+	{
+		config_hash_rec_t *crec;
+
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			name = "";
+		h = hash_mix( HASH_FNV_OFFSET, name, strlen(name) + 1 ) ^ hash_node( child );
+		sum += hash_final( h );
+
+		/* records may have moved while the child was hashed */
+		if ( NULL != (crec = hash_rec( child, 0 )) )
+		{
+			if ( (crec->flags & HASH_HAS_PARENT) && crec->parent != self )
+				hash_shared = 1;
+			crec->parent = self;
+			crec->flags |= HASH_HAS_PARENT;
+		}
+	}
+
+	h = hash_final( hash_value( node_ref ) + sum );
+
+	/* an allocation failure only costs the caching */
+	if ( NULL != (rec = hash_rec( node_ref, 0 )) )
+	{
+		rec->hash = h;
+		rec->flags |= HASH_KNOWN;
+	}
+	return h;
+}
+
+/* Invalidate node_ref and its cached ancestors.  Returns 0 if node_ref is not known. */
+static int hash_invalidate_up( config_ref_t node_ref )
+{
+	config_hash_rec_t *rec = hash_rec( node_ref, 0 );
+
+	if ( NULL == rec )
+		return 0;
+
+	while ( rec )
+	{
+		rec->flags &= ~HASH_KNOWN;
+		if ( ! (rec->flags & HASH_HAS_PARENT) )
+			break;
+		rec = hash_rec( rec->parent, 0 );
+	}
+	return 1;
+}
+
+/* Children of a and b by name, descending only where hashes differ. */
+static void hash_diff( config_ref_t a_ref, config_ref_t b_ref, config_diff_t *diffs, unsigned int max, unsigned int *count )
+{
+	config_ref_t	child, other;
+	const char		*name;
+
+	if ( hash_value( a_ref ) != hash_value( b_ref ) )
+	{
+		if ( *count < max )
+		{
+			diffs[*count].a_ref = a_ref;
+			diffs[*count].b_ref = b_ref;
+		}
+		(*count)++;
+	}
+
+	for ( child = config_overlay_first_child( a_ref ); child; child = config_overlay_next_sibling( child ) )
+	{
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			continue;
+		other = config_overlay_child( b_ref, name, strlen(name) );
+		if ( 0 == other )
+		{
+			if ( *count < max )
+			{
+				diffs[*count].a_ref = child;
+				diffs[*count].b_ref = 0;
+			}
+			(*count)++;
+		}
+		else if ( hash_node( child ) != hash_node( other ) )
+			hash_diff( child, other, diffs, max, count );
+	}
+
+	for ( child = config_overlay_first_child( b_ref ); child; child = config_overlay_next_sibling( child ) )
+	{
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			continue;
+		if ( 0 == config_overlay_child( a_ref, name, strlen(name) ) )
+		{
+			if ( *count < max )
+			{
+				diffs[*count].a_ref = 0;
+				diffs[*count].b_ref = child;
+			}
+			(*count)++;
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+unsigned long long config_hash_subtree( config_ref_t node_ref )
+{
+	return hash_node( config_overlay_top( node_ref ) );
+}
+
+void config_hash_diff( config_ref_t a_ref, config_ref_t b_ref, config_diff_t *diffs, unsigned int max, unsigned int *count )
+{
+	*count = 0;
+	a_ref = config_overlay_top( a_ref );
+	b_ref = config_overlay_top( b_ref );
+	if ( hash_node( a_ref ) != hash_node( b_ref ) )
+		hash_diff( a_ref, b_ref, diffs, diffs ? max : 0, count );
+}
+
+void config_hash_value_changed( config_ref_t parent_ref, config_ref_t node_ref )
+{
+	if ( 0 == hash_count )
+		return;
+
+	if ( ! hash_shared && hash_invalidate_up( parent_ref ) )
+	{
+		config_hash_rec_t *rec = node_ref ? hash_rec( node_ref, 0 ) : NULL;
+
+		if ( rec )
+			rec->flags &= ~HASH_KNOWN;
+		return;
+	}
+
+	/*
+	 * parent_ref was never hashed.  Without overlays or shared subtrees that
+	 * means no cached hash covers it; otherwise the write may have changed
+	 * what a cached node presents.
+	 */
+	if ( hash_shared || config_overlay_active() || config_dedup_active() )
+		config_hash_flush();
+}
+
+void config_hash_moved( config_ref_t node_ref, config_ref_t parent_ref )
+{
+	config_hash_rec_t *rec;
+
+	if ( 0 == hash_count )
+		return;
+	if ( hash_shared || config_dedup_active() )
+	{
+		config_hash_flush();
+		return;
+	}
+
+	/* the old ancestors lose node_ref, the new ones gain it; nothing below changes */
+	if ( NULL != (rec = hash_rec( node_ref, 0 )) )
+	{
+		hash_invalidate_up( node_ref );
+		rec->flags &= ~HASH_HAS_PARENT;
+	}
+	hash_invalidate_up( parent_ref );
+}
+
+void config_hash_flush( void )
+{
+	config_refmap_free( &hash_slot );
+	if ( hash_recs )
+		CONFIG_FREE_LARGE( hash_recs );
+	hash_recs = NULL;
+	hash_count = hash_capacity = 0;
+	hash_shared = 0;
+}
@@ -0,0 +1,831 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Name index for the configuration database.
+ *
+ * Every edge of the tree that has been looked up through the core is recorded
+ * as (parent, name) -> child.  Paths are resolved one component at a time
+ * against this index, so lookup cost stays flat however large the tree grows.
+ *
+ * The bucket array grows when the load factor reaches 1 and shrinks when it
+ * falls below 1/8.  Resizing is incremental: a second table is allocated and
+ * every subsequent index operation migrates one bucket into it, so no single
+ * config_load, config_get_* or ioctl pays for rehashing the whole index.
+ *
+ * Each entry is also chained by child reference so that config_index_forget()
+ * can find the edge leading to a removed node without knowing its parent.
+ * Removed edges are left in their name chain as tombstones and are reclaimed
+ * when a lookup walks over them or when their bucket is migrated.
+ *
+ * A load into an empty node is indexed up front by config_index_build():
+ * none of its edges can be in the index yet, so they are inserted without
+ * looking for existing entries, into pool slots and a bucket array sized
+ * for all of them before the first insert.
+ *
+ * Names partly come from files written by third parties, so the bucket of
+ * an edge is chosen by SipHash-1-3 under a random key drawn when the index
+ * is created: names that collide cannot be prepared without knowing it.  A
+ * lookup that walks more than INDEX_CHAIN_CAP distinct names in one bucket
+ * is taken as a sign that they were anyway; the index then draws a new key
+ * and rebuckets every entry at once, which also ends any resize under way.
+ * Entries for the same (parent, name) land together under every key, so
+ * they count once, and a rebucketing waits until as many lookups as there
+ * are entries have gone by since the last one: however a long bucket came
+ * about, replacing the key costs O(1) per lookup.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+#ifdef __KERNEL__
+#include <linux/random.h>
+#else
+#include <stdio.h>
+#include <time.h>
+#endif
+
+#define INDEX_MIN_BUCKETS           16      /* never shrink below this */
+#define INDEX_GROW_LOAD             1       /* grow when entries per bucket reach this */
+#define INDEX_SHRINK_LOAD           8       /* shrink when buckets per entry exceed this */
+#define INDEX_REHASH_EMPTY_VISITS   10      /* empty buckets skipped per rehash step */
+#define INDEX_CHUNK                 512     /* entries per pool chunk; a power of two */
+#define INDEX_DIR_MIN               16      /* chunk pointers in the first directory */
+#define INDEX_INLINE_NAME           16      /* names shorter than this are stored in the slot */
+#define INDEX_CHAIN_CAP             16      /* entries walked in one bucket before the key is replaced */
+
+/*
+ * Entries live in a pool of parallel arrays and are addressed by a 32-bit
+ * index; 0 is never handed out and terminates every chain.  The fields a probe
+ * touches (hash, parent, child, next) sit in their own dense arrays so that
+ * walking a chain pulls in 16 bytes per entry instead of a whole heap node,
+ * and bucket heads are 32-bit indices rather than pointers.  The arrays come
+ * in chunks of INDEX_CHUNK entries: the pool grows by adding a chunk, so no
+ * insert ever waits for the entries already there to be copied.
+ */
+typedef unsigned int config_index_id_t;
+
+/* Short names ("base", "size", "num_bufs") are kept in the slot itself. */
+typedef union {
+	char	inline_name[INDEX_INLINE_NAME];
+	char	*heap_name;
+} config_index_name_t;
+
+#define INDEX_NAME_IS_INLINE( len )		((len) < INDEX_INLINE_NAME)
+
+typedef struct {
+	/* hot: read on every probe */
+	unsigned int		hash[INDEX_CHUNK];
+	config_ref_t		parent[INDEX_CHUNK];
+	config_ref_t		child[INDEX_CHUNK];		/* 0 marks a tombstone */
+	config_index_id_t	next[INDEX_CHUNK];		/* name chain, or free list */
+	/* cold: only needed on a hash match, on insert and on forget */
+	config_index_id_t	ref_next[INDEX_CHUNK];	/* child reference chain */
+	config_index_id_t	ref_prev[INDEX_CHUNK];	/* 0 when first in its ref bucket */
+	unsigned int		namelen[INDEX_CHUNK];
+	config_index_name_t	name[INDEX_CHUNK];
+} config_index_chunk_t;
+
+static struct {
+	config_index_chunk_t	**chunks;
+	unsigned int			dir_size;		/* chunk pointers allocated */
+	unsigned int			capacity;		/* slots allocated, slot 0 included */
+	config_index_id_t		free_head;
+} pool;
+
+/* Field field of entry e. */
+#define INDEX_SLOT( field, e )	(pool.chunks[(e) / INDEX_CHUNK]->field[(e) % INDEX_CHUNK])
+
+typedef struct {
+	config_index_id_t	*buckets;		/* chained by (parent, name) */
+	config_index_id_t	*ref_buckets;	/* chained by child reference */
+	unsigned int		size;			/* power of two, 0 when unallocated */
+	unsigned int		used;			/* entries in buckets, tombstones included */
+} config_index_table_t;
+
+/* tables[1] only exists while a resize is in progress */
+static config_index_table_t	tables[2];
+static long					rehash_pos = -1;
+static unsigned int			tombstones;
+
+/* SipHash key, whether a lookup found a bucket too long for it, and lookups since it was drawn */
+static unsigned long long	index_key[2];
+static int					rekey_wanted;
+static unsigned int			rekey_lookups;
+
+/* counters reported by config_index_stats() */
+static unsigned int			stat_lookups;
+static unsigned int			stat_misses;
+static unsigned int			stat_max_probe;
+static unsigned int			stat_rekeys;
+
+#define REHASHING()		(rehash_pos >= 0)
+
+#define INDEX_ROTL( x, b )		(((x) << (b)) | ((x) >> (64 - (b))))
+#define INDEX_SIPROUND()										\
+	do {														\
+		v0 += v1; v1 = INDEX_ROTL( v1, 13 ); v1 ^= v0; v0 = INDEX_ROTL( v0, 32 );	\
+		v2 += v3; v3 = INDEX_ROTL( v3, 16 ); v3 ^= v2;			\
+		v0 += v3; v3 = INDEX_ROTL( v3, 21 ); v3 ^= v0;			\
+		v2 += v1; v1 = INDEX_ROTL( v1, 17 ); v1 ^= v2; v2 = INDEX_ROTL( v2, 32 );	\
+	} while ( 0 )
+
+/* Draw a new key; without a random device, clock and address bits have to do. */
+static void index_seed( void )
+{
+#ifdef __KERNEL__
+	get_random_bytes( index_key, sizeof(index_key) );
+#else
+	FILE *f = fopen( "/dev/urandom", "rb" );
+
+	if ( NULL == f || 1 != fread( index_key, sizeof(index_key), 1, f ) )
+	{
+		index_key[0] ^= ((unsigned long long) time( NULL ) << 32) ^ (unsigned long) &f;
+		index_key[1] ^= ((unsigned long long) clock() << 16) ^ (unsigned long) index_key;
+	}
+	if ( f )
+		fclose( f );
+#endif
+}
+
+/* SipHash-1-3 of the parent reference (4 bytes, little end first) followed by the name, folded to 32 bits */
+static unsigned int index_hash( config_ref_t parent, const char *name, size_t len )
+{
+	unsigned long long	v0 = 0x736f6d6570736575ULL ^ index_key[0];
+	unsigned long long	v1 = 0x646f72616e646f6dULL ^ index_key[1];
+	unsigned long long	v2 = 0x6c7967656e657261ULL ^ index_key[0];
+	unsigned long long	v3 = 0x7465646279746573ULL ^ index_key[1];
+	unsigned long long	m = (unsigned int) parent;
+	unsigned int		fill = 4;
+	size_t				total = len + 4;
+
+	while ( len-- )
+	{
+		m |= (unsigned long long) (unsigned char) *name++ << (8 * fill);
+		if ( 8 == ++fill )
+		{
+			v3 ^= m;
+			INDEX_SIPROUND();
+			v0 ^= m;
+			m = 0;
+			fill = 0;
+		}
+	}
+	m |= (unsigned long long) (total & 0xff) << 56;
+	v3 ^= m;
+	INDEX_SIPROUND();
+	v0 ^= m;
+
+	v2 ^= 0xff;
+	INDEX_SIPROUND();
+	INDEX_SIPROUND();
+	INDEX_SIPROUND();
+	m = v0 ^ v1 ^ v2 ^ v3;
+	return (unsigned int) (m ^ (m >> 32));
+}
+
+static unsigned int index_ref_hash( config_ref_t ref )
+{
+	return ref * 0x9e3779b1u;
+}
+
+static unsigned int index_round_pow2( unsigned int n )
+{
+	unsigned int size = INDEX_MIN_BUCKETS;
+
+	while ( size < n )
+		size <<= 1;
+	return size;
+}
+
+/* Add a chunk of slots and put them on the free list; nothing already in the pool moves. */
+static config_result_t index_pool_grow( void )
+{
+	unsigned int			n = pool.capacity / INDEX_CHUNK;
+	unsigned int			i, size;
+	config_index_chunk_t	**dir, *chunk;
+
+	if ( n == pool.dir_size )
+	{
+		size = pool.dir_size ? pool.dir_size * 2 : INDEX_DIR_MIN;
+		if ( NULL == (dir = CONFIG_ALLOC_LARGE( size * sizeof(*dir) )) )
+			return CONFIG_ERR_NO_RESOURCES;
+		if ( pool.chunks )
+		{
+			memcpy( dir, pool.chunks, n * sizeof(*dir) );
+			CONFIG_FREE_LARGE( pool.chunks );
+		}
+		pool.chunks = dir;
+		pool.dir_size = size;
+	}
+	if ( NULL == (chunk = CONFIG_ALLOC_LARGE( sizeof(*chunk) )) )
+		return CONFIG_ERR_NO_RESOURCES;
+	memset( chunk, 0, sizeof(*chunk) );
+	pool.chunks[n] = chunk;
+	pool.capacity += INDEX_CHUNK;
+
+	/* slot 0 is the chain terminator and never joins the free list */
+	for ( i = pool.capacity - 1; i >= (n ? n * INDEX_CHUNK : 1); i-- )
+	{
+		INDEX_SLOT( next, i ) = pool.free_head;
+		pool.free_head = i;
+	}
+	return CONFIG_SUCCESS;
+}
+
+static void index_pool_free( void )
+{
+	unsigned int i;
+
+	for ( i = 1; i < pool.capacity; i++ )
+		if ( ! INDEX_NAME_IS_INLINE( INDEX_SLOT( namelen, i ) ) )
+			CONFIG_FREE( INDEX_SLOT( name, i ).heap_name );
+
+	for ( i = 0; i < pool.capacity / INDEX_CHUNK; i++ )
+		CONFIG_FREE_LARGE( pool.chunks[i] );
+	if ( pool.chunks ) CONFIG_FREE_LARGE( pool.chunks );
+	memset( &pool, 0, sizeof(pool) );
+}
+
+static const char *index_entry_name( config_index_id_t e )
+{
+	return INDEX_NAME_IS_INLINE( INDEX_SLOT( namelen, e ) ) ? INDEX_SLOT( name, e ).inline_name : INDEX_SLOT( name, e ).heap_name;
+}
+
+static config_index_id_t index_entry_alloc( void )
+{
+	config_index_id_t e;
+
+	if ( 0 == pool.free_head && CONFIG_SUCCESS != index_pool_grow() )
+		return 0;
+
+	e = pool.free_head;
+	pool.free_head = INDEX_SLOT( next, e );
+	return e;
+}
+
+static void index_entry_free( config_index_id_t e )
+{
+	if ( ! INDEX_NAME_IS_INLINE( INDEX_SLOT( namelen, e ) ) )
+		CONFIG_FREE( INDEX_SLOT( name, e ).heap_name );
+	INDEX_SLOT( namelen, e ) = 0;
+	INDEX_SLOT( child, e ) = 0;
+	INDEX_SLOT( next, e ) = pool.free_head;
+	pool.free_head = e;
+}
+
+static config_result_t index_table_alloc( config_index_table_t *t, unsigned int size )
+{
+	t->buckets = CONFIG_ALLOC_LARGE( size * sizeof(*t->buckets) );
+	t->ref_buckets = CONFIG_ALLOC_LARGE( size * sizeof(*t->ref_buckets) );
+	if ( NULL == t->buckets || NULL == t->ref_buckets )
+	{
+		if ( t->buckets ) CONFIG_FREE_LARGE( t->buckets );
+		if ( t->ref_buckets ) CONFIG_FREE_LARGE( t->ref_buckets );
+		memset( t, 0, sizeof(*t) );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	memset( t->buckets, 0, size * sizeof(*t->buckets) );
+	memset( t->ref_buckets, 0, size * sizeof(*t->ref_buckets) );
+	t->size = size;
+	t->used = 0;
+	return CONFIG_SUCCESS;
+}
+
+/* Entries are owned by the pool; only the bucket arrays belong to the table. */
+static void index_table_free( config_index_table_t *t )
+{
+	if ( t->buckets ) CONFIG_FREE_LARGE( t->buckets );
+	if ( t->ref_buckets ) CONFIG_FREE_LARGE( t->ref_buckets );
+	memset( t, 0, sizeof(*t) );
+}
+
+static void index_ref_link( config_index_table_t *t, config_index_id_t e )
+{
+	config_index_id_t *head = &t->ref_buckets[ index_ref_hash( INDEX_SLOT( child, e ) ) & (t->size - 1) ];
+
+	INDEX_SLOT( ref_next, e ) = *head;
+	INDEX_SLOT( ref_prev, e ) = 0;
+	if ( *head )
+		INDEX_SLOT( ref_prev, *head ) = e;
+	*head = e;
+}
+
+static void index_ref_unlink( config_index_table_t *t, config_index_id_t e )
+{
+	config_index_id_t next = INDEX_SLOT( ref_next, e );
+	config_index_id_t prev = INDEX_SLOT( ref_prev, e );
+
+	if ( prev )
+		INDEX_SLOT( ref_next, prev ) = next;
+	else
+		t->ref_buckets[ index_ref_hash( INDEX_SLOT( child, e ) ) & (t->size - 1) ] = next;
+	if ( next )
+		INDEX_SLOT( ref_prev, next ) = prev;
+	INDEX_SLOT( ref_next, e ) = 0;
+	INDEX_SLOT( ref_prev, e ) = 0;
+}
+
+/* Migrate one populated bucket of tables[0] into tables[1]; finish the resize when tables[0] is empty. */
+static void index_rehash_step( void )
+{
+	int					visits = INDEX_REHASH_EMPTY_VISITS;
+	config_index_id_t	e;
+
+	if ( ! REHASHING() )
+		return;
+
+	while ( (unsigned long) rehash_pos < tables[0].size && 0 == tables[0].buckets[rehash_pos] )
+	{
+		rehash_pos++;
+		if ( --visits == 0 )
+			return;
+	}
+
+	if ( (unsigned long) rehash_pos < tables[0].size )
+	{
+		e = tables[0].buckets[rehash_pos];
+		tables[0].buckets[rehash_pos] = 0;
+
+		while ( e )
+		{
+			config_index_id_t next = INDEX_SLOT( next, e );
+
+			tables[0].used--;
+			if ( 0 == INDEX_SLOT( child, e ) )
+			{
+				/* tombstones are not carried over */
+				tombstones--;
+				index_entry_free( e );
+			}
+			else
+			{
+				config_index_id_t *head = &tables[1].buckets[ INDEX_SLOT( hash, e ) & (tables[1].size - 1) ];
+
+				index_ref_unlink( &tables[0], e );
+				INDEX_SLOT( next, e ) = *head;
+				*head = e;
+				index_ref_link( &tables[1], e );
+				tables[1].used++;
+			}
+			e = next;
+		}
+		rehash_pos++;
+	}
+
+	if ( (unsigned long) rehash_pos >= tables[0].size )
+	{
+		index_table_free( &tables[0] );
+		tables[0] = tables[1];
+		memset( &tables[1], 0, sizeof(tables[1]) );
+		rehash_pos = -1;
+	}
+}
+
+/* Start an incremental resize if the load factor (or the tombstone count) calls for one. */
+static void index_check_resize( void )
+{
+	unsigned int live, size;
+
+	if ( REHASHING() || 0 == tables[0].size )
+		return;
+
+	live = tables[0].used - tombstones;
+	size = tables[0].size;
+
+	if ( live >= size * INDEX_GROW_LOAD )
+		size = index_round_pow2( live * 2 );
+	else if ( size > INDEX_MIN_BUCKETS && live < size / INDEX_SHRINK_LOAD )
+		size = index_round_pow2( live * 2 );
+	else if ( tombstones <= size / 2 )
+		return;
+	/* else: same size, migration sweeps the tombstones out */
+
+	if ( CONFIG_SUCCESS == index_table_alloc( &tables[1], size ) )
+		rehash_pos = 0;
+}
+
+/* Draw a new key and rebucket every live entry under it in one new table; tombstones are freed on the way. */
+static void index_rekey( void )
+{
+	config_index_table_t	fresh;
+	config_index_id_t		e, *head;
+	unsigned int			live = tables[0].used + tables[1].used - tombstones;
+
+	rekey_wanted = 0;
+	rekey_lookups = 0;
+	if ( CONFIG_SUCCESS != index_table_alloc( &fresh, index_round_pow2( live * 2 ) ) )
+		return;
+	index_table_free( &tables[1] );
+	index_table_free( &tables[0] );
+	rehash_pos = -1;
+	index_seed();
+	stat_rekeys++;
+
+	/* the free list is rebuilt from every slot without a child */
+	pool.free_head = 0;
+	for ( e = pool.capacity; e-- > 1; )
+	{
+		if ( 0 == INDEX_SLOT( child, e ) )
+		{
+			index_entry_free( e );
+			continue;
+		}
+		INDEX_SLOT( hash, e ) = index_hash( INDEX_SLOT( parent, e ), index_entry_name( e ), INDEX_SLOT( namelen, e ) );
+		head = &fresh.buckets[ INDEX_SLOT( hash, e ) & (fresh.size - 1) ];
+		INDEX_SLOT( next, e ) = *head;
+		*head = e;
+		index_ref_link( &fresh, e );
+		fresh.used++;
+	}
+	tombstones = 0;
+	tables[0] = fresh;
+}
+
+/* Rekey if a lookup asked for it and enough lookups have paid for it. */
+static void index_check_rekey( void )
+{
+	if ( rekey_wanted && rekey_lookups >= tables[0].used + tables[1].used - tombstones )
+		index_rekey();
+}
+
+/* Non-zero if entries a and b are for the same (parent, name). */
+static int index_same_key( config_index_id_t a, config_index_id_t b )
+{
+	return INDEX_SLOT( hash, a ) == INDEX_SLOT( hash, b ) && INDEX_SLOT( parent, a ) == INDEX_SLOT( parent, b )
+	    && INDEX_SLOT( namelen, a ) == INDEX_SLOT( namelen, b )
+	    && ! memcmp( index_entry_name( a ), index_entry_name( b ), INDEX_SLOT( namelen, a ) );
+}
+
+/* Find the live entry for (parent, name), reclaiming any tombstones passed on the way. */
+static config_index_id_t index_find( config_ref_t parent, const char *name, size_t len, unsigned int hash )
+{
+	int				t;
+	unsigned int	probes = 0;
+
+	for ( t = 0; t <= (REHASHING() ? 1 : 0); t++ )
+	{
+		config_index_id_t	*pprev, e, last = 0;
+		unsigned int		chain = 0;
+
+		if ( 0 == tables[t].size )
+			continue;
+
+		/* pprev points either at a bucket head or at an entry's next field */
+		pprev = &tables[t].buckets[ hash & (tables[t].size - 1) ];
+		while ( 0 != (e = *pprev) )
+		{
+			if ( 0 == INDEX_SLOT( child, e ) )
+			{
+				*pprev = INDEX_SLOT( next, e );
+				tables[t].used--;
+				tombstones--;
+				index_entry_free( e );
+				continue;
+			}
+			if ( ++probes > stat_max_probe )
+				stat_max_probe = probes;
+			if ( INDEX_SLOT( hash, e ) == hash && INDEX_SLOT( parent, e ) == parent
+			  && INDEX_SLOT( namelen, e ) == len && ! memcmp( index_entry_name( e ), name, len ) )
+				return e;
+			/* no key can split entries for one name, so only distinct names count */
+			if ( ! (last && index_same_key( last, e )) && ++chain > INDEX_CHAIN_CAP )
+				rekey_wanted = 1;
+			last = e;
+			pprev = &INDEX_SLOT( next, e );
+		}
+	}
+	return 0;
+}
+
+/* Find the entry whose child is child; *table receives the table holding it. */
+static config_index_id_t index_find_child( config_ref_t child, config_index_table_t **table )
+{
+	int t;
+
+	for ( t = 0; t <= (REHASHING() ? 1 : 0); t++ )
+	{
+		config_index_id_t e;
+
+		if ( 0 == tables[t].size )
+			continue;
+
+		for ( e = tables[t].ref_buckets[ index_ref_hash( child ) & (tables[t].size - 1) ]; e; e = INDEX_SLOT( ref_next, e ) )
+			if ( INDEX_SLOT( child, e ) == child )
+			{
+				*table = &tables[t];
+				return e;
+			}
+	}
+	return 0;
+}
+
+static void index_insert( config_ref_t parent, const char *name, size_t len, unsigned int hash, config_ref_t child )
+{
+	config_index_table_t	*t = &tables[ REHASHING() ? 1 : 0 ];
+	config_index_id_t		e, *head;
+	char					*copy;
+
+	if ( 0 == t->size )
+		return;
+
+	if ( 0 == (e = index_entry_alloc()) )
+		return;
+	if ( INDEX_NAME_IS_INLINE( len ) )
+		copy = INDEX_SLOT( name, e ).inline_name;
+	else if ( NULL == (copy = INDEX_SLOT( name, e ).heap_name = CONFIG_ALLOC( len + 1 )) )
+	{
+		index_entry_free( e );
+		return;
+	}
+	memcpy( copy, name, len );
+	copy[len] = '\0';
+	INDEX_SLOT( namelen, e ) = len;
+	INDEX_SLOT( hash, e ) = hash;
+	INDEX_SLOT( parent, e ) = parent;
+	INDEX_SLOT( child, e ) = child;
+
+	head = &t->buckets[ hash & (t->size - 1) ];
+	INDEX_SLOT( next, e ) = *head;
+	*head = e;
+	index_ref_link( t, e );
+	t->used++;
+
+	index_check_resize();
+}
+
+/* Make room for n more entries: enough free pool slots, and buckets for the resulting load. */
+static config_result_t index_reserve( unsigned int n )
+{
+	unsigned int live, size;
+
+	/* every slot but 0 is either free or linked into a table */
+	while ( pool.capacity < tables[0].used + tables[1].used + n + 1 )
+		if ( CONFIG_SUCCESS != index_pool_grow() )
+			return CONFIG_ERR_NO_RESOURCES;
+
+	/* a resize under way was sized before these entries, so it is finished first */
+	while ( REHASHING() )
+		index_rehash_step();
+
+	/* one resize to the final size instead of one per doubling */
+	live = tables[0].used - tombstones;
+	if ( live + n >= tables[0].size * INDEX_GROW_LOAD )
+	{
+		size = index_round_pow2( (live + n) * 2 );
+		if ( CONFIG_SUCCESS == index_table_alloc( &tables[1], size ) )
+			rehash_pos = 0;
+	}
+	return CONFIG_SUCCESS;
+}
+
+/* Number of edges below node_ref. */
+static unsigned int index_count( config_ref_t node_ref )
+{
+	unsigned int	count = 0;
+	config_ref_t	child;
+
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		count += 1 + index_count( child );
+	return count;
+}
+
+/* Pre-order list of the edges below node_ref. */
+static unsigned int index_collect( config_ref_t node_ref, config_ref_t *parents, config_ref_t *children, unsigned int n )
+{
+	config_ref_t child;
+
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+	{
+		parents[n] = node_ref;
+		children[n++] = child;
+		n = index_collect( child, parents, children, n );
+	}
+	return n;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_index_init( void )
+{
+	if ( tables[0].size )
+		return CONFIG_SUCCESS;
+
+	tombstones = 0;
+	rehash_pos = -1;
+	rekey_wanted = 0;
+	rekey_lookups = 0;
+	stat_lookups = 0;
+	stat_misses = 0;
+	stat_max_probe = 0;
+	stat_rekeys = 0;
+	index_seed();
+	return index_table_alloc( &tables[0], INDEX_MIN_BUCKETS );
+}
+
+void config_index_deinit( void )
+{
+	index_table_free( &tables[1] );
+	index_table_free( &tables[0] );
+	index_pool_free();
+	tombstones = 0;
+	rehash_pos = -1;
+}
+
+config_ref_t config_index_lookup( config_ref_t parent, const char *name, size_t len )
+{
+	unsigned int		hash = index_hash( parent, name, len );
+	config_index_id_t	e;
+	config_ref_t		child;
+
+	index_rehash_step();
+	stat_lookups++;
+	rekey_lookups++;
+
+	if ( 0 != (e = index_find( parent, name, len, hash )) )
+	{
+		child = INDEX_SLOT( child, e );
+		index_check_rekey();
+		return child;
+	}
+
+	stat_misses++;
+	if ( 0 != (child = htuple_find_child( parent, name, len )) )
+	{
+		/* a removed subtree is out of sight even before it is deleted, moved content for good */
+		if ( config_epoch_retired( child ) || config_stage_hidden( child ) )
+			return 0;
+		index_insert( parent, name, len, hash, child );
+	}
+
+	index_check_rekey();
+	return child;
+}
+
+void config_index_build( config_ref_t root_ref )
+{
+	config_ref_t	*parents, *children;
+	unsigned int	count, i;
+	const char		*name;
+	size_t			len;
+
+	if ( 0 == tables[0].size || 0 == (count = index_count( root_ref )) )
+		return;
+
+	/* the index is only a cache: without memory it fills in lazily as before */
+	parents = CONFIG_ALLOC_LARGE( count * sizeof(*parents) );
+	children = CONFIG_ALLOC_LARGE( count * sizeof(*children) );
+	if ( NULL != parents && NULL != children && CONFIG_SUCCESS == index_reserve( count ) )
+	{
+		index_collect( root_ref, parents, children, 0 );
+
+		/* in reverse, so that of two equal names the one htuple finds first ends up first in its chain */
+		for ( i = count; i-- > 0; )
+		{
+			if ( CONFIG_SUCCESS != htuple_node_name( children[i], &name ) )
+				continue;
+			len = strlen( name );
+			index_insert( parents[i], name, len, index_hash( parents[i], name, len ), children[i] );
+		}
+	}
+	if ( parents ) CONFIG_FREE_LARGE( parents );
+	if ( children ) CONFIG_FREE_LARGE( children );
+}
+
+void config_index_forget( config_ref_t root_ref )
+{
+	config_ref_t child;
+
+	for ( child = htuple_first_child( root_ref ); child; child = htuple_next_sibling( child ) )
+		config_index_forget( child );
+
+	config_index_unlink( root_ref );
+}
+
+void config_index_unlink( config_ref_t child_ref )
+{
+	config_index_table_t	*t;
+	config_index_id_t		e;
+
+	if ( 0 != (e = index_find_child( child_ref, &t )) )
+	{
+		index_ref_unlink( t, e );
+		INDEX_SLOT( child, e ) = 0;
+		tombstones++;
+	}
+
+	index_check_resize();
+}
+
+int config_index_parent( config_ref_t child_ref, config_ref_t *parent_ref )
+{
+	config_index_table_t	*t;
+	config_index_id_t		e;
+
+	if ( 0 == (e = index_find_child( child_ref, &t )) )
+		return 0;
+	*parent_ref = INDEX_SLOT( parent, e );
+	return 1;
+}
+
+void config_index_get_stats( config_index_stats_t *stats )
+{
+	int t;
+
+	memset( stats, 0, sizeof(*stats) );
+
+	for ( t = 0; t <= (REHASHING() ? 1 : 0); t++ )
+	{
+		unsigned int i;
+
+		for ( i = 0; i < tables[t].size; i++ )
+		{
+			config_index_id_t	e;
+			unsigned int		chain = 0;
+
+			/* buckets already migrated out of tables[0] are not counted */
+			if ( 0 == t && REHASHING() && i < (unsigned long) rehash_pos )
+				continue;
+
+			for ( e = tables[t].buckets[i]; e; e = INDEX_SLOT( next, e ) )
+				chain++;
+
+			stats->chain_histogram[ chain < CONFIG_INDEX_HISTOGRAM_SIZE ? chain : CONFIG_INDEX_HISTOGRAM_SIZE - 1 ]++;
+			if ( chain > stats->max_chain )
+				stats->max_chain = chain;
+			stats->buckets++;
+		}
+		stats->entries += tables[t].used;
+	}
+
+	stats->entries -= tombstones;
+	stats->tombstones = tombstones;
+	stats->load_factor = stats->buckets ? (stats->entries * 100) / stats->buckets : 0;
+	stats->rehashing = REHASHING() ? 1 : 0;
+	stats->lookups = stat_lookups;
+	stats->misses = stat_misses;
+	stats->max_probe = stat_max_probe;
+	stats->rekeys = stat_rekeys;
+}
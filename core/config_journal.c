@@ -0,0 +1,580 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Mutation journal.
+ *
+ * While a journal is started every committed change to the database (a set,
+ * a load, a removal) is appended to one buffer as a compact record naming
+ * its target by path, so that the buffer can be saved before the module is
+ * unloaded and replayed into a fresh database afterwards.  The saved image
+ * is the buffer itself:
+ *
+ *     "PCJ1" record record ...
+ *
+ * each record being a config_journal_rec_t followed by the NUL-terminated
+ * path and the NUL-terminated data (the int itself for CONFIG_JOURNAL_SET_INT),
+ * padded to 4 bytes.  Fields are in native byte order.
+ *
+ * Sets are coalesced whenever records are read back: among the sets between
+ * two loads or removals only the last one to each path matters, and they are
+ * applied as one batch, the way config_load_flat() applies a file, but in the
+ * order each path was first set so that new nodes are created in the same
+ * order as before.
+ * When the buffer fills up it is coalesced in place; if that does not free
+ * enough room the journal stops recording and can no longer be saved, since
+ * it would no longer describe the database.
+ *
+ * Changes that land outside the database (in an overlay layer or a
+ * namespace) are not recorded.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+#define JOURNAL_MAGIC		"PCJ1"
+#define JOURNAL_MAGIC_LEN	4
+#define JOURNAL_ALIGN( n )	(((n) + 3) & ~(size_t) 3)
+
+typedef struct {
+	unsigned char	op;				/* config_journal_op_t */
+	unsigned char	reserved;
+	unsigned short	path_len;		/* without the NUL */
+	unsigned int	data_len;		/* without the NUL */
+} config_journal_rec_t;
+
+static char			*journal_buf;		/* NULL while no journal is started */
+static size_t		journal_size;
+static size_t		journal_used;
+static int			journal_lost;		/* a change could not be recorded */
+
+/* the path of the last node looked up, since most changes in a row share a parent */
+static config_ref_t	memo_ref;
+static char			memo_path[CONFIG_JOURNAL_MAX_PATH + 2];	/* room for the separator journal_climb() leaves in front */
+static size_t		memo_len;
+static int			memo_valid;
+static int			memo_skipped;		/* journal_find() passed over a path too long to record */
+
+/* a removal's path, worked out before the node goes and recorded once it has */
+static char			held_path[CONFIG_JOURNAL_MAX_PATH + 1];
+static size_t		held_len;
+static int			held_op;			/* 0 if nothing is held */
+
+/* Append a record for path prefix[.name] to buf; returns 0 if it does not fit in size. */
+static int journal_put( char *buf, size_t *used, size_t size, unsigned int op, const char *prefix, size_t prefix_len,
+                        const char *name, size_t name_len, const void *data, size_t data_len )
+{
+	config_journal_rec_t	rec;
+	size_t					dot = (prefix_len && name_len) ? 1 : 0;
+	size_t					path_len = prefix_len + dot + name_len;
+	size_t					rec_len = JOURNAL_ALIGN( sizeof(rec) + path_len + 1 + data_len + 1 );
+	char					*p = buf + *used;
+
+	if ( path_len > CONFIG_JOURNAL_MAX_PATH || data_len > 0xffffffffUL || rec_len > size - *used )
+		return 0;
+
+	memset( &rec, 0, sizeof(rec) );
+	rec.op = (unsigned char) op;
+	rec.path_len = (unsigned short) path_len;
+	rec.data_len = (unsigned int) data_len;
+	memcpy( p, &rec, sizeof(rec) );
+	p += sizeof(rec);
+
+	memcpy( p, prefix, prefix_len );
+	p += prefix_len;
+	if ( dot )
+		*p++ = CONFIG_PATH_SEPARATOR;
+	memcpy( p, name, name_len );
+	p += name_len;
+	*p++ = '\0';
+
+	memcpy( p, data, data_len );
+	p += data_len;
+	*p++ = '\0';
+	memset( p, 0, buf + *used + rec_len - p );
+
+	*used += rec_len;
+	return 1;
+}
+
+/* Depth-first search of the database for target, leaving its path in memo_path.  Overlay roots are skipped. */
+static int journal_find( config_ref_t node_ref, config_ref_t target )
+{
+	config_ref_t	child;
+	const char		*name;
+	size_t			len, saved = memo_len;
+
+	for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+	{
+		if ( config_overlay_internal( child ) || CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			continue;
+		len = strlen( name );
+		if ( saved + (saved ? 1 : 0) + len > CONFIG_JOURNAL_MAX_PATH )
+		{
+			memo_skipped = 1;
+			continue;
+		}
+
+		memo_len = saved;
+		if ( memo_len )
+			memo_path[memo_len++] = CONFIG_PATH_SEPARATOR;
+		memcpy( memo_path + memo_len, name, len );
+		memo_len += len;
+
+		if ( child == target || config_stage_forward( child ) == target || journal_find( child, target ) )
+			return 1;
+	}
+	memo_len = saved;
+	return 0;
+}
+
+/*
+ * Build the path of node_ref in memo_path by climbing the parents the index
+ * recorded, right to left, and moving it to the front.  Returns -1 if some
+ * edge on the way was never looked up, 0 if node_ref is not in the database.
+ */
+static int journal_climb( config_ref_t node_ref )
+{
+	config_ref_t	parent;
+	const char		*name;
+	size_t			len, start = sizeof(memo_path) - 1;
+
+	memo_path[start] = '\0';
+	while ( ROOT_NODE != node_ref )
+	{
+		/* a tree published or moved to a node is named by that node */
+		if ( 0 != (parent = config_stage_base( node_ref )) )
+		{
+			node_ref = parent;
+			continue;
+		}
+		/* overlay layers, staged trees and removed subtrees are not in the database */
+		if ( config_overlay_internal( node_ref ) || config_stage_hidden( node_ref ) || config_epoch_retired( node_ref ) )
+			return 0;
+		if ( ! config_index_parent( node_ref, &parent ) || CONFIG_SUCCESS != htuple_node_name( node_ref, &name ) )
+			return -1;
+
+		len = strlen( name );
+		if ( len + 1 > start )
+		{
+			journal_lost = 1;
+			return 0;
+		}
+		start -= len;
+		memcpy( memo_path + start, name, len );
+		memo_path[--start] = CONFIG_PATH_SEPARATOR;
+		node_ref = parent;
+	}
+
+	/* drop the separator in front of the first name */
+	memo_len = sizeof(memo_path) - 2 - start;
+	memmove( memo_path, memo_path + start + 1, memo_len + 1 );
+	return 1;
+}
+
+/* The path of node_ref from the root of the database; returns 0 if it is not in the database. */
+static int journal_path( config_ref_t node_ref, const char **path, size_t *len )
+{
+	/* a tree published to a node is named by that node */
+	if ( ROOT_NODE == node_ref || config_stage_forward( ROOT_NODE ) == node_ref )
+	{
+		*path = "";
+		*len = 0;
+		return 1;
+	}
+
+	if ( ! memo_valid || memo_ref != node_ref )
+	{
+		memo_len = 0;
+		memo_valid = journal_climb( node_ref );
+		/* only a reference handed out by enumeration can have an edge the index never saw */
+		if ( memo_valid < 0 )
+		{
+			memo_len = 0;
+			memo_skipped = 0;
+			memo_valid = journal_find( ROOT_NODE, node_ref );
+			/* the node may be below a path too long to record, like in journal_climb() */
+			if ( ! memo_valid && memo_skipped )
+				journal_lost = 1;
+		}
+		memo_ref = node_ref;
+		if ( ! memo_valid )
+			return 0;
+	}
+	*path = memo_path;
+	*len = memo_len;
+	return 1;
+}
+
+/* Stable merge sort of e[0..n) back into record order, which is the order of the paths in the journal buffer. */
+static void journal_sort_records( config_flat_entry_t *e, config_flat_entry_t *tmp, unsigned int n )
+{
+	unsigned int width, lo, i, j, k, mid, hi;
+
+	for ( width = 1; width < n; width *= 2 )
+	{
+		for ( lo = 0; lo < n; lo += 2 * width )
+		{
+			mid = (lo + width < n) ? lo + width : n;
+			hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+			for ( i = lo, j = mid, k = lo; k < hi; k++ )
+			{
+				if ( i < mid && (j == hi || e[i].path < e[j].path) )
+					tmp[k] = e[i++];
+				else
+					tmp[k] = e[j++];
+			}
+		}
+		memcpy( e, tmp, n * sizeof(*e) );
+	}
+}
+
+/*
+ * Close the run of sets batch->sets[first..set_count): keep the last set to
+ * each path, in the place of the first one, and add its entry.
+ */
+static void journal_close_run( config_journal_batch_t *batch, unsigned int first, config_flat_entry_t *scratch )
+{
+	config_journal_entry_t	*e;
+	const char				*path;
+	unsigned int			i, w = first, group = first;
+
+	if ( first == batch->set_count )
+		return;
+
+	/* the sort is stable, so each path's group starts with its first set and ends with its last */
+	config_flat_sort( batch->sets + first, scratch, batch->set_count - first );
+	for ( i = first; i < batch->set_count; i++ )
+	{
+		if ( i + 1 < batch->set_count && ! strcmp( batch->sets[i].path, batch->sets[i + 1].path ) )
+			continue;
+		path = batch->sets[group].path;
+		batch->sets[w] = batch->sets[i];
+		batch->sets[w++].path = path;
+		group = i + 1;
+	}
+	journal_sort_records( batch->sets + first, scratch, w - first );
+
+	e = &batch->entries[batch->count++];
+	memset( e, 0, sizeof(*e) );
+	e->op = CONFIG_JOURNAL_SETS;
+	e->first = first;
+	e->sets = w - first;
+	batch->set_count = w;
+}
+
+/* Coalesce the journal into a new buffer of the same size.  Returns 0 if there is no memory to do it. */
+static int journal_compact( void )
+{
+	config_journal_batch_t	batch;
+	char					*buf;
+	size_t					used = JOURNAL_MAGIC_LEN;
+	unsigned int			i, k;
+
+	if ( NULL == (buf = CONFIG_ALLOC_LARGE( journal_size )) )
+		return 0;
+	if ( CONFIG_SUCCESS != config_journal_parse( journal_buf, journal_used, &batch ) )
+	{
+		CONFIG_FREE_LARGE( buf );
+		return 0;
+	}
+
+	/* coalescing never makes a record longer, so everything fits */
+	memcpy( buf, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN );
+	for ( i = 0; i < batch.count; i++ )
+	{
+		const config_journal_entry_t *e = &batch.entries[i];
+
+		if ( CONFIG_JOURNAL_SETS != e->op )
+		{
+			journal_put( buf, &used, journal_size, e->op, e->path, strlen(e->path), "", 0, e->data, e->data_len );
+			continue;
+		}
+		for ( k = e->first; k < e->first + e->sets; k++ )
+		{
+			const config_flat_entry_t *s = &batch.sets[k];
+
+			if ( s->str )
+				journal_put( buf, &used, journal_size, CONFIG_JOURNAL_SET_STR, s->path, strlen(s->path), "", 0, s->str, s->str_len );
+			else
+				journal_put( buf, &used, journal_size, CONFIG_JOURNAL_SET_INT, s->path, strlen(s->path), "", 0, &s->val, sizeof(s->val) );
+		}
+	}
+	config_journal_free( &batch );
+
+	CONFIG_FREE_LARGE( journal_buf );
+	journal_buf = buf;
+	journal_used = used;
+	return 1;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_journal_start_run( size_t size )
+{
+	char *buf = NULL;
+
+	/* room for the magic and at least one small record */
+	if ( size && size < 64 )
+		return CONFIG_ERR_NO_RESOURCES;
+	if ( size && NULL == (buf = CONFIG_ALLOC_LARGE( size )) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	config_journal_deinit();
+	if ( buf )
+	{
+		memcpy( buf, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN );
+		journal_buf = buf;
+		journal_size = size;
+		journal_used = JOURNAL_MAGIC_LEN;
+	}
+	return CONFIG_SUCCESS;
+}
+
+int config_journal_active( void )
+{
+	return NULL != journal_buf && ! journal_lost;
+}
+
+/* Append a record, coalescing the journal once if it is full; if it still does not fit the journal is lost. */
+static void journal_append( config_journal_op_t op, const char *path, size_t path_len, const char *name, const void *data, size_t data_len )
+{
+	if ( journal_put( journal_buf, &journal_used, journal_size, op, path, path_len, name, strlen(name), data, data_len ) )
+		return;
+	if ( journal_compact()
+	  && journal_put( journal_buf, &journal_used, journal_size, op, path, path_len, name, strlen(name), data, data_len ) )
+		return;
+	journal_lost = 1;
+}
+
+void config_journal_record( config_journal_op_t op, config_ref_t node_ref, const char *name, const void *data, size_t data_len )
+{
+	const char	*path;
+	size_t		path_len;
+
+	if ( ! config_journal_active() || ! journal_path( node_ref, &path, &path_len ) )
+		return;
+
+	journal_append( op, path, path_len, name, data, data_len );
+}
+
+void config_journal_record_array( config_ref_t node_ref, const char *name, const char *list )
+{
+	size_t	name_len = strlen( name ), list_len = strlen( list ), len = name_len + 3 + list_len;
+	char	*text;
+
+	if ( ! config_journal_active() )
+		return;
+	if ( NULL == (text = CONFIG_ALLOC( len + 1 )) )
+	{
+		journal_lost = 1;
+		return;
+	}
+
+	memcpy( text, name, name_len );
+	memcpy( text + name_len, " = ", 3 );
+	memcpy( text + name_len + 3, list, list_len + 1 );
+	config_journal_record( CONFIG_JOURNAL_LOAD, node_ref, "", text, len );
+	CONFIG_FREE( text );
+}
+
+void config_journal_hold( config_journal_op_t op, config_ref_t node_ref )
+{
+	const char	*path;
+
+	held_op = 0;
+	if ( ! config_journal_active() || ! journal_path( node_ref, &path, &held_len ) )
+		return;
+
+	memcpy( held_path, path, held_len );
+	held_path[held_len] = '\0';
+	held_op = op;
+}
+
+void config_journal_commit( void )
+{
+	if ( held_op && config_journal_active() )
+		journal_append( (config_journal_op_t) held_op, held_path, held_len, "", "", 0 );
+	held_op = 0;
+}
+
+void config_journal_forget( void )
+{
+	memo_valid = 0;
+}
+
+config_result_t config_journal_save_run( char *buf, size_t bufsize, size_t *len )
+{
+	if ( NULL == journal_buf )
+		return CONFIG_ERR_NOT_FOUND;
+	if ( journal_lost )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	*len = journal_used;
+	if ( journal_used > bufsize )
+		return CONFIG_ERR_NO_RESOURCES;
+	memcpy( buf, journal_buf, journal_used );
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_journal_parse( const char *data, size_t len, config_journal_batch_t *batch )
+{
+	config_journal_rec_t	rec;
+	size_t					pos, rec_len;
+	unsigned int			records = 0, run = 0;
+	config_journal_entry_t	*e;
+	config_flat_entry_t		*s;
+	const char				*path, *value;
+
+	memset( batch, 0, sizeof(*batch) );
+	if ( len < JOURNAL_MAGIC_LEN || memcmp( data, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	/* check every record before anything is allocated */
+	for ( pos = JOURNAL_MAGIC_LEN; pos < len; pos += rec_len )
+	{
+		if ( len - pos < sizeof(rec) )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		memcpy( &rec, data + pos, sizeof(rec) );
+		rec_len = JOURNAL_ALIGN( sizeof(rec) + (size_t) rec.path_len + 1 + (size_t) rec.data_len + 1 );
+		if ( rec_len > len - pos || rec.op < CONFIG_JOURNAL_SET_INT || rec.op > CONFIG_JOURNAL_REMOVE )
+			return CONFIG_ERR_INVALID_REFERENCE;
+
+		path = data + pos + sizeof(rec);
+		value = path + rec.path_len + 1;
+		if ( '\0' != path[rec.path_len] || strlen( path ) != rec.path_len || '\0' != value[rec.data_len] )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		if ( CONFIG_JOURNAL_SET_INT == rec.op && sizeof(int) != rec.data_len )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		records++;
+	}
+	if ( 0 == records )
+		return CONFIG_SUCCESS;
+
+	/* the second half of the set array is the sort's scratch space */
+	batch->entries = CONFIG_ALLOC_LARGE( records * sizeof(*batch->entries) );
+	batch->sets = CONFIG_ALLOC_LARGE( 2 * records * sizeof(*batch->sets) );
+	if ( NULL == batch->entries || NULL == batch->sets )
+	{
+		config_journal_free( batch );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	for ( pos = JOURNAL_MAGIC_LEN; pos < len; pos += rec_len )
+	{
+		memcpy( &rec, data + pos, sizeof(rec) );
+		rec_len = JOURNAL_ALIGN( sizeof(rec) + (size_t) rec.path_len + 1 + (size_t) rec.data_len + 1 );
+		path = data + pos + sizeof(rec);
+		value = path + rec.path_len + 1;
+
+		if ( CONFIG_JOURNAL_SET_INT == rec.op || CONFIG_JOURNAL_SET_STR == rec.op )
+		{
+			s = &batch->sets[batch->set_count++];
+			memset( s, 0, sizeof(*s) );
+			s->path = path;
+			if ( CONFIG_JOURNAL_SET_STR == rec.op )
+			{
+				s->str = value;
+				s->str_len = rec.data_len;
+			}
+			else
+				memcpy( &s->val, value, sizeof(s->val) );
+			continue;
+		}
+
+		/* a load or removal ends the run of sets before it */
+		journal_close_run( batch, run, batch->sets + records );
+		run = batch->set_count;
+
+		e = &batch->entries[batch->count++];
+		memset( e, 0, sizeof(*e) );
+		e->op = (config_journal_op_t) rec.op;
+		e->path = path;
+		e->data = value;
+		e->data_len = rec.data_len;
+	}
+	journal_close_run( batch, run, batch->sets + records );
+
+	return CONFIG_SUCCESS;
+}
+
+void config_journal_free( config_journal_batch_t *batch )
+{
+	if ( batch->entries )
+		CONFIG_FREE_LARGE( batch->entries );
+	if ( batch->sets )
+		CONFIG_FREE_LARGE( batch->sets );
+	memset( batch, 0, sizeof(*batch) );
+}
+
+void config_journal_deinit( void )
+{
+	if ( journal_buf )
+		CONFIG_FREE_LARGE( journal_buf );
+	journal_buf = NULL;
+	journal_size = journal_used = 0;
+	journal_lost = 0;
+	memo_valid = 0;
+}
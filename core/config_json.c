@@ -0,0 +1,630 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * JSON import and export.
+ *
+ * Import maps objects to nodes, integers (and true/false) to int values,
+ * strings to string values, null to a node without a value, and arrays of
+ * integers to packed integer arrays (see config_array.c).  It is a single
+ * forward pass over the text that writes into the database as it goes: no
+ * document tree is built, and the only state is the stack of open objects.
+ * White space is skipped through a character class table, and strings
+ * without escapes are handed to htuple straight from the input buffer.
+ *
+ * Export writes the merged view of a subtree as compact JSON.  A node that
+ * has children becomes an object and any value of its own is not exported.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+#define JSON_SPACE			0x01
+#define JSON_DIGIT			0x02
+#define JSON_NUMBER			0x04		/* may start a number */
+#define JSON_NAME			0x08		/* may appear in a member name */
+
+#define JSON_LETTERS( c )	[c] = JSON_NAME, [c + 32] = JSON_NAME
+
+static const unsigned char json_class[256] = {
+	['\t'] = JSON_SPACE, ['\n'] = JSON_SPACE, ['\r'] = JSON_SPACE, [' '] = JSON_SPACE,
+	['-'] = JSON_NUMBER | JSON_NAME, ['_'] = JSON_NAME,
+	['0'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME, ['1'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME,
+	['2'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME, ['3'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME,
+	['4'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME, ['5'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME,
+	['6'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME, ['7'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME,
+	['8'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME, ['9'] = JSON_DIGIT | JSON_NUMBER | JSON_NAME,
+	JSON_LETTERS( 'A' ), JSON_LETTERS( 'B' ), JSON_LETTERS( 'C' ), JSON_LETTERS( 'D' ), JSON_LETTERS( 'E' ),
+	JSON_LETTERS( 'F' ), JSON_LETTERS( 'G' ), JSON_LETTERS( 'H' ), JSON_LETTERS( 'I' ), JSON_LETTERS( 'J' ),
+	JSON_LETTERS( 'K' ), JSON_LETTERS( 'L' ), JSON_LETTERS( 'M' ), JSON_LETTERS( 'N' ), JSON_LETTERS( 'O' ),
+	JSON_LETTERS( 'P' ), JSON_LETTERS( 'Q' ), JSON_LETTERS( 'R' ), JSON_LETTERS( 'S' ), JSON_LETTERS( 'T' ),
+	JSON_LETTERS( 'U' ), JSON_LETTERS( 'V' ), JSON_LETTERS( 'W' ), JSON_LETTERS( 'X' ), JSON_LETTERS( 'Y' ),
+	JSON_LETTERS( 'Z' ),
+};
+
+#define JSON_IS( c, cls )	( json_class[(unsigned char) (c)] & (cls) )
+
+typedef struct {
+	const char	*p;
+	const char	*end;
+	char		*scratch;		/* decoded strings that had escapes */
+	size_t		scratch_size;
+} json_in_t;
+
+static void json_skip_space( json_in_t *in )
+{
+	while ( in->p < in->end && JSON_IS( *in->p, JSON_SPACE ) )
+		in->p++;
+}
+
+static int json_hex( char c )
+{
+	if ( c >= '0' && c <= '9' )
+		return c - '0';
+	if ( c >= 'a' && c <= 'f' )
+		return c - 'a' + 10;
+	if ( c >= 'A' && c <= 'F' )
+		return c - 'A' + 10;
+	return -1;
+}
+
+/*
+ * Scan the string at in->p (just past the opening quote).  *str and *len give its
+ * contents: in the input itself when there are no escapes, else decoded into
+ * the scratch buffer.  Returns 0 on malformed input.
+ */
+/* The four hex digits at s[0..3], which must all be before end. */
+static int json_hex4( const char *s, const char *end, unsigned int *cp )
+{
+	int i;
+
+	for ( *cp = 0, i = 0; i < 4; i++ )
+	{
+		if ( s + i >= end || json_hex( s[i] ) < 0 )
+			return 0;
+		*cp = (*cp << 4) | json_hex( s[i] );
+	}
+	return 1;
+}
+
+static int json_string( json_in_t *in, const char **str, size_t *len )
+{
+	const char	*start = in->p, *s;
+	char		*out;
+	size_t		n = 0;
+
+	for ( s = start; s < in->end && '"' != *s && '\\' != *s; s++ )
+		;
+	if ( s == in->end )
+		return 0;
+	if ( '"' == *s )
+	{
+		*str = start;
+		*len = s - start;
+		in->p = s + 1;
+		return 1;
+	}
+
+	/* escapes only ever shrink the text, so the raw length is enough */
+	for ( ; s < in->end && '"' != *s; s++ )
+		if ( '\\' == *s && ++s == in->end )
+			return 0;
+	if ( s == in->end )
+		return 0;
+	if ( (size_t) (s - start) > in->scratch_size )
+	{
+		if ( in->scratch )
+			CONFIG_FREE_LARGE( in->scratch );
+		in->scratch_size = s - start;
+		if ( NULL == (in->scratch = CONFIG_ALLOC_LARGE( in->scratch_size )) )
+		{
+			in->scratch_size = 0;
+			return 0;
+		}
+	}
+
+	out = in->scratch;
+	for ( s = start; '"' != *s; s++ )
+	{
+		unsigned int cp, low;
+
+		if ( '\\' != *s )
+		{
+			out[n++] = *s;
+			continue;
+		}
+		switch ( *++s )
+		{
+		case '"': case '\\': case '/':	out[n++] = *s;		break;
+		case 'b':						out[n++] = '\b';	break;
+		case 'f':						out[n++] = '\f';	break;
+		case 'n':						out[n++] = '\n';	break;
+		case 'r':						out[n++] = '\r';	break;
+		case 't':						out[n++] = '\t';	break;
+		case 'u':
+			/* \uXXXX is six input bytes and at most three UTF-8 bytes out; a surrogate pair is twelve and four */
+			if ( ! json_hex4( s + 1, in->end, &cp ) )
+				return 0;
+			s += 4;
+			/* a value is a C string, so it cannot hold a NUL */
+			if ( 0 == cp || (cp >= 0xdc00 && cp <= 0xdfff) )
+				return 0;
+			if ( cp >= 0xd800 && cp <= 0xdbff )
+			{
+				if ( s + 2 >= in->end || '\\' != s[1] || 'u' != s[2] || ! json_hex4( s + 3, in->end, &low )
+				  || low < 0xdc00 || low > 0xdfff )
+					return 0;
+				s += 6;
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+				out[n++] = (char) (0xf0 | (cp >> 18));
+				out[n++] = (char) (0x80 | ((cp >> 12) & 0x3f));
+				out[n++] = (char) (0x80 | ((cp >> 6) & 0x3f));
+				out[n++] = (char) (0x80 | (cp & 0x3f));
+			}
+			else if ( cp < 0x80 )
+				out[n++] = (char) cp;
+			else if ( cp < 0x800 )
+			{
+				out[n++] = (char) (0xc0 | (cp >> 6));
+				out[n++] = (char) (0x80 | (cp & 0x3f));
+			}
+			else
+			{
+				out[n++] = (char) (0xe0 | (cp >> 12));
+				out[n++] = (char) (0x80 | ((cp >> 6) & 0x3f));
+				out[n++] = (char) (0x80 | (cp & 0x3f));
+			}
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	*str = in->scratch;
+	*len = n;
+	in->p = s + 1;
+	return 1;
+}
+
+/* Scan an integer: anything that fits in 32 bits like an int node value, up to 0xffffffff and down to INT_MIN. */
+static int json_int( json_in_t *in, int *val )
+{
+	unsigned long long	v = 0;
+	int					negative = 0;
+	const char			*digits;
+
+	if ( '-' == *in->p )
+	{
+		negative = 1;
+		in->p++;
+	}
+	for ( digits = in->p; in->p < in->end && JSON_IS( *in->p, JSON_DIGIT ); in->p++ )
+	{
+		v = v * 10 + (*in->p - '0');
+		if ( v > (negative ? 0x80000000ULL : 0xffffffffULL) )
+			return 0;
+	}
+	/* JSON numbers have no leading zeros */
+	if ( in->p == digits || ('0' == *digits && in->p - digits > 1) )
+		return 0;
+	/* no fractions or exponents: the database has no floating point */
+	if ( in->p < in->end && ('.' == *in->p || 'e' == *in->p || 'E' == *in->p) )
+		return 0;
+
+	*val = (int) (unsigned int) (negative ? 0 - v : v);
+	return 1;
+}
+
+static int json_literal( json_in_t *in, const char *word, size_t len )
+{
+	if ( (size_t) (in->end - in->p) < len || memcmp( in->p, word, len ) )
+		return 0;
+	in->p += len;
+	return 1;
+}
+
+/* Rewrite the integer array at in->p (just past '[') into the tagged packed array text ("\x1f[1,2,3]") in the scratch buffer. */
+static int json_array( json_in_t *in, const char **str, size_t *len )
+{
+	const char	*close;
+	size_t		n = 0;
+	int			val;
+
+	/* the packed form is never longer than the JSON text and the tag */
+	for ( close = in->p; close < in->end && ']' != *close; close++ )
+		;
+	if ( close == in->end )
+		return 0;
+	if ( (size_t) (close - in->p) + 3 > in->scratch_size )
+	{
+		if ( in->scratch )
+			CONFIG_FREE_LARGE( in->scratch );
+		in->scratch_size = (close - in->p) + 3;
+		if ( NULL == (in->scratch = CONFIG_ALLOC_LARGE( in->scratch_size )) )
+		{
+			in->scratch_size = 0;
+			return 0;
+		}
+	}
+
+	in->scratch[n++] = CONFIG_ARRAY_TAG;
+	in->scratch[n++] = '[';
+	json_skip_space( in );
+	while ( ']' != *in->p )
+	{
+		const char *start = in->p;
+
+		if ( n > 2 )
+		{
+			if ( ',' != *in->p++ )
+				return 0;
+			json_skip_space( in );
+			in->scratch[n++] = ',';
+			start = in->p;
+		}
+		if ( ! json_int( in, &val ) )
+			return 0;
+		memcpy( in->scratch + n, start, in->p - start );
+		n += in->p - start;
+		json_skip_space( in );
+	}
+	in->p++;
+	in->scratch[n++] = ']';
+
+	*str = in->scratch;
+	*len = n;
+	return 1;
+}
+
+/* Names become path components and native-format names, so they must be usable as both. */
+static int json_name_ok( const char *name, size_t len )
+{
+	size_t i;
+
+	if ( 0 == len || len > CONFIG_TREE_MAX_NAME )
+		return 0;
+	for ( i = 0; i < len; i++ )
+		if ( ! JSON_IS( name[i], JSON_NAME ) )
+			return 0;
+	return 1;
+}
+
+static config_result_t json_import( json_in_t *in, config_ref_t target_ref )
+{
+	config_ref_t	stack[CONFIG_JSON_MAX_DEPTH];
+	unsigned int	depth = 0;
+	char			name[CONFIG_TREE_MAX_NAME + 1];
+	size_t			name_len;
+	const char		*str;
+	size_t			len;
+	int				val, first = 1;
+
+	json_skip_space( in );
+	if ( in->p == in->end || '{' != *in->p++ )
+		return CONFIG_ERR_INVALID_REFERENCE;
+	stack[0] = target_ref;
+
+	for ( ;; )
+	{
+		config_ref_t	parent_ref = stack[depth];
+		config_result_t	err = CONFIG_SUCCESS;
+		int				array = -1;		/* 1 if the member's value is an array, 0 another value, -1 none */
+
+		/* where a member may start: '}' closes the object, otherwise (after a ',' unless first) a "name": */
+		json_skip_space( in );
+		if ( in->p == in->end )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		if ( '}' == *in->p )
+		{
+			in->p++;
+			if ( 0 == depth-- )
+				break;
+			first = 0;
+			continue;
+		}
+		if ( ! first )
+		{
+			if ( ',' != *in->p++ )
+				return CONFIG_ERR_INVALID_REFERENCE;
+			json_skip_space( in );
+		}
+		first = 0;
+
+		if ( in->p == in->end || '"' != *in->p++ || ! json_string( in, &str, &len ) || ! json_name_ok( str, len ) )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		/* the value may be decoded into the scratch buffer too */
+		memcpy( name, str, len );
+		name_len = len;
+		name[name_len] = '\0';
+
+		json_skip_space( in );
+		if ( in->p == in->end || ':' != *in->p++ )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		json_skip_space( in );
+		if ( in->p == in->end )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		if ( CONFIG_SUCCESS != (err = config_epoch_claim( parent_ref, name, name_len )) )
+			return err;
+
+		switch ( *in->p )
+		{
+		case '{':
+			in->p++;
+			if ( depth + 1 == CONFIG_JSON_MAX_DEPTH )
+				return CONFIG_ERR_NO_RESOURCES;
+			if ( 0 == (stack[depth + 1] = config_tree_add_child( parent_ref, name, name_len )) )
+				return CONFIG_ERR_NO_RESOURCES;
+			depth++;
+			first = 1;
+			break;
+
+		case '"':
+			in->p++;
+			if ( ! json_string( in, &str, &len ) )
+				return CONFIG_ERR_INVALID_REFERENCE;
+			err = htuple_set_str_value( parent_ref, name, name_len, str, len );
+			array = 0;
+			break;
+
+		case '[':
+			in->p++;
+			if ( ! json_array( in, &str, &len ) )
+				return CONFIG_ERR_INVALID_REFERENCE;
+			err = htuple_set_str_value( parent_ref, name, name_len, str, len );
+			array = 1;
+			break;
+
+		case 't':
+		case 'f':
+			val = ( 't' == *in->p );
+			if ( ! json_literal( in, val ? "true" : "false", val ? 4 : 5 ) )
+				return CONFIG_ERR_INVALID_REFERENCE;
+			err = htuple_set_int_value( parent_ref, name, name_len, val );
+			array = 0;
+			break;
+
+		case 'n':
+			if ( ! json_literal( in, "null", 4 ) )
+				return CONFIG_ERR_INVALID_REFERENCE;
+			if ( 0 == config_tree_add_child( parent_ref, name, name_len ) )
+				return CONFIG_ERR_NO_RESOURCES;
+			break;
+
+		default:
+			if ( ! JSON_IS( *in->p, JSON_NUMBER ) || ! json_int( in, &val ) )
+				return CONFIG_ERR_INVALID_REFERENCE;
+			err = htuple_set_int_value( parent_ref, name, name_len, val );
+			array = 0;
+			break;
+		}
+		/* whatever the node held before, it is an array now exactly when the value is one */
+		if ( CONFIG_SUCCESS == err && array >= 0 )
+			err = config_array_mark( parent_ref, name, name_len, array );
+		if ( CONFIG_SUCCESS != err )
+			return err;
+	}
+
+	/* nothing but white space may follow the top-level object */
+	json_skip_space( in );
+	return ( in->p == in->end ) ? CONFIG_SUCCESS : CONFIG_ERR_INVALID_REFERENCE;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* Export                                                                            */
+/* -------------------------------------------------------------------------------- */
+
+typedef struct {
+	char	*buf;
+	size_t	size;
+	size_t	len;			/* bytes needed so far; may run past size */
+} json_out_t;
+
+static void json_put( json_out_t *out, const char *data, size_t len )
+{
+	if ( out->len < out->size )
+		memcpy( out->buf + out->len, data, (out->size - out->len < len) ? out->size - out->len : len );
+	out->len += len;
+}
+
+static void json_put_int( json_out_t *out, int val )
+{
+	char			digits[12];
+	unsigned int	v = (val < 0) ? 0u - (unsigned int) val : (unsigned int) val;
+	size_t			n = sizeof(digits);
+
+	do
+	{
+		digits[--n] = (char) ('0' + v % 10);
+		v /= 10;
+	} while ( v );
+	if ( val < 0 )
+		digits[--n] = '-';
+	json_put( out, digits + n, sizeof(digits) - n );
+}
+
+static void json_put_string( json_out_t *out, const char *str )
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *run = str;
+
+	json_put( out, "\"", 1 );
+	for ( ; *str; str++ )
+	{
+		unsigned char	c = (unsigned char) *str;
+		char			esc[6];
+
+		if ( c >= 0x20 && '"' != c && '\\' != c )
+			continue;
+
+		json_put( out, run, str - run );
+		run = str + 1;
+		esc[0] = '\\';
+		switch ( c )
+		{
+		case '"':	esc[1] = '"';	json_put( out, esc, 2 );	break;
+		case '\\':	esc[1] = '\\';	json_put( out, esc, 2 );	break;
+		case '\n':	esc[1] = 'n';	json_put( out, esc, 2 );	break;
+		case '\r':	esc[1] = 'r';	json_put( out, esc, 2 );	break;
+		case '\t':	esc[1] = 't';	json_put( out, esc, 2 );	break;
+		default:
+			esc[1] = 'u';
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			json_put( out, esc, 6 );
+			break;
+		}
+	}
+	json_put( out, run, str - run );
+	json_put( out, "\"", 1 );
+}
+
+static void json_export( json_out_t *out, config_ref_t node_ref )
+{
+	config_ref_t	child = config_overlay_first_child( node_ref );
+	const int		*values;
+	unsigned int	count, i;
+	const char		*str;
+	int				val;
+
+	if ( child )
+	{
+		json_put( out, "{", 1 );
+		for ( i = 0; child; child = config_overlay_next_sibling( child ), i++ )
+		{
+			if ( CONFIG_SUCCESS != htuple_node_name( child, &str ) )
+				continue;
+			if ( i )
+				json_put( out, ",", 1 );
+			json_put_string( out, str );
+			json_put( out, ":", 1 );
+			json_export( out, child );
+		}
+		json_put( out, "}", 1 );
+	}
+	else if ( CONFIG_SUCCESS == htuple_node_int_value( node_ref, &val ) )
+		json_put_int( out, val );
+	else if ( CONFIG_SUCCESS == config_array_get( node_ref, &values, &count ) )
+	{
+		json_put( out, "[", 1 );
+		for ( i = 0; i < count; i++ )
+		{
+			if ( i )
+				json_put( out, ",", 1 );
+			json_put_int( out, values[i] );
+		}
+		json_put( out, "]", 1 );
+	}
+	else if ( CONFIG_SUCCESS == htuple_node_str_value( node_ref, &str ) )
+		json_put_string( out, str );
+	else
+		json_put( out, "null", 4 );
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_json_import( config_ref_t target_ref, const char *data, size_t len )
+{
+	json_in_t		in;
+	config_result_t	err;
+
+	memset( &in, 0, sizeof(in) );
+	in.p = data;
+	in.end = data + len;
+
+	err = json_import( &in, target_ref );
+
+	if ( in.scratch )
+		CONFIG_FREE_LARGE( in.scratch );
+	return err;
+}
+
+config_result_t config_json_export( config_ref_t node_ref, char *buf, size_t bufsize, size_t *len )
+{
+	json_out_t out;
+
+	out.buf = buf;
+	out.size = bufsize;
+	out.len = 0;
+
+	json_export( &out, config_overlay_top( node_ref ) );
+	json_put( &out, "", 1 );
+
+	*len = out.len;
+	if ( out.len > bufsize )
+	{
+		/* keep what fits a string */
+		if ( bufsize )
+			buf[bufsize - 1] = '\0';
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	return CONFIG_SUCCESS;
+}
+
+int config_json_name_ok( const char *name, size_t len )
+{
+	return json_name_ok( name, len );
+}
@@ -0,0 +1,276 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Physical address index over the memory layout.
+ *
+ * Every entry under CONFIG_PATH_PLATFORM_MEMORY_LAYOUT with integer "base"
+ * and "size" values is kept as an interval [base, base + size) in a vector
+ * sorted by base.  Alongside each interval the vector records the largest end
+ * of any interval at or before it, which is what lets a lookup stop early
+ * when entries overlap: binary search finds the last interval starting at or
+ * below the address, and the walk back towards lower bases ends as soon as
+ * that running maximum shows nothing further back can reach the address.
+ * With non-overlapping entries a lookup is a single binary search.
+ *
+ * The vector is built on the first lookup.  Writes of "base" or "size" to an
+ * indexed entry (config_pmrs rewrites every base) move just that interval;
+ * any other change that could touch the layout drops the vector, and the
+ * next lookup builds it again.
+ */
+
+#include "platform_config_core_private.h"
+#include "platform_config_paths.h"
+#include "htuple.h"
+
+typedef struct {
+	unsigned long long	base;
+	unsigned long long	end;			/* base + size */
+	unsigned long long	max_end;		/* of this and every earlier interval */
+	config_ref_t		node_ref;
+} layout_interval_t;
+
+static layout_interval_t	*layout_vec;
+static unsigned int			layout_count;
+static config_refmap_t		layout_slot;		/* entry node -> index in layout_vec */
+static config_ref_t			layout_ref;			/* the layout node the vector describes */
+static int					layout_valid;
+
+/* Read an entry's interval.  Returns 0 if it is not a (non-empty) interval. */
+static int layout_read( config_ref_t entry_ref, layout_interval_t *iv )
+{
+	config_ref_t	ref;
+	int				base, size;
+
+	if ( CONFIG_SUCCESS != config_resolve( entry_ref, "base", 4, CONFIG_RESOLVE_READ, &ref ) || CONFIG_SUCCESS != config_value_int( ref, &base ) )
+		return 0;
+	if ( CONFIG_SUCCESS != config_resolve( entry_ref, "size", 4, CONFIG_RESOLVE_READ, &ref ) || CONFIG_SUCCESS != config_value_int( ref, &size ) )
+		return 0;
+	if ( 0 == size )
+		return 0;
+
+	/* layout values are 32-bit addresses and sizes */
+	iv->base = (unsigned int) base;
+	iv->end = iv->base + (unsigned int) size;
+	iv->node_ref = entry_ref;
+	return 1;
+}
+
+/* Recompute max_end and the slot map from index from on. */
+static void layout_fixup( unsigned int from )
+{
+	unsigned int i;
+
+	for ( i = from; i < layout_count; i++ )
+	{
+		layout_vec[i].max_end = layout_vec[i].end;
+		if ( i > 0 && layout_vec[i - 1].max_end > layout_vec[i].max_end )
+			layout_vec[i].max_end = layout_vec[i - 1].max_end;
+		config_refmap_put( &layout_slot, layout_vec[i].node_ref, i );
+	}
+}
+
+/* Put iv into the sorted vector, which has room for it. Returns its index. */
+static unsigned int layout_insert( const layout_interval_t *iv )
+{
+	unsigned int i = layout_count;
+
+	while ( i > 0 && layout_vec[i - 1].base > iv->base )
+	{
+		layout_vec[i] = layout_vec[i - 1];
+		i--;
+	}
+	layout_vec[i] = *iv;
+	layout_count++;
+	return i;
+}
+
+static void layout_release( void )
+{
+	if ( layout_vec )
+		CONFIG_FREE_LARGE( layout_vec );
+	layout_vec = NULL;
+	layout_count = 0;
+	config_refmap_free( &layout_slot );
+	layout_ref = 0;
+	layout_valid = 0;
+}
+
+static config_result_t layout_build( void )
+{
+	config_ref_t		entry_ref;
+	layout_interval_t	iv;
+	unsigned int		n = 0;
+
+	layout_release();
+	if ( CONFIG_SUCCESS != config_resolve( ROOT_NODE, CONFIG_PATH_PLATFORM_MEMORY_LAYOUT,
+	                                       sizeof(CONFIG_PATH_PLATFORM_MEMORY_LAYOUT) - 1, CONFIG_RESOLVE_REF, &layout_ref ) )
+		return CONFIG_ERR_NOT_FOUND;
+	/* entries are handed out by config_layout_lookup_pa() */
+	config_dedup_unalias( layout_ref );
+
+	for ( entry_ref = config_overlay_first_child( layout_ref ); entry_ref; entry_ref = config_overlay_next_sibling( entry_ref ) )
+		n++;
+
+	if ( n && NULL == (layout_vec = CONFIG_ALLOC_LARGE( n * sizeof(*layout_vec) )) )
+	{
+		layout_release();
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	for ( entry_ref = config_overlay_first_child( layout_ref ); entry_ref; entry_ref = config_overlay_next_sibling( entry_ref ) )
+		if ( layout_read( entry_ref, &iv ) )
+			layout_insert( &iv );
+
+	layout_fixup( 0 );
+	if ( layout_slot.count != layout_count )
+	{
+		/* the slot map could not grow */
+		layout_release();
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	layout_valid = 1;
+	return CONFIG_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_layout_lookup( unsigned long pa, config_ref_t *node_ref, unsigned long *offset )
+{
+	config_result_t	err;
+	unsigned int	lo = 0, hi;
+
+	if ( ! layout_valid && CONFIG_SUCCESS != (err = layout_build()) )
+		return err;
+
+	/* lo = number of intervals starting at or below pa */
+	hi = layout_count;
+	while ( lo < hi )
+	{
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if ( layout_vec[mid].base <= pa )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* the nearest start wins when intervals overlap */
+	while ( lo > 0 && layout_vec[lo - 1].max_end > pa )
+	{
+		lo--;
+		if ( layout_vec[lo].end > pa )
+		{
+			*node_ref = layout_vec[lo].node_ref;
+			if ( offset )
+				*offset = (unsigned long) (pa - layout_vec[lo].base);
+			return CONFIG_SUCCESS;
+		}
+	}
+
+	return CONFIG_ERR_NOT_FOUND;
+}
+
+void config_layout_value_changed( config_ref_t parent_ref, const char *leaf )
+{
+	layout_interval_t	iv;
+	unsigned long		slot;
+	unsigned int		i;
+
+	if ( ! layout_valid )
+		return;
+
+	if ( ! config_refmap_get( &layout_slot, parent_ref, &slot ) )
+	{
+		/* anything else might have added, replaced or reshaped a layout entry */
+		layout_valid = 0;
+		return;
+	}
+
+	if ( strcmp( leaf, "base" ) && strcmp( leaf, "size" ) )
+		return;
+
+	/* take the interval out, and put it back where it now belongs */
+	i = (unsigned int) slot;
+	config_refmap_del( &layout_slot, parent_ref );
+	for ( ; i + 1 < layout_count; i++ )
+		layout_vec[i] = layout_vec[i + 1];
+	layout_count--;
+
+	if ( layout_read( parent_ref, &iv ) )
+		i = layout_insert( &iv );
+	layout_fixup( (unsigned int) slot < i ? (unsigned int) slot : i );
+}
+
+void config_layout_invalidate( void )
+{
+	layout_valid = 0;
+}
+
+void config_layout_deinit( void )
+{
+	layout_release();
+}
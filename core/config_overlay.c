@@ -0,0 +1,703 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Overlay layers.
+ *
+ * The database proper is the bottom layer.  config_overlay_push() stacks
+ * empty layers above it, each a private htuple tree under a hidden holder
+ * node, which callers fill with config_load() on the returned layer root.
+ * Through ROOT_NODE the layers read as one tree: a lookup takes the first
+ * layer from the top that has the name, enumeration lists each name once
+ * (from the highest layer holding it), and writes go to the top layer.  A
+ * write below a node that only exists in a lower layer creates the missing
+ * (valueless) path in the top layer; values are never copied between layers.
+ *
+ * A node that came out of an overlaid lookup or enumeration is "tracked": the
+ * logical parent it was reached through is recorded, 0 standing for the
+ * merged root.  From that record the core can find the node with the same
+ * path one layer further down ("below") and the node that now shadows it
+ * from above ("top"), so lookups relative to any handed-out reference see
+ * every layer.  Both answers are memoized until the tree next changes shape.
+ * References taken before the first layer was pushed are not tracked and
+ * keep resolving in their own layer.
+ *
+ * A namespace is one more layer, private to whoever is bound to it, that
+ * sits above all the shared ones.  Tracking and memos are kept per view
+ * (the shared one plus one per namespace), since the same shared node can be
+ * reached from several views with different results.  The core selects the
+ * caller's view with config_overlay_view() on every call; from a namespace
+ * the merged root starts at the namespace root, so reads fall through to the
+ * shared layers and writes land in the namespace.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+/* Name of the hidden child of the root node holding one node per layer */
+#define OVERLAY_HOLDER_NAME		"__platform_config_overlays"
+
+typedef struct {
+	char			name[CONFIG_OVERLAY_MAX_NAME + 1];
+	config_ref_t	root;
+} config_overlay_layer_t;
+
+/* layers[0] sits directly above the database, layers[overlay_count - 1] is the top */
+static config_overlay_layer_t	layers[CONFIG_OVERLAY_MAX_LAYERS];
+static unsigned int				overlay_count;
+static unsigned int				overlay_seq;
+static config_ref_t				overlay_holder;
+
+typedef struct {
+	config_ref_t		root;			/* namespace root; 0 for the shared view */
+	config_refmap_t		parent;			/* tracked node -> logical parent */
+	config_refmap_t		below;			/* memo: node -> node below + 1, or 0 */
+	config_refmap_t		top;			/* memo: node -> node shadowing it */
+} config_overlay_view_t;
+
+static config_overlay_view_t	overlay_shared;
+static config_overlay_view_t	namespaces[CONFIG_NAMESPACE_MAX];	/* root 0 marks a free slot */
+static unsigned int				namespace_count;
+static config_overlay_view_t	*view = &overlay_shared;			/* the caller's */
+
+#define OVERLAY_ACTIVE()		(overlay_count > 0 || namespace_count > 0)
+
+/* overlay_level() of the caller's namespace root, above any shared layer */
+#define OVERLAY_NS_LEVEL		(CONFIG_OVERLAY_MAX_LAYERS + 1)
+/* Longest layer chain: a namespace, the shared layers and the database */
+#define OVERLAY_CHAIN_MAX		(CONFIG_OVERLAY_MAX_LAYERS + 2)
+
+/* All views: the shared one, then the namespaces. */
+static config_overlay_view_t *overlay_view_at( unsigned int i )
+{
+	return ( 0 == i ) ? &overlay_shared : &namespaces[i - 1];
+}
+
+/* Root of the top shared layer: where shared writes land. */
+static config_ref_t overlay_shared_top( void )
+{
+	return overlay_count ? layers[overlay_count - 1].root : 0;
+}
+
+/* Stack position of a layer root: 0 for the database root, 1.. for layers, OVERLAY_NS_LEVEL for the caller's namespace, -1 for any other node. */
+static int overlay_level( config_ref_t ref )
+{
+	unsigned int i;
+
+	if ( view->root && ref == view->root )
+		return OVERLAY_NS_LEVEL;
+	if ( 0 == ref )
+		return 0;
+	for ( i = 0; i < overlay_count; i++ )
+		if ( layers[i].root == ref )
+			return i + 1;
+	return -1;
+}
+
+/* Where the layer chain of a logical node starts: the merged root reads from the top layer (or the namespace) down. */
+static config_ref_t overlay_start( config_ref_t ref )
+{
+	if ( 0 != ref )
+		return ref;
+	return view->root ? view->root : overlay_shared_top();
+}
+
+static config_ref_t overlay_lookup( config_ref_t parent_ref, const char *name, size_t len )
+{
+	config_ref_t child = config_index_lookup( config_dedup_redirect( parent_ref ), name, len );
+
+	return ( child && child == overlay_holder ) ? 0 : child;
+}
+
+static int overlay_name( config_ref_t ref, const char **name, size_t *len )
+{
+	if ( CONFIG_SUCCESS != htuple_node_name( ref, name ) )
+		return 0;
+	*len = strlen( *name );
+	return 1;
+}
+
+static int overlay_tracked( config_ref_t ref )
+{
+	return overlay_level( ref ) >= 0 || config_refmap_get( &view->parent, ref, NULL );
+}
+
+static void overlay_track( config_ref_t ref, config_ref_t parent_ref )
+{
+	if ( overlay_tracked( parent_ref ) )
+		config_refmap_put( &view->parent, ref, parent_ref );
+}
+
+/* The node with the same path as ref in the next layer down that has one. */
+static int overlay_next_below( config_ref_t ref, config_ref_t *below_ref )
+{
+	unsigned long	memo, parent;
+	const char		*name;
+	size_t			len;
+	config_ref_t	q, hit;
+	int				level = overlay_level( ref ), passed = 0, found = 0;
+
+	if ( level >= 0 )
+	{
+		if ( 0 == level )
+			return 0;
+		if ( OVERLAY_NS_LEVEL == level )
+		{
+			*below_ref = overlay_shared_top();
+			return 1;
+		}
+		*below_ref = ( 1 == level ) ? 0 : layers[level - 2].root;
+		return 1;
+	}
+
+	if ( config_refmap_get( &view->below, ref, &memo ) )
+	{
+		*below_ref = (config_ref_t) (memo - 1);
+		return 0 != memo;
+	}
+
+	if ( config_refmap_get( &view->parent, ref, &parent ) && overlay_name( ref, &name, &len ) )
+	{
+		/* walk the parent's layers; the first hit after ref's own layer is the answer */
+		q = overlay_start( (config_ref_t) parent );
+		do
+		{
+			hit = overlay_lookup( q, name, len );
+			if ( passed && hit )
+			{
+				*below_ref = hit;
+				found = 1;
+				break;
+			}
+			if ( hit == ref )
+				passed = 1;
+		} while ( overlay_next_below( q, &q ) );
+	}
+
+	config_refmap_put( &view->below, ref, found ? (unsigned long) *below_ref + 1 : 0 );
+	return found;
+}
+
+/* Fill chain[] with ref and the nodes below it, top down.  Returns the number of entries. */
+static unsigned int overlay_chain( config_ref_t ref, config_ref_t *chain )
+{
+	unsigned int	n = 0;
+	config_ref_t	q = overlay_start( ref );
+
+	do
+		chain[n++] = q;
+	while ( n < OVERLAY_CHAIN_MAX && overlay_next_below( q, &q ) );
+
+	return n;
+}
+
+/* First child of the merged node ref, from chain[k] on, that no higher chain entry shadows. */
+static config_ref_t overlay_scan( config_ref_t ref, const config_ref_t *chain, unsigned int n, unsigned int k, config_ref_t child )
+{
+	for ( ; k < n; k++, child = (k < n) ? config_tree_first_child( chain[k] ) : 0 )
+	{
+		for ( ; child; child = config_tree_next_sibling( child ) )
+		{
+			const char		*name;
+			size_t			len;
+			unsigned int	j;
+
+			if ( child == overlay_holder || ! overlay_name( child, &name, &len ) )
+				continue;
+			for ( j = 0; j < k; j++ )
+				if ( overlay_lookup( chain[j], name, len ) )
+					break;
+			if ( j == k )
+			{
+				overlay_track( child, ref );
+				return child;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Filter a view's tracking map, dropping every entry naming a node of gone. */
+static void overlay_untrack( config_overlay_view_t *v, const config_refmap_t *gone )
+{
+	config_refmap_t	kept;
+	unsigned int	pos = 0;
+	config_ref_t	ref;
+	unsigned long	parent;
+
+	memset( &kept, 0, sizeof(kept) );
+	while ( config_refmap_next( &v->parent, &pos, &ref, &parent ) )
+		if ( ! config_refmap_get( gone, ref, NULL ) && ! config_refmap_get( gone, (config_ref_t) parent, NULL ) )
+			config_refmap_put( &kept, ref, parent );
+
+	config_refmap_free( &v->parent );
+	v->parent = kept;
+}
+
+static void overlay_collect( config_ref_t ref, config_refmap_t *set )
+{
+	config_ref_t child;
+
+	config_refmap_put( set, ref, 0 );
+	for ( child = htuple_first_child( ref ); child; child = htuple_next_sibling( child ) )
+		overlay_collect( child, set );
+}
+
+/* "layer<seq>" into buf; returns its length. */
+static size_t overlay_node_name( char *buf, unsigned int seq )
+{
+	char	digits[12];
+	size_t	n = 0, len = 5;
+
+	memcpy( buf, "layer", 5 );
+	do
+		digits[n++] = '0' + seq % 10;
+	while ( (seq /= 10) != 0 );
+	while ( n )
+		buf[len++] = digits[--n];
+	buf[len] = '\0';
+	return len;
+}
+
+/* Delete a layer (or the holder) tree and everything the core knows about it. */
+static config_result_t overlay_delete( config_ref_t root_ref )
+{
+	return config_epoch_retire( root_ref );
+}
+
+/* Delete the holder once neither layers nor namespaces need it. */
+static void overlay_release_holder( void )
+{
+	if ( 0 == overlay_count && 0 == namespace_count && overlay_holder )
+	{
+		overlay_delete( overlay_holder );
+		overlay_holder = 0;
+	}
+}
+
+/* Create the holder if needed, and a new uniquely named layer or namespace root under it. */
+static config_ref_t overlay_new_root( void )
+{
+	char			node_name[24];
+	config_ref_t	root;
+
+	if ( 0 == overlay_holder
+	  && 0 == (overlay_holder = config_tree_add_child( 0, OVERLAY_HOLDER_NAME, sizeof(OVERLAY_HOLDER_NAME) - 1 )) )
+		return 0;
+
+	/* user names are only labels; node names just have to be unique */
+	if ( 0 == (root = config_tree_add_child( overlay_holder, node_name, overlay_node_name( node_name, overlay_seq++ ) )) )
+		overlay_release_holder();
+	return root;
+}
+
+/* Non-zero if ref is node_ref or lies beneath it. */
+static int overlay_contains( config_ref_t node_ref, config_ref_t ref )
+{
+	config_ref_t child;
+
+	if ( node_ref == ref )
+		return 1;
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		if ( overlay_contains( child, ref ) )
+			return 1;
+	return 0;
+}
+
+/* The caller's namespace, or NULL when it is an invalid id. */
+static config_overlay_view_t *overlay_namespace( unsigned int ns )
+{
+	if ( 0 == ns || ns > CONFIG_NAMESPACE_MAX || 0 == namespaces[ns - 1].root )
+		return NULL;
+	return &namespaces[ns - 1];
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_ref_t config_overlay_top( config_ref_t node_ref )
+{
+	unsigned long	memo, parent;
+	const char		*name;
+	size_t			len;
+	config_ref_t	top, q, hit = 0;
+
+	if ( ! OVERLAY_ACTIVE() || overlay_level( node_ref ) >= 0 )
+		return node_ref;
+	if ( config_refmap_get( &view->top, node_ref, &memo ) )
+		return (config_ref_t) memo;
+	if ( ! config_refmap_get( &view->parent, node_ref, &parent ) || ! overlay_name( node_ref, &name, &len ) )
+		return node_ref;
+
+	top = config_overlay_top( (config_ref_t) parent );
+	q = overlay_start( top );
+	do
+		hit = overlay_lookup( q, name, len );
+	while ( ! hit && overlay_next_below( q, &q ) );
+
+	if ( ! hit )
+		hit = node_ref;
+	else if ( hit != node_ref )
+		overlay_track( hit, top );
+
+	config_refmap_put( &view->top, node_ref, hit );
+	return hit;
+}
+
+config_ref_t config_overlay_child( config_ref_t parent_ref, const char *name, size_t len )
+{
+	config_ref_t q, child;
+
+	if ( ! OVERLAY_ACTIVE() )
+		return config_index_lookup( config_dedup_redirect( parent_ref ), name, len );
+
+	q = overlay_start( parent_ref );
+	while ( 0 == (child = overlay_lookup( q, name, len )) && overlay_next_below( q, &q ) )
+		;
+	if ( child )
+		overlay_track( child, parent_ref );
+	return child;
+}
+
+config_ref_t config_overlay_own( config_ref_t node_ref )
+{
+	unsigned long parent;
+
+	if ( ! OVERLAY_ACTIVE() )
+		return node_ref;
+
+	node_ref = config_overlay_top( node_ref );
+	if ( 0 == node_ref )
+		return overlay_start( 0 );
+	if ( overlay_level( node_ref ) > 0 || ! config_refmap_get( &view->parent, node_ref, &parent ) )
+		return node_ref;
+
+	return config_overlay_own_child( config_overlay_own( (config_ref_t) parent ), node_ref );
+}
+
+config_ref_t config_overlay_own_child( config_ref_t parent_ref, config_ref_t child_ref )
+{
+	unsigned long	logical = 0;
+	const char		*name;
+	size_t			len;
+	config_ref_t	own;
+
+	if ( ! OVERLAY_ACTIVE() || ! overlay_name( child_ref, &name, &len ) )
+		return child_ref;
+
+	if ( 0 == (own = config_index_lookup( config_dedup_redirect( parent_ref ), name, len )) )
+	{
+		if ( 0 == (own = config_tree_add_child( parent_ref, name, len )) )
+			return 0;
+		config_overlay_changed();
+	}
+
+	/* same logical path as child_ref, so the same logical parent */
+	if ( own != child_ref && config_refmap_get( &view->parent, child_ref, &logical ) )
+		config_refmap_put( &view->parent, own, logical );
+	return own;
+}
+
+config_ref_t config_overlay_first_child( config_ref_t node_ref )
+{
+	config_ref_t	chain[ OVERLAY_CHAIN_MAX ];
+	unsigned int	n;
+
+	if ( ! OVERLAY_ACTIVE() )
+		return config_tree_first_child( node_ref );
+
+	node_ref = config_overlay_top( node_ref );
+	n = overlay_chain( node_ref, chain );
+	return overlay_scan( node_ref, chain, n, 0, config_tree_first_child( chain[0] ) );
+}
+
+config_ref_t config_overlay_next_sibling( config_ref_t node_ref )
+{
+	config_ref_t	chain[ OVERLAY_CHAIN_MAX ];
+	unsigned int	n, k;
+	unsigned long	parent;
+	const char		*name;
+	size_t			len;
+
+	if ( ! OVERLAY_ACTIVE() || ! config_refmap_get( &view->parent, node_ref, &parent ) || ! overlay_name( node_ref, &name, &len ) )
+		return config_tree_next_sibling( node_ref );
+
+	n = overlay_chain( (config_ref_t) parent, chain );
+	for ( k = 0; k < n; k++ )
+		if ( overlay_lookup( chain[k], name, len ) == node_ref )
+			return overlay_scan( (config_ref_t) parent, chain, n, k, config_tree_next_sibling( node_ref ) );
+
+	return config_tree_next_sibling( node_ref );
+}
+
+int config_overlay_active( void )
+{
+	return OVERLAY_ACTIVE();
+}
+
+void config_overlay_changed( void )
+{
+	unsigned int i;
+
+	/* a change made through one view can show through all of them */
+	for ( i = 0; i <= CONFIG_NAMESPACE_MAX; i++ )
+	{
+		config_refmap_free( &overlay_view_at( i )->below );
+		config_refmap_free( &overlay_view_at( i )->top );
+	}
+}
+
+void config_overlay_forget( config_ref_t root_ref )
+{
+	config_refmap_t	gone;
+	unsigned int	i;
+
+	config_overlay_changed();
+
+	memset( &gone, 0, sizeof(gone) );
+	for ( i = 0; i <= CONFIG_NAMESPACE_MAX; i++ )
+	{
+		if ( 0 == overlay_view_at( i )->parent.count )
+			continue;
+		if ( 0 == gone.count )
+			overlay_collect( root_ref, &gone );
+		overlay_untrack( overlay_view_at( i ), &gone );
+	}
+	config_refmap_free( &gone );
+}
+
+void config_overlay_deinit( void )
+{
+	unsigned int i;
+
+	config_overlay_changed();
+	for ( i = 0; i <= CONFIG_NAMESPACE_MAX; i++ )
+		config_refmap_free( &overlay_view_at( i )->parent );
+	memset( namespaces, 0, sizeof(namespaces) );
+	namespace_count = 0;
+	view = &overlay_shared;
+	memset( layers, 0, sizeof(layers) );
+	overlay_count = 0;
+	overlay_holder = 0;
+}
+
+config_result_t config_overlay_push_layer( const char *name, config_ref_t *layer_ref )
+{
+	size_t			len = strlen( name );
+	config_ref_t	root;
+
+	if ( 0 == len || len > CONFIG_OVERLAY_MAX_NAME )
+		return CONFIG_ERR_INVALID_REFERENCE;
+	if ( CONFIG_SUCCESS == config_overlay_find_layer( name, NULL ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+	if ( overlay_count == CONFIG_OVERLAY_MAX_LAYERS )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	if ( 0 == (root = overlay_new_root()) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	memcpy( layers[overlay_count].name, name, len + 1 );
+	layers[overlay_count].root = root;
+	overlay_count++;
+	config_overlay_changed();
+
+	if ( layer_ref )
+		*layer_ref = root;
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_overlay_find_layer( const char *name, config_ref_t *layer_ref )
+{
+	unsigned int i;
+
+	for ( i = 0; i < overlay_count; i++ )
+		if ( ! strcmp( layers[i].name, name ) )
+		{
+			if ( layer_ref )
+				*layer_ref = layers[i].root;
+			return CONFIG_SUCCESS;
+		}
+	return CONFIG_ERR_NOT_FOUND;
+}
+
+config_result_t config_overlay_drop_layer( const char *name )
+{
+	config_result_t	err;
+	unsigned int	i;
+
+	for ( i = 0; i < overlay_count; i++ )
+		if ( ! strcmp( layers[i].name, name ) )
+			break;
+	if ( i == overlay_count )
+		return CONFIG_ERR_NOT_FOUND;
+
+	err = overlay_delete( layers[i].root );
+	memmove( &layers[i], &layers[i + 1], (overlay_count - i - 1) * sizeof(layers[0]) );
+	overlay_count--;
+	config_overlay_changed();
+
+	if ( 0 == overlay_count )
+	{
+		/* with no layers left every shared reference resolves in the database alone */
+		config_refmap_free( &overlay_shared.parent );
+		overlay_release_holder();
+	}
+	return err;
+}
+
+unsigned int config_overlay_view( unsigned int ns )
+{
+	config_overlay_view_t *v = overlay_namespace( ns );
+
+	view = v ? v : &overlay_shared;
+	return v ? ns : 0;
+}
+
+config_result_t config_overlay_ns_create( unsigned int *ns )
+{
+	unsigned int i;
+
+	for ( i = 0; i < CONFIG_NAMESPACE_MAX; i++ )
+		if ( 0 == namespaces[i].root )
+			break;
+	if ( i == CONFIG_NAMESPACE_MAX )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	if ( 0 == (namespaces[i].root = overlay_new_root()) )
+		return CONFIG_ERR_NO_RESOURCES;
+	namespace_count++;
+
+	*ns = i + 1;
+	return CONFIG_SUCCESS;
+}
+
+config_ref_t config_overlay_ns_root( unsigned int ns )
+{
+	config_overlay_view_t *v = overlay_namespace( ns );
+
+	return v ? v->root : 0;
+}
+
+config_result_t config_overlay_ns_reset( unsigned int ns )
+{
+	config_overlay_view_t	*v = overlay_namespace( ns );
+	config_ref_t			root;
+
+	if ( NULL == v )
+		return CONFIG_ERR_INVALID_REFERENCE;
+	if ( 0 == (root = overlay_new_root()) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	/* readers still holding private references keep them until they are done */
+	overlay_delete( v->root );
+	v->root = root;
+	config_refmap_free( &v->parent );
+	config_overlay_changed();
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_overlay_ns_destroy( unsigned int ns )
+{
+	config_overlay_view_t *v = overlay_namespace( ns );
+
+	if ( NULL == v )
+		return CONFIG_ERR_INVALID_REFERENCE;
+	if ( view == v )
+		view = &overlay_shared;
+
+	overlay_delete( v->root );
+	config_refmap_free( &v->parent );
+	v->root = 0;
+	namespace_count--;
+	config_overlay_changed();
+	overlay_release_holder();
+	return CONFIG_SUCCESS;
+}
+
+int config_overlay_ns_private( config_ref_t node_ref )
+{
+	return view->root && node_ref && overlay_contains( view->root, node_ref );
+}
+
+int config_overlay_internal( config_ref_t node_ref )
+{
+	return overlay_holder && node_ref == overlay_holder;
+}
+
+int config_overlay_root( config_ref_t node_ref )
+{
+	unsigned int i;
+
+	if ( 0 == node_ref || 0 == overlay_holder )
+		return 0;
+	if ( node_ref == overlay_holder )
+		return 1;
+	for ( i = 0; i < overlay_count; i++ )
+		if ( layers[i].root == node_ref )
+			return 1;
+	for ( i = 0; i < CONFIG_NAMESPACE_MAX; i++ )
+		if ( namespaces[i].root == node_ref )
+			return 1;
+	return 0;
+}
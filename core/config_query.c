@@ -0,0 +1,274 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Wildcard queries.
+ *
+ * A pattern such as "memory.layout.*.size" is matched against the tree in a
+ * single depth-first pass.  Instead of backtracking, the pass carries the set
+ * of pattern positions that are live at each node (one bit per position), the
+ * way a regular expression is matched with an NFA: "*" advances over any one
+ * child, "**" may stay put for any number of levels or be skipped.  Every node
+ * is therefore visited at most once and reported at most once, and a subtree
+ * is left alone as soon as no position is live in it.  A run of plain names
+ * costs one index lookup per level rather than a scan of the children.
+ */
+
+/*
+ * Aggregates reduce one integer per child of a node (the child's own value or
+ * that of a key beneath it) as the children are enumerated, so nothing is
+ * copied out however many children there are.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+typedef struct {
+	const char					*comp[CONFIG_QUERY_MAX_DEPTH];
+	size_t						len[CONFIG_QUERY_MAX_DEPTH];
+	unsigned int				ncomp;
+	const config_query_pred_t	*pred;
+	config_query_result_t		*results;
+	unsigned int				max;
+	unsigned int				count;
+} config_query_t;
+
+#define QUERY_IS_STAR( q, s )		( 1 == (q)->len[s] && '*' == (q)->comp[s][0] )
+#define QUERY_IS_GLOBSTAR( q, s )	( 2 == (q)->len[s] && '*' == (q)->comp[s][0] && '*' == (q)->comp[s][1] )
+
+/* Add the positions reachable from live ones without consuming a level: a "**" may match nothing. */
+static unsigned int query_closure( const config_query_t *q, unsigned int live )
+{
+	unsigned int s;
+
+	for ( s = 0; s < q->ncomp; s++ )
+		if ( (live & (1u << s)) && QUERY_IS_GLOBSTAR( q, s ) )
+			live |= 1u << (s + 1);
+	return live;
+}
+
+/* The positions live at a child called name[0..len) of a node at which live were. */
+static unsigned int query_step( const config_query_t *q, unsigned int live, const char *name, size_t len )
+{
+	unsigned int s, next = 0;
+
+	for ( s = 0; s < q->ncomp; s++ )
+	{
+		if ( ! (live & (1u << s)) )
+			continue;
+		if ( QUERY_IS_GLOBSTAR( q, s ) )
+			next |= 1u << s;
+		else if ( QUERY_IS_STAR( q, s ) || (q->len[s] == len && ! memcmp( q->comp[s], name, len )) )
+			next |= 1u << (s + 1);
+	}
+	return query_closure( q, next );
+}
+
+static int query_test( const config_query_pred_t *pred, config_ref_t node_ref )
+{
+	config_ref_t	ref = node_ref;
+	int				val;
+
+	if ( NULL == pred || CONFIG_QUERY_ANY == pred->op )
+		return 1;
+	if ( NULL != pred->key && '\0' != pred->key[0]
+	  && CONFIG_SUCCESS != config_resolve( node_ref, pred->key, strlen(pred->key), CONFIG_RESOLVE_READ, &ref ) )
+		return 0;
+	if ( CONFIG_SUCCESS != config_value_int( ref, &val ) )
+		return 0;
+
+	switch ( pred->op )
+	{
+	case CONFIG_QUERY_EQ:	return val == pred->value;
+	case CONFIG_QUERY_NE:	return val != pred->value;
+	case CONFIG_QUERY_LT:	return val <  pred->value;
+	case CONFIG_QUERY_LE:	return val <= pred->value;
+	case CONFIG_QUERY_GT:	return val >  pred->value;
+	case CONFIG_QUERY_GE:	return val >= pred->value;
+	default:				return 0;
+	}
+}
+
+static void query_visit( config_query_t *q, config_ref_t node_ref, unsigned int live )
+{
+	unsigned int	inner = live & ((1u << q->ncomp) - 1);
+	config_ref_t	child;
+	const char		*name;
+
+	if ( (live & (1u << q->ncomp)) && query_test( q->pred, node_ref ) )
+	{
+		if ( q->count < q->max )
+		{
+			config_query_result_t *r = &q->results[q->count];
+
+			r->node_ref = node_ref;
+			r->has_value = ( CONFIG_SUCCESS == config_value_int( node_ref, &r->value ) );
+			if ( ! r->has_value )
+				r->value = 0;
+		}
+		q->count++;
+	}
+
+	if ( 0 == inner )
+		return;
+	/* matches below an alias are returned as references to its own nodes */
+	if ( q->max )
+		config_dedup_unalias( node_ref );
+
+	/* a single plain name: look the child up instead of scanning for it */
+	if ( 0 == (inner & (inner - 1)) )
+	{
+		unsigned int s = 0;
+
+		while ( ! (inner & (1u << s)) )
+			s++;
+		if ( ! QUERY_IS_STAR( q, s ) && ! QUERY_IS_GLOBSTAR( q, s ) )
+		{
+			if ( 0 != (child = config_overlay_child( node_ref, q->comp[s], q->len[s] )) )
+				query_visit( q, child, query_closure( q, 1u << (s + 1) ) );
+			return;
+		}
+	}
+
+	for ( child = config_overlay_first_child( node_ref ); child; child = config_overlay_next_sibling( child ) )
+	{
+		unsigned int next;
+
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			continue;
+		if ( 0 != (next = query_step( q, live, name, strlen(name) )) )
+			query_visit( q, child, next );
+	}
+}
+
+config_result_t config_query_run( config_ref_t base_ref, const char *pattern, const config_query_pred_t *pred,
+                                  config_query_result_t *results, unsigned int max, unsigned int *count )
+{
+	config_query_t	q;
+	const char		*p = pattern;
+
+	memset( &q, 0, sizeof(q) );
+	q.pred = pred;
+	q.results = results;
+	q.max = results ? max : 0;
+
+	/* an empty pattern matches base_ref itself */
+	while ( '\0' != *p )
+	{
+		const char *end = strchr( p, CONFIG_PATH_SEPARATOR );
+
+		if ( NULL == end )
+			end = p + strlen(p);
+		if ( end == p || q.ncomp == CONFIG_QUERY_MAX_DEPTH )
+			return CONFIG_ERR_INVALID_REFERENCE;
+
+		q.comp[q.ncomp] = p;
+		q.len[q.ncomp++] = end - p;
+		p = ('\0' != *end) ? end + 1 : end;
+		if ( p != end && '\0' == *p )
+			return CONFIG_ERR_INVALID_REFERENCE;
+	}
+
+	query_visit( &q, config_overlay_top( base_ref ), query_closure( &q, 1 ) );
+
+	*count = q.count;
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_aggregate_run( config_ref_t base_ref, const char *child_key, config_aggregate_op_t op, long long *result )
+{
+	config_ref_t	child, ref;
+	unsigned int	n = 0;
+	long long		acc = 0;
+	int				val;
+	size_t			key_len = child_key ? strlen(child_key) : 0;
+
+	if ( op < CONFIG_AGGREGATE_SUM || op > CONFIG_AGGREGATE_OR )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	for ( child = config_overlay_first_child( config_overlay_top( base_ref ) ); child; child = config_overlay_next_sibling( child ) )
+	{
+		ref = child;
+		if ( key_len && CONFIG_SUCCESS != config_resolve( child, child_key, key_len, CONFIG_RESOLVE_READ, &ref ) )
+			continue;
+		if ( CONFIG_SUCCESS != config_value_int( ref, &val ) )
+			continue;
+
+		switch ( op )
+		{
+		case CONFIG_AGGREGATE_SUM:		acc += val;								break;
+		case CONFIG_AGGREGATE_MIN:		if ( 0 == n || val < acc ) acc = val;	break;
+		case CONFIG_AGGREGATE_MAX:		if ( 0 == n || val > acc ) acc = val;	break;
+		case CONFIG_AGGREGATE_COUNT:	acc++;									break;
+		case CONFIG_AGGREGATE_OR:		acc |= (unsigned int) val;				break;
+		}
+		n++;
+	}
+
+	/* there is no minimum or maximum of nothing */
+	if ( 0 == n && (CONFIG_AGGREGATE_MIN == op || CONFIG_AGGREGATE_MAX == op) )
+		return CONFIG_ERR_NOT_FOUND;
+
+	*result = acc;
+	return CONFIG_SUCCESS;
+}
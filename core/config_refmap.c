@@ -0,0 +1,225 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Small open-addressed map from a config_ref_t (or any other 32-bit key) to
+ * an unsigned long.  Used by the core for its per-node side tables, which are
+ * sparse and far smaller than the name index.
+ */
+
+#include "platform_config_core_private.h"
+
+#define REFMAP_MIN_SIZE		16
+
+static unsigned int refmap_slot( const config_refmap_t *m, config_ref_t key )
+{
+	return (key * 0x9e3779b1u) & (m->size - 1);
+}
+
+static config_result_t refmap_resize( config_refmap_t *m, unsigned int size )
+{
+	config_refmap_t	old = *m;
+	unsigned int	i;
+
+	m->keys = CONFIG_ALLOC_LARGE( size * sizeof(*m->keys) );
+	m->vals = CONFIG_ALLOC_LARGE( size * sizeof(*m->vals) );
+	m->used = CONFIG_ALLOC_LARGE( size );
+	if ( NULL == m->keys || NULL == m->vals || NULL == m->used )
+	{
+		if ( m->keys ) CONFIG_FREE_LARGE( m->keys );
+		if ( m->vals ) CONFIG_FREE_LARGE( m->vals );
+		if ( m->used ) CONFIG_FREE_LARGE( m->used );
+		*m = old;
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	memset( m->used, 0, size );
+	m->size = size;
+	m->count = 0;
+
+	for ( i = 0; i < old.size; i++ )
+		if ( old.used[i] )
+			config_refmap_put( m, old.keys[i], old.vals[i] );
+
+	if ( old.size )
+	{
+		CONFIG_FREE_LARGE( old.keys );
+		CONFIG_FREE_LARGE( old.vals );
+		CONFIG_FREE_LARGE( old.used );
+	}
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_refmap_reserve( config_refmap_t *m, unsigned int n )
+{
+	unsigned int size = m->size ? m->size : REFMAP_MIN_SIZE;
+
+	while ( (m->count + n) * 2 > size )
+		size *= 2;
+	return ( size == m->size ) ? CONFIG_SUCCESS : refmap_resize( m, size );
+}
+
+config_result_t config_refmap_put( config_refmap_t *m, config_ref_t key, unsigned long val )
+{
+	unsigned int i;
+
+	/* an existing key is updated in place, which cannot fail or disturb an iteration */
+	for ( i = m->size ? refmap_slot( m, key ) : 0; m->size && m->used[i]; i = (i + 1) & (m->size - 1) )
+	{
+		if ( m->keys[i] == key )
+		{
+			m->vals[i] = val;
+			return CONFIG_SUCCESS;
+		}
+	}
+
+	/* keep the load factor at or below 1/2 */
+	if ( (m->count + 1) * 2 > m->size )
+	{
+		if ( CONFIG_SUCCESS != refmap_resize( m, m->size ? m->size * 2 : REFMAP_MIN_SIZE ) )
+			return CONFIG_ERR_NO_RESOURCES;
+		for ( i = refmap_slot( m, key ); m->used[i]; i = (i + 1) & (m->size - 1) )
+			;
+	}
+	m->used[i] = 1;
+	m->keys[i] = key;
+	m->vals[i] = val;
+	m->count++;
+	return CONFIG_SUCCESS;
+}
+
+int config_refmap_get( const config_refmap_t *m, config_ref_t key, unsigned long *val )
+{
+	unsigned int i;
+
+	if ( 0 == m->count )
+		return 0;
+
+	for ( i = refmap_slot( m, key ); m->used[i]; i = (i + 1) & (m->size - 1) )
+	{
+		if ( m->keys[i] == key )
+		{
+			if ( val )
+				*val = m->vals[i];
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int config_refmap_del( config_refmap_t *m, config_ref_t key )
+{
+	unsigned int i, j, home;
+
+	if ( 0 == m->count )
+		return 0;
+
+	for ( i = refmap_slot( m, key ); m->used[i]; i = (i + 1) & (m->size - 1) )
+		if ( m->keys[i] == key )
+			break;
+	if ( ! m->used[i] )
+		return 0;
+
+	/* backward-shift deletion keeps probe sequences intact without tombstones */
+	m->used[i] = 0;
+	m->count--;
+	for ( j = (i + 1) & (m->size - 1); m->used[j]; j = (j + 1) & (m->size - 1) )
+	{
+		home = refmap_slot( m, m->keys[j] );
+		if ( ((j - home) & (m->size - 1)) >= ((j - i) & (m->size - 1)) )
+		{
+			m->keys[i] = m->keys[j];
+			m->vals[i] = m->vals[j];
+			m->used[i] = 1;
+			m->used[j] = 0;
+			i = j;
+		}
+	}
+	return 1;
+}
+
+int config_refmap_next( const config_refmap_t *m, unsigned int *pos, config_ref_t *key, unsigned long *val )
+{
+	for ( ; *pos < m->size; (*pos)++ )
+	{
+		if ( m->used[*pos] )
+		{
+			*key = m->keys[*pos];
+			if ( val )
+				*val = m->vals[*pos];
+			(*pos)++;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void config_refmap_free( config_refmap_t *m )
+{
+	if ( m->size )
+	{
+		CONFIG_FREE_LARGE( m->keys );
+		CONFIG_FREE_LARGE( m->vals );
+		CONFIG_FREE_LARGE( m->used );
+	}
+	memset( m, 0, sizeof(*m) );
+}
@@ -0,0 +1,466 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Staged trees (blue/green reconfiguration) and subtree moves.
+ *
+ * config_stage_prepare() hands out the root of a new, empty private tree
+ * under a hidden holder node, which callers fill with the ordinary load and
+ * set calls while everybody else keeps reading the live tree.
+ * config_stage_publish() then makes it the content of a live node in one
+ * step under the core lock: the node's current children are retired
+ * (config_epoch.c), so they vanish from every lookup at once but stay valid
+ * for readers still holding them, and the node is left "forwarding" to the
+ * staged root.  Lookups, enumeration and writes through a forwarding node
+ * act on the children of the staged root instead of its own, the same way
+ * they follow a deduplicated alias, so nothing is copied.  Publishing to the
+ * same node again retires the previously published tree as a whole and just
+ * moves the forward.
+ *
+ * htuple cannot relink nodes, and config_node_move() is built the same way:
+ * a node with the new name is created under the new parent and forwarded to
+ * the moved node, which stays where htuple has it but is hidden there (its
+ * index edge is dropped and enumeration skips it).  Hidden content still
+ * lives below its old parent, so before anything could delete it or write
+ * over its name there (removing an ancestor, a write or a load reusing the
+ * name) it is copied under the holder and the forward repointed; only then
+ * is the original retired.  That copy is the one O(subtree) step, and it is
+ * only paid when the old place is reused.
+ *
+ * The node forwarding keeps its own name, value and (retired) htuple
+ * children; only what is reached through it changes.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+/* Name of the hidden child of the root node holding one node per staged tree */
+#define STAGE_HOLDER_NAME		"__platform_config_staging"
+
+/* Ancestors climbed through the index before falling back to a search */
+#define STAGE_MAX_CLIMB			64
+
+static config_ref_t		stage_holder;
+static unsigned int		stage_seq;
+static config_refmap_t	stage_pending;		/* prepared, unpublished root -> 1 */
+static config_refmap_t	stage_forward;		/* forwarding node -> content */
+static config_refmap_t	stage_base;			/* content -> node forwarding to it */
+static config_refmap_t	stage_moved;		/* moved content, hidden below it -> old parent */
+
+/* "stage<seq>" into buf; returns its length. */
+static size_t stage_node_name( char *buf, unsigned int seq )
+{
+	char	digits[12];
+	size_t	n = 0, len = 5;
+
+	memcpy( buf, "stage", 5 );
+	do
+		digits[n++] = '0' + seq % 10;
+	while ( (seq /= 10) != 0 );
+	while ( n )
+		buf[len++] = digits[--n];
+	buf[len] = '\0';
+	return len;
+}
+
+/* Non-zero if ref is node_ref or lies beneath it in htuple. */
+static int stage_contains( config_ref_t node_ref, config_ref_t ref )
+{
+	config_ref_t child;
+
+	if ( node_ref == ref )
+		return 1;
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		if ( stage_contains( child, ref ) )
+			return 1;
+	return 0;
+}
+
+/* Non-zero if ref is node_ref or can be reached from it, following forwards. */
+static int stage_reaches( config_ref_t node_ref, config_ref_t ref )
+{
+	config_ref_t child;
+
+	if ( node_ref == ref || config_stage_forward( node_ref ) == ref )
+		return 1;
+	for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+		if ( stage_reaches( child, ref ) )
+			return 1;
+	return 0;
+}
+
+/* Non-zero if node_ref is ancestor_ref or lies beneath it as the tree presents it. */
+static int stage_within( config_ref_t ancestor_ref, config_ref_t node_ref )
+{
+	config_ref_t	parent;
+	unsigned long	base;
+	unsigned int	depth;
+
+	/* the index knows the parent of every edge looked up so far; shared subtrees have several */
+	for ( depth = 0; depth < STAGE_MAX_CLIMB && ! config_dedup_active(); depth++ )
+	{
+		if ( node_ref == ancestor_ref )
+			return 1;
+		if ( ROOT_NODE == node_ref )
+			return 0;
+		if ( config_refmap_get( &stage_base, node_ref, &base ) )
+			node_ref = (config_ref_t) base;
+		else if ( config_index_parent( node_ref, &parent ) )
+			node_ref = parent;
+		else
+			break;
+	}
+	/* stuck on an edge nobody looked up: search down instead */
+	return stage_reaches( ancestor_ref, node_ref );
+}
+
+/* Stop node_ref forwarding; returns what it forwarded to. */
+static config_ref_t stage_detach( config_ref_t node_ref )
+{
+	unsigned long content = 0;
+
+	if ( config_refmap_get( &stage_forward, node_ref, &content ) )
+	{
+		config_refmap_del( &stage_forward, node_ref );
+		config_refmap_del( &stage_base, (config_ref_t) content );
+		config_refmap_del( &stage_moved, (config_ref_t) content );
+	}
+	return (config_ref_t) content;
+}
+
+static config_result_t stage_link( config_ref_t node_ref, config_ref_t content_ref )
+{
+	if ( CONFIG_SUCCESS != config_refmap_put( &stage_forward, node_ref, content_ref ) )
+		return CONFIG_ERR_NO_RESOURCES;
+	if ( CONFIG_SUCCESS != config_refmap_put( &stage_base, content_ref, node_ref ) )
+	{
+		config_refmap_del( &stage_forward, node_ref );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	return CONFIG_SUCCESS;
+}
+
+/* Copy moved content out from below its old parent and forward base_ref to the copy. */
+static void stage_rescue( config_ref_t content_ref, config_ref_t base_ref )
+{
+	config_ref_t copy;
+
+	stage_detach( base_ref );
+	if ( CONFIG_SUCCESS != config_stage_new( &copy ) )
+		return;
+	config_refmap_del( &stage_pending, copy );
+	config_tree_copy( copy, content_ref );
+	if ( CONFIG_SUCCESS != stage_link( base_ref, copy ) )
+		config_epoch_retire( copy );
+}
+
+/* root_ref is going: node_ref, below it, takes what it forwards to along, and moved content below it moves out. */
+static void stage_forget_node( config_ref_t root_ref, config_ref_t node_ref )
+{
+	config_ref_t	child;
+	unsigned long	ref;
+
+	if ( config_refmap_get( &stage_forward, node_ref, &ref ) )
+	{
+		stage_detach( node_ref );
+		/* content below root_ref goes anyway */
+		if ( ! stage_contains( root_ref, (config_ref_t) ref ) )
+			config_epoch_retire( (config_ref_t) ref );
+	}
+	if ( config_refmap_get( &stage_base, node_ref, &ref ) )
+	{
+		if ( stage_contains( root_ref, (config_ref_t) ref ) )
+			stage_detach( (config_ref_t) ref );
+		else
+			stage_rescue( node_ref, (config_ref_t) ref );
+	}
+
+	for ( child = htuple_first_child( node_ref ); child; child = htuple_next_sibling( child ) )
+		stage_forget_node( root_ref, child );
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_stage_new( config_ref_t *stage_ref )
+{
+	char			node_name[24];
+	config_ref_t	root;
+
+	if ( 0 == stage_holder
+	  && 0 == (stage_holder = config_tree_add_child( ROOT_NODE, STAGE_HOLDER_NAME, sizeof(STAGE_HOLDER_NAME) - 1 )) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	if ( 0 == (root = config_tree_add_child( stage_holder, node_name, stage_node_name( node_name, stage_seq++ ) )) )
+		return CONFIG_ERR_NO_RESOURCES;
+	if ( CONFIG_SUCCESS != config_refmap_put( &stage_pending, root, 1 ) )
+	{
+		config_epoch_retire( root );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+
+	*stage_ref = root;
+	return CONFIG_SUCCESS;
+}
+
+int config_stage_prepared( config_ref_t stage_ref )
+{
+	return config_refmap_get( &stage_pending, stage_ref, NULL );
+}
+
+int config_stage_valid( config_ref_t node_ref, config_ref_t stage_ref )
+{
+	return config_stage_prepared( stage_ref ) && ! stage_contains( stage_ref, node_ref )
+	    && ! config_stage_hidden( node_ref ) && ! config_overlay_internal( node_ref );
+}
+
+config_result_t config_stage_swap( config_ref_t node_ref, config_ref_t stage_ref )
+{
+	config_ref_t	child, next, old;
+
+	if ( ! config_stage_valid( node_ref, stage_ref ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	old = stage_detach( node_ref );
+	if ( CONFIG_SUCCESS != stage_link( node_ref, stage_ref ) )
+	{
+		if ( old )
+			stage_link( node_ref, old );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	config_refmap_del( &stage_pending, stage_ref );
+
+	/* from here on lookups through node_ref only see the staged tree */
+	if ( old )
+		config_epoch_retire( old );
+	else
+	{
+		for ( child = htuple_first_child( node_ref ); child; child = next )
+		{
+			next = htuple_next_sibling( child );
+			if ( ! config_epoch_retired( child ) && ! config_stage_hidden( child ) && ! config_overlay_internal( child ) )
+				config_epoch_retire( child );
+		}
+	}
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_stage_check_move( config_ref_t src_ref, config_ref_t parent_ref, const char *name, size_t len )
+{
+	if ( ROOT_NODE == src_ref || ! config_json_name_ok( name, len )
+	  || config_epoch_retired( src_ref ) || config_stage_hidden( src_ref ) || config_overlay_internal( src_ref )
+	  || config_stage_prepared( src_ref ) || config_stage_hidden( parent_ref ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	/* not into itself */
+	if ( stage_within( config_stage_forward( src_ref ), parent_ref ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	/* the new name must be free; a hidden or retired node holding it is moved out of the way */
+	if ( 0 != config_index_lookup( parent_ref, name, len ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+	return config_epoch_claim( parent_ref, name, len );
+}
+
+config_result_t config_stage_move( config_ref_t src_ref, config_ref_t parent_ref, const char *name, size_t len, config_ref_t *dst_ref )
+{
+	config_ref_t	dst, old_parent, content = config_stage_forward( src_ref );
+	const char		*str;
+	int				val;
+
+	/* the moved node's own value goes with its name */
+	if ( CONFIG_SUCCESS == htuple_node_int_value( src_ref, &val ) )
+		htuple_set_int_value( parent_ref, name, len, val );
+	else if ( CONFIG_SUCCESS == htuple_node_str_value( src_ref, &str )
+	       && CONFIG_SUCCESS == htuple_set_str_value( parent_ref, name, len, str, strlen(str) )
+	       && CONFIG_SUCCESS != config_array_mark( parent_ref, name, len, config_array_is( src_ref ) ) )
+		return CONFIG_ERR_NO_RESOURCES;
+	if ( 0 == (dst = config_tree_add_child( parent_ref, name, len )) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	if ( content != src_ref )
+	{
+		/* src_ref was itself forwarding: hand its content on and drop the empty node */
+		stage_detach( src_ref );
+		if ( CONFIG_SUCCESS != stage_link( dst, content ) )
+		{
+			stage_link( src_ref, content );
+			config_epoch_retire( dst );
+			return CONFIG_ERR_NO_RESOURCES;
+		}
+		config_epoch_retire( src_ref );
+	}
+	else
+	{
+		/* the old parent is only known if the edge was ever looked up */
+		if ( ! config_index_parent( content, &old_parent ) )
+			old_parent = 0;
+		if ( CONFIG_SUCCESS != stage_link( dst, content )
+		  || CONFIG_SUCCESS != config_refmap_put( &stage_moved, content, old_parent ) )
+		{
+			stage_detach( dst );
+			config_epoch_retire( dst );
+			return CONFIG_ERR_NO_RESOURCES;
+		}
+		config_index_unlink( content );
+	}
+
+	/* index the new edge now, so that climbing from below it does not have to search */
+	config_index_lookup( parent_ref, name, len );
+	*dst_ref = dst;
+	return CONFIG_SUCCESS;
+}
+
+config_ref_t config_stage_forward( config_ref_t node_ref )
+{
+	unsigned long target;
+
+	if ( stage_forward.count && config_refmap_get( &stage_forward, node_ref, &target ) )
+		return (config_ref_t) target;
+	return node_ref;
+}
+
+config_ref_t config_stage_base( config_ref_t node_ref )
+{
+	unsigned long base;
+
+	if ( stage_base.count && config_refmap_get( &stage_base, node_ref, &base ) )
+		return (config_ref_t) base;
+	return 0;
+}
+
+int config_stage_internal( config_ref_t node_ref )
+{
+	return stage_holder && node_ref == stage_holder;
+}
+
+int config_stage_hiding( void )
+{
+	return 0 != stage_moved.count;
+}
+
+int config_stage_hidden( config_ref_t node_ref )
+{
+	return config_stage_internal( node_ref ) || (stage_moved.count && config_refmap_get( &stage_moved, node_ref, NULL ));
+}
+
+config_result_t config_stage_evict( config_ref_t node_ref )
+{
+	unsigned long base;
+
+	if ( ! config_refmap_get( &stage_moved, node_ref, NULL ) )
+		return CONFIG_SUCCESS;
+
+	if ( config_refmap_get( &stage_base, node_ref, &base ) )
+		stage_rescue( node_ref, (config_ref_t) base );
+	else
+		config_refmap_del( &stage_moved, node_ref );
+	return config_epoch_retire( node_ref );
+}
+
+void config_stage_discard( config_ref_t stage_ref )
+{
+	/* nobody can hold references into it, so it goes at once */
+	config_cache_forget( stage_ref );
+	config_array_deleted( stage_ref );
+	htuple_delete_private_tree( stage_ref );
+}
+
+void config_stage_forget( config_ref_t root_ref )
+{
+	unsigned long ref;
+
+	if ( ROOT_NODE == root_ref || (stage_holder && root_ref == stage_holder) )
+	{
+		/* every staged tree goes with the holder */
+		config_refmap_free( &stage_pending );
+		config_refmap_free( &stage_forward );
+		config_refmap_free( &stage_base );
+		config_refmap_free( &stage_moved );
+		stage_holder = 0;
+		return;
+	}
+
+	/* a staged tree discarded before it was published */
+	config_refmap_del( &stage_pending, root_ref );
+	if ( 0 == stage_forward.count )
+		return;
+
+	/* content removed through a reference to it: whatever forwarded to it is left empty */
+	if ( config_refmap_get( &stage_base, root_ref, &ref ) )
+		stage_detach( (config_ref_t) ref );
+
+	stage_forget_node( root_ref, root_ref );
+}
+
+void config_stage_deinit( void )
+{
+	/* htuple_deinitialize() takes the staged trees with everything else */
+	config_refmap_free( &stage_pending );
+	config_refmap_free( &stage_forward );
+	config_refmap_free( &stage_base );
+	config_refmap_free( &stage_moved );
+	stage_holder = 0;
+	stage_seq = 0;
+}
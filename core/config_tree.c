@@ -0,0 +1,187 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Tree helpers shared by the core features.  These walk the database the way
+ * the public API presents it (following deduplicated subtrees to their
+ * canonical copy) rather than the raw htuple layout.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+config_ref_t config_tree_first_child( config_ref_t node_ref )
+{
+	config_ref_t child = htuple_first_child( config_dedup_redirect( node_ref ) );
+
+	/* removed subtrees linger until their readers are gone; staged and moved trees are shown where they are forwarded to */
+	while ( child && (config_epoch_retired( child ) || config_stage_hidden( child )) )
+		child = htuple_next_sibling( child );
+	return child;
+}
+
+config_ref_t config_tree_next_sibling( config_ref_t node_ref )
+{
+	config_ref_t sibling = htuple_next_sibling( node_ref );
+
+	while ( sibling && (config_epoch_retired( sibling ) || config_stage_hidden( sibling )) )
+		sibling = htuple_next_sibling( sibling );
+	return sibling;
+}
+
+config_ref_t config_tree_add_child( config_ref_t parent_ref, const char *name, size_t len )
+{
+	char			text[ CONFIG_TREE_MAX_NAME + 8 ];
+	config_ref_t	child;
+
+	if ( CONFIG_SUCCESS != config_epoch_claim( parent_ref, name, len ) )
+		return 0;
+	if ( 0 != (child = htuple_find_child( parent_ref, name, len )) )
+		return child;
+
+	if ( len > CONFIG_TREE_MAX_NAME )
+		return 0;
+
+	/* htuple has no "create empty node" call; an empty block does the job */
+	memcpy( text, name, len );
+	memcpy( text + len, " { }", 5 );
+	if ( CONFIG_SUCCESS != htuple_parse_config_string( parent_ref, text, len + 4 ) )
+		return 0;
+
+	return htuple_find_child( parent_ref, name, len );
+}
+
+unsigned int config_tree_count( config_ref_t node_ref )
+{
+	unsigned int	count = 0;
+	config_ref_t	child;
+
+	for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+		count += 1 + config_tree_count( child );
+
+	return count;
+}
+
+unsigned int config_tree_copy( config_ref_t dst_ref, config_ref_t src_ref )
+{
+	unsigned int	copied = 0;
+	config_ref_t	child, copy;
+
+	for ( child = config_tree_first_child( src_ref ); child; child = config_tree_next_sibling( child ) )
+	{
+		const char	*name, *str;
+		int			ival;
+		size_t		len;
+
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			continue;
+		len = strlen( name );
+
+		if ( CONFIG_SUCCESS == htuple_node_int_value( child, &ival ) )
+			htuple_set_int_value( dst_ref, name, len, ival );
+		else if ( CONFIG_SUCCESS == htuple_node_str_value( child, &str )
+		       && CONFIG_SUCCESS == htuple_set_str_value( dst_ref, name, len, str, strlen( str ) ) )
+			config_array_mark( dst_ref, name, len, config_array_is( child ) );
+
+		if ( 0 == (copy = config_tree_add_child( dst_ref, name, len )) )
+			continue;
+
+		copied += 1 + config_tree_copy( copy, child );
+	}
+	return copied;
+}
+
+config_result_t config_tree_merge( config_ref_t dst_ref, config_ref_t src_ref )
+{
+	config_result_t	err = CONFIG_SUCCESS;
+	config_ref_t	child, node;
+
+	for ( child = htuple_first_child( src_ref ); child && CONFIG_SUCCESS == err; child = htuple_next_sibling( child ) )
+	{
+		const char	*name, *str;
+		int			ival;
+		size_t		len;
+
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		len = strlen( name );
+
+		/* the value must not land on a removed or moved-away node still holding the name */
+		if ( CONFIG_SUCCESS != (err = config_epoch_claim( dst_ref, name, len )) )
+			break;
+		/* the value written is an array exactly when the loaded one is */
+		if ( CONFIG_SUCCESS == htuple_node_int_value( child, &ival )
+		  && CONFIG_SUCCESS == (err = htuple_set_int_value( dst_ref, name, len, ival )) )
+			err = config_array_mark( dst_ref, name, len, 0 );
+		else if ( CONFIG_SUCCESS == err && CONFIG_SUCCESS == htuple_node_str_value( child, &str )
+		       && CONFIG_SUCCESS == (err = htuple_set_str_value( dst_ref, name, len, str, strlen( str ) )) )
+			err = config_array_mark( dst_ref, name, len, config_array_is( child ) );
+		if ( CONFIG_SUCCESS != err )
+			break;
+
+		if ( 0 == (node = config_tree_add_child( dst_ref, name, len )) )
+			return CONFIG_ERR_NO_RESOURCES;
+		err = config_tree_merge( node, child );
+	}
+	return err;
+}
@@ -0,0 +1,218 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Dual-representation scalar values.
+ *
+ * htuple types a value once, at parse time, as an integer or a string.
+ * Scripts often write numbers as strings ("0x80000000"), and readers ask for
+ * an int node as a string, so the typed getters convert across.  Each
+ * conversion is done once per node and kept until the node's value changes
+ * or the node is removed, the same way decoded arrays are kept.
+ */
+
+#include "platform_config_core_private.h"
+#include "htuple.h"
+
+/* A node's value is either an int or a string, so only one field is ever used. */
+typedef struct {
+	int		num;			/* a numeric string's value */
+	char	text[12];		/* an int's decimal form */
+} config_value_t;
+
+/* node reference -> config_value_t *, or 0 for a string that is not a number */
+static config_refmap_t value_cache;
+
+static void value_free( config_ref_t node_ref )
+{
+	unsigned long value;
+
+	if ( config_refmap_get( &value_cache, node_ref, &value ) )
+	{
+		config_refmap_del( &value_cache, node_ref );
+		CONFIG_FREE( (config_value_t *) value );
+	}
+}
+
+/* Cache a new conversion for node_ref; NULL if there is no memory for it. */
+static config_value_t *value_new( config_ref_t node_ref )
+{
+	config_value_t *value = CONFIG_ALLOC( sizeof(*value) );
+
+	if ( value && CONFIG_SUCCESS != config_refmap_put( &value_cache, node_ref, (unsigned long) value ) )
+	{
+		CONFIG_FREE( value );
+		value = NULL;
+	}
+	return value;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_value_int( config_ref_t node_ref, int *val )
+{
+	config_value_t	*value;
+	unsigned long	cached;
+	const char		*str;
+	config_result_t	err;
+	int				num;
+
+	if ( CONFIG_SUCCESS == (err = htuple_node_int_value( node_ref, val )) )
+		return err;
+
+	if ( value_cache.count && config_refmap_get( &value_cache, node_ref, &cached ) )
+	{
+		if ( 0 == cached )
+			return err;
+		*val = ((config_value_t *) cached)->num;
+		return CONFIG_SUCCESS;
+	}
+
+	if ( CONFIG_SUCCESS != htuple_node_str_value( node_ref, &str ) )
+		return err;
+
+	if ( ! config_array_parse_int( str, strlen(str), &num ) )
+	{
+		/* remember that it is not a number either */
+		config_refmap_put( &value_cache, node_ref, 0 );
+		return err;
+	}
+
+	if ( NULL != (value = value_new( node_ref )) )
+		value->num = num;
+	*val = num;
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_value_str( config_ref_t node_ref, const char **str )
+{
+	config_value_t	*value;
+	unsigned long	cached;
+	config_result_t	err;
+	unsigned int	v;
+	char			digits[12];
+	size_t			n = 0, len = 0;
+	int				num;
+
+	/* an array is stored as a string but is not one */
+	if ( config_array_is( node_ref ) )
+		return CONFIG_ERR_NOT_FOUND;
+	if ( CONFIG_SUCCESS == (err = htuple_node_str_value( node_ref, str )) )
+		return err;
+
+	/* only int nodes are cached here, so the entry holds their text */
+	if ( value_cache.count && config_refmap_get( &value_cache, node_ref, &cached ) )
+	{
+		*str = ((config_value_t *) cached)->text;
+		return CONFIG_SUCCESS;
+	}
+
+	if ( CONFIG_SUCCESS != htuple_node_int_value( node_ref, &num ) )
+		return err;
+	if ( NULL == (value = value_new( node_ref )) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	v = (num < 0) ? 0U - (unsigned int) num : (unsigned int) num;
+	do
+		digits[n++] = '0' + v % 10;
+	while ( (v /= 10) != 0 );
+	if ( num < 0 )
+		value->text[len++] = '-';
+	while ( n )
+		value->text[len++] = digits[--n];
+	value->text[len] = '\0';
+
+	*str = value->text;
+	return CONFIG_SUCCESS;
+}
+
+void config_value_invalidate( config_ref_t node_ref )
+{
+	if ( value_cache.count )
+		value_free( node_ref );
+}
+
+void config_value_forget( config_ref_t root_ref )
+{
+	config_ref_t child;
+
+	if ( 0 == value_cache.count )
+		return;
+
+	value_free( root_ref );
+	for ( child = htuple_first_child( root_ref ); child; child = htuple_next_sibling( child ) )
+		config_value_forget( child );
+}
+
+void config_value_flush( void )
+{
+	unsigned int	pos = 0;
+	config_ref_t	node_ref;
+	unsigned long	value;
+
+	while ( config_refmap_next( &value_cache, &pos, &node_ref, &value ) )
+		CONFIG_FREE( (config_value_t *) value );
+	config_refmap_free( &value_cache );
+}
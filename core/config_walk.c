@@ -0,0 +1,482 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Parallel subtree traversal (userspace build only).
+ *
+ * The subtree is first flattened, under the core lock, into an array of node
+ * references in pre-order.  Any contiguous range of that array is a unit of
+ * work, so tasks are plain [start, end) ranges: a worker that takes a range
+ * larger than WALK_GRAIN keeps halving it, pushing the upper halves onto the
+ * bottom of its own deque, and visits what is left.  Idle workers steal from
+ * the top of other workers' deques, which is where the largest ranges sit.
+ *
+ * Visitors run without the core lock and may call the public API.  When the
+ * caller asks for output, each range visited gets its own buffer and the
+ * buffers are concatenated by start index afterwards, so the output is in
+ * pre-order whatever the thread count or scheduling.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include "platform_config_core_private.h"
+
+#define WALK_GRAIN			64		/* nodes a worker visits without splitting further */
+#define WALK_DEQUE_SIZE		64		/* ranges halve on every push, so a deque never holds more than log2(n) */
+#define WALK_MAX_THREADS	64
+
+typedef struct {
+	unsigned int	start;
+	unsigned int	end;
+} walk_task_t;
+
+typedef struct {
+	pthread_mutex_t	lock;
+	walk_task_t		tasks[WALK_DEQUE_SIZE];
+	unsigned int	top;			/* thieves take from here */
+	unsigned int	bottom;			/* the owner pushes and pops here */
+} walk_deque_t;
+
+struct config_walk_buf {
+	unsigned int	start;			/* first node of the range that produced it */
+	char			*data;
+	size_t			len;
+	size_t			cap;
+	int				failed;
+};
+
+typedef struct {
+	config_ref_t			*refs;
+	unsigned int			*depths;
+	unsigned int			count;
+	unsigned int			cap;
+
+	config_walk_visitor_t	visitor;
+	void					*ctx;
+	int						ordered;
+
+	walk_deque_t			deques[WALK_MAX_THREADS];
+	unsigned int			nthreads;
+
+	pthread_mutex_t			lock;			/* remaining, failed, pieces */
+	unsigned int			remaining;
+	config_result_t			failed;			/* first error */
+	config_walk_buf_t		*pieces;
+	unsigned int			npieces;
+	unsigned int			pieces_cap;
+} walk_t;
+
+typedef struct {
+	walk_t			*walk;
+	unsigned int	self;
+} walk_worker_t;
+
+/* Append node_ref (at depth) to the pre-order array. */
+static int walk_add( walk_t *w, config_ref_t node_ref, unsigned int depth )
+{
+	if ( w->count == w->cap )
+	{
+		unsigned int	cap = w->cap ? w->cap * 2 : 256;
+		config_ref_t	*refs = realloc( w->refs, cap * sizeof(*refs) );
+		unsigned int	*depths;
+
+		if ( NULL == refs )
+			return 0;
+		w->refs = refs;
+		if ( NULL == (depths = realloc( w->depths, cap * sizeof(*depths) )) )
+			return 0;
+		w->depths = depths;
+		w->cap = cap;
+	}
+	w->refs[w->count] = node_ref;
+	w->depths[w->count++] = depth;
+	return 1;
+}
+
+/* Flatten the subtree in pre-order, iteratively so that deep trees cannot exhaust the stack. */
+static int walk_flatten( walk_t *w, config_ref_t base_ref )
+{
+	unsigned int	*parent_of = NULL;	/* parent_of[k]: index of the parent of node k */
+	unsigned int	i = 0, parent, depth;
+	config_ref_t	next;
+
+	if ( ! walk_add( w, config_overlay_top( base_ref ), 0 ) || NULL == (parent_of = malloc( w->cap * sizeof(*parent_of) )) )
+		return 0;
+	parent_of[0] = 0;
+
+	for ( ;; )
+	{
+		/* visitors get references they may write through */
+		config_dedup_unalias( w->refs[i] );
+		if ( 0 != (next = config_overlay_first_child( w->refs[i] )) )
+		{
+			parent = i;
+			depth = w->depths[i] + 1;
+		}
+		else
+		{
+			/* climb until a node has a next sibling; the base's siblings are not ours */
+			while ( i != 0 && 0 == (next = config_overlay_next_sibling( w->refs[i] )) )
+				i = parent_of[i];
+			if ( 0 == i )
+				break;
+			parent = parent_of[i];
+			depth = w->depths[i];
+		}
+
+		if ( w->count == w->cap )
+		{
+			unsigned int *grown;
+
+			if ( ! walk_add( w, next, depth ) || NULL == (grown = realloc( parent_of, w->cap * sizeof(*parent_of) )) )
+			{
+				free( parent_of );
+				return 0;
+			}
+			parent_of = grown;
+		}
+		else
+			walk_add( w, next, depth );
+
+		i = w->count - 1;
+		parent_of[i] = parent;
+	}
+
+	free( parent_of );
+	return 1;
+}
+
+static void walk_push( walk_deque_t *d, walk_task_t t )
+{
+	pthread_mutex_lock( &d->lock );
+	d->tasks[d->bottom++ % WALK_DEQUE_SIZE] = t;
+	pthread_mutex_unlock( &d->lock );
+}
+
+static int walk_pop( walk_deque_t *d, walk_task_t *t )
+{
+	int found = 0;
+
+	pthread_mutex_lock( &d->lock );
+	if ( d->bottom != d->top )
+	{
+		*t = d->tasks[--d->bottom % WALK_DEQUE_SIZE];
+		found = 1;
+	}
+	pthread_mutex_unlock( &d->lock );
+	return found;
+}
+
+static int walk_steal( walk_deque_t *d, walk_task_t *t )
+{
+	int found = 0;
+
+	pthread_mutex_lock( &d->lock );
+	if ( d->bottom != d->top )
+	{
+		*t = d->tasks[d->top++ % WALK_DEQUE_SIZE];
+		found = 1;
+	}
+	pthread_mutex_unlock( &d->lock );
+	return found;
+}
+
+/* Visit t, which no longer needs splitting, and account for it. */
+static void walk_run( walk_t *w, walk_task_t t )
+{
+	config_walk_buf_t	buf;
+	config_walk_buf_t	*out = w->ordered ? &buf : NULL;
+	unsigned int		i;
+	config_result_t		failed;
+
+	memset( &buf, 0, sizeof(buf) );
+	buf.start = t.start;
+
+	pthread_mutex_lock( &w->lock );
+	failed = w->failed;
+	pthread_mutex_unlock( &w->lock );
+
+	for ( i = t.start; i < t.end && CONFIG_SUCCESS == failed; i++ )
+	{
+		failed = w->visitor( w->refs[i], w->depths[i], out, w->ctx );
+		if ( CONFIG_SUCCESS == failed && buf.failed )
+			failed = CONFIG_ERR_NO_RESOURCES;
+	}
+
+	pthread_mutex_lock( &w->lock );
+	w->remaining -= t.end - t.start;
+	if ( CONFIG_SUCCESS != failed )
+	{
+		if ( CONFIG_SUCCESS == w->failed )
+			w->failed = failed;
+	}
+	else if ( w->ordered && buf.len )
+	{
+		if ( w->npieces == w->pieces_cap )
+		{
+			unsigned int		cap = w->pieces_cap ? w->pieces_cap * 2 : 16;
+			config_walk_buf_t	*pieces = realloc( w->pieces, cap * sizeof(*pieces) );
+
+			if ( NULL == pieces )
+				w->failed = CONFIG_ERR_NO_RESOURCES;
+			else
+			{
+				w->pieces = pieces;
+				w->pieces_cap = cap;
+			}
+		}
+		if ( CONFIG_SUCCESS == w->failed )
+		{
+			w->pieces[w->npieces++] = buf;
+			buf.data = NULL;
+		}
+	}
+	pthread_mutex_unlock( &w->lock );
+
+	free( buf.data );
+}
+
+static void *walk_worker( void *arg )
+{
+	walk_worker_t	*me = arg;
+	walk_t			*w = me->walk;
+	walk_task_t		t;
+	unsigned int	k;
+	int				done;
+
+	for ( ;; )
+	{
+		int found = walk_pop( &w->deques[me->self], &t );
+
+		for ( k = 1; ! found && k < w->nthreads; k++ )
+			found = walk_steal( &w->deques[(me->self + k) % w->nthreads], &t );
+
+		if ( ! found )
+		{
+			pthread_mutex_lock( &w->lock );
+			done = ( 0 == w->remaining );
+			pthread_mutex_unlock( &w->lock );
+			if ( done )
+				break;
+			sched_yield();
+			continue;
+		}
+
+		while ( t.end - t.start > WALK_GRAIN )
+		{
+			walk_task_t upper;
+
+			upper.start = t.start + (t.end - t.start) / 2;
+			upper.end = t.end;
+			walk_push( &w->deques[me->self], upper );
+			t.end = upper.start;
+		}
+		walk_run( w, t );
+	}
+	return NULL;
+}
+
+static int walk_piece_cmp( const void *a, const void *b )
+{
+	const config_walk_buf_t *pa = a, *pb = b;
+
+	return (pa->start > pb->start) - (pa->start < pb->start);
+}
+
+/* Concatenate the pieces in pre-order. */
+static config_result_t walk_merge( walk_t *w, char **output, size_t *output_len )
+{
+	size_t			len = 0;
+	unsigned int	i;
+	char			*p;
+
+	qsort( w->pieces, w->npieces, sizeof(*w->pieces), walk_piece_cmp );
+	for ( i = 0; i < w->npieces; i++ )
+		len += w->pieces[i].len;
+
+	if ( NULL == (p = malloc( len + 1 )) )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	*output = p;
+	*output_len = len;
+	for ( i = 0; i < w->npieces; i++ )
+	{
+		memcpy( p, w->pieces[i].data, w->pieces[i].len );
+		p += w->pieces[i].len;
+	}
+	*p = '\0';
+	return CONFIG_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CORE PRIVATE INTERFACE */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_walk_flatten( config_ref_t base_ref, config_ref_t **refs, unsigned int **depths, unsigned int *count )
+{
+	walk_t w;
+
+	memset( &w, 0, sizeof(w) );
+	if ( ! walk_flatten( &w, base_ref ) )
+	{
+		free( w.refs );
+		free( w.depths );
+		return CONFIG_ERR_NO_RESOURCES;
+	}
+	*refs = w.refs;
+	*depths = w.depths;
+	*count = w.count;
+	return CONFIG_SUCCESS;
+}
+
+config_result_t config_walk_run( config_ref_t *refs, unsigned int *depths, unsigned int count,
+                                 config_walk_visitor_t visitor, void *ctx, unsigned int nthreads,
+                                 char **output, size_t *output_len )
+{
+	walk_t			*w;
+	walk_worker_t	workers[WALK_MAX_THREADS];
+	pthread_t		threads[WALK_MAX_THREADS];
+	unsigned int	i, started = 1;
+	walk_task_t		all;
+	config_result_t	err = CONFIG_SUCCESS;
+
+	if ( 0 == nthreads )
+		nthreads = 1;
+	if ( nthreads > WALK_MAX_THREADS )
+		nthreads = WALK_MAX_THREADS;
+
+	if ( NULL == (w = calloc( 1, sizeof(*w) )) )
+		return CONFIG_ERR_NO_RESOURCES;
+	w->refs = refs;
+	w->depths = depths;
+	w->count = count;
+	w->visitor = visitor;
+	w->ctx = ctx;
+	w->ordered = ( NULL != output );
+	w->nthreads = nthreads;
+	w->remaining = count;
+	pthread_mutex_init( &w->lock, NULL );
+	for ( i = 0; i < nthreads; i++ )
+	{
+		pthread_mutex_init( &w->deques[i].lock, NULL );
+		workers[i].walk = w;
+		workers[i].self = i;
+	}
+
+	all.start = 0;
+	all.end = count;
+	walk_push( &w->deques[0], all );
+
+	/* the calling thread is worker 0 */
+	for ( ; started < nthreads; started++ )
+		if ( 0 != pthread_create( &threads[started], NULL, walk_worker, &workers[started] ) )
+			break;
+	walk_worker( &workers[0] );
+	for ( i = 1; i < started; i++ )
+		pthread_join( threads[i], NULL );
+
+	if ( CONFIG_SUCCESS != w->failed )
+		err = w->failed;
+	else if ( w->ordered )
+		err = walk_merge( w, output, output_len );
+
+	for ( i = 0; i < w->npieces; i++ )
+		free( w->pieces[i].data );
+	free( w->pieces );
+	for ( i = 0; i < nthreads; i++ )
+		pthread_mutex_destroy( &w->deques[i].lock );
+	pthread_mutex_destroy( &w->lock );
+	free( w );
+	return err;
+}
+
+/* -------------------------------------------------------------------------------- */
+/* CONFIG PUBLIC API */
+/* -------------------------------------------------------------------------------- */
+
+config_result_t config_walk_emit( config_walk_buf_t *out, const void *data, size_t len )
+{
+	if ( NULL == out )
+		return CONFIG_SUCCESS;
+
+	if ( out->len + len > out->cap )
+	{
+		size_t	cap = out->cap ? out->cap : 256;
+		char	*grown;
+
+		while ( cap < out->len + len )
+			cap *= 2;
+		if ( NULL == (grown = realloc( out->data, cap )) )
+		{
+			out->failed = 1;
+			return CONFIG_ERR_NO_RESOURCES;
+		}
+		out->data = grown;
+		out->cap = cap;
+	}
+	memcpy( out->data + out->len, data, len );
+	out->len += len;
+	return CONFIG_SUCCESS;
+}
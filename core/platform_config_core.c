@@ -70,11 +70,178 @@
 #include <stdio.h>
 #endif
 
-#include "platform_config.h"
+#include "platform_config_core_private.h"
 #include "htuple.h"
 #ifdef VER
 const char *platform_config_version_string = "#@# libplatform_config_core.so " VER;
 #endif
+
+/* Serializes the public API: lookups update the name index, so even readers mutate core state. */
+CONFIG_DEFINE_LOCK( config_core_lock );
+
+/* Most threads that can be bound to a namespace at once */
+#define CONFIG_MAX_BINDINGS		64
+
+/* A thread that config_namespace_bind() has put into a namespace; every other thread sees the shared view. */
+typedef struct {
+	config_thread_t	thread;
+	unsigned int	ns;
+} config_binding_t;
+
+static config_binding_t	config_bindings[CONFIG_MAX_BINDINGS];
+static unsigned int		config_binding_count;
+static unsigned int		config_caller_ns;		/* namespace of the thread holding the lock */
+static unsigned int		config_view_ns;			/* view the layout and hash caches were built in */
+
+/* Present the tree as namespace ns (0: the shared view) sees it. */
+static void config_select_view( unsigned int ns )
+{
+	ns = config_overlay_view( ns );
+
+	/* both caches describe ROOT_NODE, which every view sees differently */
+	if ( ns != config_view_ns )
+	{
+		config_layout_invalidate();
+		config_hash_flush();
+		config_view_ns = ns;
+	}
+}
+
+/* The binding of the calling thread, or NULL. */
+static config_binding_t *config_binding( void )
+{
+	unsigned int i;
+
+	for ( i = 0; i < config_binding_count; i++ )
+		if ( CONFIG_SAME_THREAD( config_bindings[i].thread, CONFIG_SELF() ) )
+			return &config_bindings[i];
+	return NULL;
+}
+
+/* Take the core lock and switch to the caller's view. */
+static void config_enter( void )
+{
+	config_binding_t *b;
+
+	CONFIG_LOCK( config_core_lock );
+	b = config_binding_count ? config_binding() : NULL;
+	config_caller_ns = b ? b->ns : 0;
+	config_select_view( config_caller_ns );
+}
+
+static void config_leave( void )
+{
+	CONFIG_UNLOCK( config_core_lock );
+}
+
+/* Walk as much of path[0..len) as exists.  Returns the offset of the first component that could not be resolved (len when all were). */
+static size_t config_walk( config_ref_t base_ref, const char *path, size_t len, int mode, config_ref_t *node_ref )
+{
+	int				for_write = (CONFIG_RESOLVE_WRITE == mode);
+	config_ref_t	ref = config_overlay_top( base_ref );
+	config_ref_t	own = for_write ? config_dedup_own( config_overlay_own( base_ref ) ) : ref;
+	config_ref_t	child;
+	size_t			start = 0;
+
+	while ( start < len )
+	{
+		size_t end = start;
+
+		while ( end < len && CONFIG_PATH_SEPARATOR != path[end] )
+			end++;
+
+		if ( end == start )
+			break;
+		/* a reference found below an alias must name the alias's own node */
+		if ( CONFIG_RESOLVE_REF == mode )
+			config_dedup_unalias( ref );
+		if ( 0 == (child = config_overlay_child( ref, path + start, end - start )) )
+			break;
+
+		/* writers follow the merged view but land in the top layer */
+		if ( for_write && 0 == (child = config_dedup_own( config_overlay_own_child( own, child ) )) )
+			break;
+		ref = own = child;
+		start = (end < len) ? end + 1 : end;
+	}
+
+	*node_ref = for_write ? own : ref;
+	return start;
+}
+
+config_result_t config_resolve( config_ref_t base_ref, const char *path, size_t len, int mode, config_ref_t *node_ref )
+{
+	if ( 0 == len )
+	{
+		/* let htuple decide what an empty name means */
+		*node_ref = htuple_find_child( base_ref, path, len );
+		return *node_ref ? CONFIG_SUCCESS : CONFIG_ERR_INVALID_REFERENCE;
+	}
+
+	if ( config_walk( base_ref, path, len, mode, node_ref ) < len )
+	{
+		*node_ref = 0;
+		return CONFIG_ERR_INVALID_REFERENCE;
+	}
+	return CONFIG_SUCCESS;
+}
+
+/* Find the node a write to "a.b.c" lands in: the deepest existing node of "a.b", and the part of the name htuple must still create. */
+static const char *config_split_leaf( config_ref_t base_ref, const char *name, config_ref_t *parent_ref )
+{
+	const char	*leaf = strrchr( name, CONFIG_PATH_SEPARATOR );
+	size_t		prefix, walked;
+
+	if ( NULL == leaf )
+	{
+		*parent_ref = config_dedup_own( config_overlay_own( base_ref ) );
+		return name;
+	}
+
+	prefix = leaf - name;
+	walked = config_walk( base_ref, name, prefix, CONFIG_RESOLVE_WRITE, parent_ref );
+
+	return (walked >= prefix) ? leaf + 1 : name + walked;
+}
+
+void config_cache_forget( config_ref_t root_ref )
+{
+	config_layout_invalidate();
+	config_hash_flush();
+	/* root_ref's parent is not known here, and loses it */
+	config_children_flush();
+	config_overlay_forget( root_ref );
+	config_array_forget( root_ref );
+	config_value_forget( root_ref );
+	config_journal_forget();
+	config_index_forget( root_ref );
+	config_stage_forget( root_ref );
+}
+
+void config_cache_invalidate( config_ref_t node_ref )
+{
+	config_array_invalidate( node_ref );
+	config_value_invalidate( node_ref );
+}
+
+/* A set through parent_ref/leaf has succeeded: invalidate the node if it existed before. */
+static void config_value_changed( config_ref_t parent_ref, const char *leaf )
+{
+	config_ref_t node_ref = 0;
+
+	/* the set may have created nodes */
+	config_overlay_changed();
+	config_children_invalidate( parent_ref );
+	config_layout_value_changed( parent_ref, leaf );
+
+	/* a dotted leaf means htuple created the node, so nothing can be cached for it */
+	if ( NULL == strchr( leaf, CONFIG_PATH_SEPARATOR )
+	  && 0 != (node_ref = config_index_lookup( parent_ref, leaf, strlen(leaf) )) )
+		config_cache_invalidate( node_ref );
+
+	config_hash_value_changed( parent_ref, node_ref );
+}
+
 /* -------------------------------------------------------------------------------- */
 /* CONFIG PUBLIC API */
 /* -------------------------------------------------------------------------------- */
@@ -82,16 +249,24 @@ const char *platform_config_version_string = "#@# libplatform_config_core.so " V
 /* Start at the specified reference node, locate the sub-node with the specified name, and return a reference to that node. */
 config_result_t config_node_find( config_ref_t base_ref, const char *name, config_ref_t *node_ref )
 {
-	if( (*node_ref = htuple_find_child( base_ref, name, strlen(name) )) )
-		return CONFIG_SUCCESS ;
-	else
-		return CONFIG_ERR_INVALID_REFERENCE ;
+	config_result_t err;
+
+	config_enter();
+	err = config_resolve( base_ref, name, strlen(name), CONFIG_RESOLVE_REF, node_ref );
+	config_leave();
+
+	return err;
 }
 
 /* Find the first child of the specified reference node, and return a reference to that child. */
 config_result_t config_node_first_child( config_ref_t node_ref, config_ref_t *child_ref )
 {
-	if( (*child_ref = htuple_first_child( node_ref )) )
+	config_enter();
+	config_dedup_unalias( node_ref );
+	*child_ref = config_overlay_first_child( node_ref );
+	config_leave();
+
+	if( *child_ref )
 		return CONFIG_SUCCESS;
 	else 
 		return CONFIG_ERR_INVALID_REFERENCE;	
@@ -100,20 +275,54 @@ config_result_t config_node_first_child( config_ref_t node_ref, config_ref_t *ch
 /* Find the first child of the specified reference node, and return a reference to that child. */
 config_result_t config_node_next_sibling( config_ref_t node_ref, config_ref_t *child_ref )
 {
-	if( (*child_ref = htuple_next_sibling( node_ref )) )
+	config_enter();
+	*child_ref = config_overlay_next_sibling( node_ref );
+	config_leave();
+
+	if( *child_ref )
 		return CONFIG_SUCCESS;
 	else 
 		return CONFIG_ERR_INVALID_REFERENCE;	
 }
 
+/* Return the number of children of the specified reference node. */
+config_result_t config_node_child_count( config_ref_t node_ref, unsigned int *count )
+{
+	config_result_t	err = CONFIG_SUCCESS;
+	const char		*name;
+
+	config_enter();
+	/* a stale reference has no children to count, which must not read as an empty node */
+	if ( ROOT_NODE != node_ref && CONFIG_SUCCESS != htuple_node_name( node_ref, &name ) )
+		err = CONFIG_ERR_INVALID_REFERENCE;
+	else
+		*count = config_children_count( node_ref );
+	config_leave();
+
+	return err;
+}
+
+/* Find the child at the specified position under the specified reference node, and return a reference to that child. */
+config_result_t config_node_child_at( config_ref_t node_ref, unsigned int index, config_ref_t *child_ref )
+{
+	config_enter();
+	config_dedup_unalias( node_ref );
+	*child_ref = config_children_at( node_ref, index );
+	config_leave();
+
+	return *child_ref ? CONFIG_SUCCESS : CONFIG_ERR_NOT_FOUND;
+}
+
 /* Return the name of the specified reference node. */
 config_result_t config_node_get_name( config_ref_t node_ref, char *name, size_t bufsize )
 {
 	config_result_t err = CONFIG_SUCCESS;
 	const char *val;
 
+	config_enter();
 	err = htuple_node_name( node_ref,&val );
 	if( CONFIG_SUCCESS == err ) strncpy ( name, val, bufsize );	
+	config_leave();
 
     return (err);
 }
@@ -123,7 +332,9 @@ config_result_t config_node_get_int( config_ref_t node_ref, int *val )
 {
 	config_result_t err = CONFIG_SUCCESS;
 	
-	err = htuple_node_int_value( node_ref, val );
+	config_enter();
+	err = config_value_int( node_ref, val );
+	config_leave();
     
 	return (err);
 }
@@ -134,8 +345,10 @@ config_result_t config_node_get_str( config_ref_t node_ref, char *string, size_t
 	config_result_t err = CONFIG_SUCCESS;
 	const char *val;
 
-	err = htuple_node_str_value( node_ref, &val );
+	config_enter();
+	err = config_value_str( node_ref, &val );
 	if( CONFIG_SUCCESS == err ) strncpy( string, val, bufsize );	
+	config_leave();
 
 	return (err);
 }
@@ -143,9 +356,14 @@ config_result_t config_node_get_str( config_ref_t node_ref, char *string, size_t
 /* Start at the specified reference node, locate the sub-node with the specified name, and return the integer value associated with that name. */
 config_result_t config_get_int( config_ref_t base_ref, const char *name, int *val )
 {   
-	int         err = CONFIG_SUCCESS;
+	int         	err = CONFIG_SUCCESS;
+	config_ref_t	node_ref;
 
-    err = htuple_get_int_value( base_ref, name, strlen(name), val );
+	config_enter();
+	err = config_resolve( base_ref, name, strlen(name), CONFIG_RESOLVE_READ, &node_ref );
+	if ( CONFIG_SUCCESS == err )
+		err = config_value_int( node_ref, val );
+	config_leave();
 
     return(err);
 }
@@ -153,21 +371,222 @@ config_result_t config_get_int( config_ref_t base_ref, const char *name, int *va
 /* Start at the specified reference node, locate the sub-node with the specified name, and return the string value associated with that name. */
 config_result_t config_get_str( config_ref_t base_ref, const char *name, char *string, size_t bufsize ) 
 {
-    int         err = CONFIG_SUCCESS;
-    const char  *val;
+    int         	err = CONFIG_SUCCESS;
+    const char  	*val;
+	config_ref_t	node_ref;
 
-    err = htuple_get_str_value( base_ref, name, strlen(name), &val );
+	config_enter();
+	err = config_resolve( base_ref, name, strlen(name), CONFIG_RESOLVE_READ, &node_ref );
+	if ( CONFIG_SUCCESS == err )
+		err = config_value_str( node_ref, &val );
     if ( CONFIG_SUCCESS == err ) strncpy( string, val, bufsize );
+	config_leave();
 
     return(err);
 }
 
+/* Start at the specified reference node, locate the sub-node with the specified name, and copy out up to max elements of its integer array. */
+config_result_t config_get_int_array( config_ref_t base_ref, const char *name, int *values, unsigned int max, unsigned int *count )
+{
+	config_result_t	err;
+	config_ref_t	node_ref;
+	const int		*array;
+	unsigned int	n;
+
+	config_enter();
+	err = config_resolve( base_ref, name, strlen(name), CONFIG_RESOLVE_READ, &node_ref );
+	if ( CONFIG_SUCCESS == err )
+		err = config_array_get( node_ref, &array, &n );
+	if ( CONFIG_SUCCESS == err )
+	{
+		memcpy( values, array, (n < max ? n : max) * sizeof(*values) );
+		*count = n;
+	}
+	config_leave();
+
+	return err;
+}
+
+/* Start at the specified reference node, locate the sub-node with the specified name, and return one element of its integer array. */
+config_result_t config_get_int_array_elem( config_ref_t base_ref, const char *name, unsigned int index, int *val )
+{
+	config_result_t	err;
+	config_ref_t	node_ref;
+	const int		*array;
+	unsigned int	n;
+
+	config_enter();
+	err = config_resolve( base_ref, name, strlen(name), CONFIG_RESOLVE_READ, &node_ref );
+	if ( CONFIG_SUCCESS == err )
+		err = config_array_get( node_ref, &array, &n );
+	if ( CONFIG_SUCCESS == err && index >= n )
+		err = CONFIG_ERR_NOT_FOUND;
+	if ( CONFIG_SUCCESS == err )
+		*val = array[index];
+	config_leave();
+
+	return err;
+}
+
+/* Start at the specified reference node and fill the fields of out described by desc[0..count). */
+config_result_t config_bind_struct( config_ref_t base_ref, const config_bind_desc_t *desc, unsigned int count, void *out, unsigned int *present )
+{
+	unsigned int	i, found = 0;
+	config_ref_t	node_ref;
+	const char		*str;
+
+	if ( count > CONFIG_BIND_MAX_FIELDS )
+		return CONFIG_ERR_NO_RESOURCES;
+
+	config_enter();
+	for ( i = 0; i < count; i++ )
+	{
+		char	*field = (char *) out + desc[i].offset;
+		int		have;
+
+		have = ( CONFIG_SUCCESS == config_resolve( base_ref, desc[i].name, strlen(desc[i].name), CONFIG_RESOLVE_READ, &node_ref ) );
+
+		switch ( desc[i].type )
+		{
+		case CONFIG_BIND_INT:
+			if ( have && CONFIG_SUCCESS == config_value_int( node_ref, (int *) field ) )
+				found |= 1u << i;
+			else
+				*(int *) field = desc[i].default_int;
+			break;
+
+		case CONFIG_BIND_STR:
+			if ( have && CONFIG_SUCCESS == config_value_str( node_ref, &str ) )
+				found |= 1u << i;
+			else
+				str = desc[i].default_str;
+			if ( NULL != str && desc[i].size )
+			{
+				strncpy( field, str, desc[i].size );
+				field[desc[i].size - 1] = '\0';
+			}
+			break;
+		}
+	}
+	config_leave();
+
+	if ( present )
+		*present = found;
+	return CONFIG_SUCCESS;
+}
+
+/* Start at the specified reference node and return the nodes matching pattern that pass pred. */
+config_result_t config_query( config_ref_t base_ref, const char *pattern, const config_query_pred_t *pred,
+                              config_query_result_t *results, unsigned int max, unsigned int *count )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_query_run( base_ref, pattern, pred, results, max, count );
+	config_leave();
+
+	return err;
+}
+
+/* Reduce the integer value of child_key under each child of the specified reference node. */
+config_result_t config_aggregate( config_ref_t base_ref, const char *child_key, config_aggregate_op_t op, long long *result )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_aggregate_run( base_ref, child_key, op, result );
+	config_leave();
+
+	return err;
+}
+
+/* Find the memory layout entry containing the physical address pa. */
+config_result_t config_layout_lookup_pa( unsigned long pa, config_ref_t *node_ref, unsigned long *offset )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_layout_lookup( pa, node_ref, offset );
+	config_leave();
+
+	return err;
+}
+
+/* Return the content hash of the subtree rooted at the specified reference node. */
+config_result_t config_subtree_hash( config_ref_t node_ref, unsigned long long *hash )
+{
+	config_result_t	err = CONFIG_SUCCESS;
+	const char		*name;
+
+	config_enter();
+	/* a stale reference would hash like an empty subtree */
+	if ( ROOT_NODE != node_ref && CONFIG_SUCCESS != htuple_node_name( node_ref, &name ) )
+		err = CONFIG_ERR_INVALID_REFERENCE;
+	else
+		*hash = config_hash_subtree( node_ref );
+	config_leave();
+
+	return err;
+}
+
+/* Compare two subtrees, descending only into children whose hashes differ. */
+config_result_t config_subtree_diff( config_ref_t a_ref, config_ref_t b_ref, config_diff_t *diffs, unsigned int max, unsigned int *count )
+{
+	config_enter();
+	config_hash_diff( a_ref, b_ref, diffs, max, count );
+	config_leave();
+
+	return CONFIG_SUCCESS;
+}
+
+#ifndef __KERNEL__
+/* Call visitor for every node of the subtree rooted at the specified reference node, on nthreads threads. */
+config_result_t config_walk_parallel( config_ref_t base_ref, config_walk_visitor_t visitor, void *ctx, unsigned int nthreads,
+                                      char **output, size_t *output_len )
+{
+	config_result_t	err;
+	config_ref_t	*refs;
+	unsigned int	*depths, count, epoch;
+
+	/* only the flattening needs the lock: visitors may call back into the API */
+	config_enter();
+	epoch = config_epoch_pin();
+	err = config_walk_flatten( base_ref, &refs, &depths, &count );
+	config_leave();
+
+	/* the pin keeps nodes removed meanwhile, visitors' own removals included, valid until the walk is over */
+	if ( CONFIG_SUCCESS == err )
+	{
+		err = config_walk_run( refs, depths, count, visitor, ctx, nthreads, output, output_len );
+		free( refs );
+		free( depths );
+	}
+
+	config_enter();
+	config_epoch_unpin( epoch );
+	config_leave();
+	return err;
+}
+#endif
+
 /* Start at the specified reference node, locate or create the sub-node with the specified name, and assign the integer value to that name. */
 config_result_t config_set_int( config_ref_t base_ref, const char *name, int val )
 {
 	config_result_t err = CONFIG_SUCCESS;
+	config_ref_t	parent_ref;
+	const char		*leaf;
 
-	err = htuple_set_int_value( base_ref, name, strlen(name), val );
+	config_enter();
+	leaf = config_split_leaf( base_ref, name, &parent_ref );
+	err = config_epoch_claim( parent_ref, leaf, strlen(leaf) );
+	if ( CONFIG_SUCCESS == err )
+		err = htuple_set_int_value( parent_ref, leaf, strlen(leaf), val );
+	if ( CONFIG_SUCCESS == err )
+	{
+		config_value_changed( parent_ref, leaf );
+		config_journal_record( CONFIG_JOURNAL_SET_INT, parent_ref, leaf, &val, sizeof(val) );
+	}
+	config_leave();
 
 	return err;
 }
@@ -176,8 +595,122 @@ config_result_t config_set_int( config_ref_t base_ref, const char *name, int val
 config_result_t config_set_str( config_ref_t base_ref, const char *name, const char *string, size_t bufsize ) 
 {
 	config_result_t err = CONFIG_SUCCESS;
+	config_ref_t	parent_ref;
+	const char		*leaf;
+
+	config_enter();
+	leaf = config_split_leaf( base_ref, name, &parent_ref );
+	err = config_epoch_claim( parent_ref, leaf, strlen(leaf) );
+	if ( CONFIG_SUCCESS == err )
+		err = htuple_set_str_value( parent_ref, leaf, strlen(leaf), string, strlen(string) );
+	if ( CONFIG_SUCCESS == err )
+	{
+		config_value_changed( parent_ref, leaf );
+		config_journal_record( CONFIG_JOURNAL_SET_STR, parent_ref, leaf, string, strlen(string) );
+	}
+	config_leave();
+
+	return (err);
+}
+
+/* Whether a load into target_ref can take the bulk path: target_ref has no children at all, not even removed ones. */
+static int config_load_empty( config_ref_t target_ref )
+{
+	/* under layers the merged view of the node depends on more than its own children */
+	return ! config_overlay_active() && 0 == htuple_first_child( target_ref );
+}
+
+/* A load has inserted data beneath target_ref, which was empty before if bulk is set. */
+static void config_loaded( config_ref_t target_ref, int bulk )
+{
+	if ( bulk )
+	{
+		/* nothing below target_ref can have been cached */
+		config_cache_invalidate( target_ref );
+		config_children_invalidate( target_ref );
+	}
+	else
+	{
+		/* the load may have replaced array values anywhere beneath target_ref */
+		config_array_flush();
+		config_value_flush();
+		config_children_flush();
+	}
+	config_overlay_changed();
+	config_layout_invalidate();
+	config_hash_flush();
+	config_dedup_loaded( target_ref );
+	/* every edge below target_ref is new, so they can all go in without looking for existing ones */
+	if ( bulk )
+		config_index_build( target_ref );
+}
+
+/*
+ * Parse config_data, holding lists lists, into a scratch tree and merge it
+ * into target_ref, so that every name it reuses is claimed first and every
+ * value it writes takes or drops the array type.
+ */
+static config_result_t config_load_merge( config_ref_t target_ref, const char *config_data, size_t datalength, unsigned int lists )
+{
+	config_result_t err;
+	config_ref_t	scratch_ref;
+
+	if ( CONFIG_SUCCESS != (err = config_stage_new( &scratch_ref )) )
+		return err;
+	err = htuple_parse_config_string( scratch_ref, config_data, datalength );
+	if ( CONFIG_SUCCESS == err )
+		err = config_array_loaded( scratch_ref, lists );
+	if ( CONFIG_SUCCESS == err )
+		err = config_tree_merge( target_ref, scratch_ref );
+	config_stage_discard( scratch_ref );
+
+	return (err);
+}
+
+/* config_load() without the lock. */
+static config_result_t config_load_run( config_ref_t base_ref, const char *config_data, size_t datalength )
+{
+	config_result_t err = CONFIG_SUCCESS;
+	config_ref_t	target_ref;
+	const char		*text = config_data;
+	size_t			text_len = datalength;
+	char			*rewritten = NULL;
+	size_t			rewritten_len;
+	unsigned int	lists = 0;
+	int				bulk = 0, claim;
+
+	/* htuple would load into removed or moved-away content still sitting under a name the text reuses */
+	claim = config_epoch_lingering() || config_stage_hiding();
+	err = config_array_rewrite( config_data, datalength, &rewritten, &rewritten_len, &lists );
+	if ( CONFIG_SUCCESS == err && NULL != rewritten )
+	{
+		config_data = rewritten;
+		datalength = rewritten_len;
+	}
+	if ( CONFIG_SUCCESS == err )
+	{
+		target_ref = config_dedup_own( config_overlay_own( base_ref ) );
+		bulk = config_load_empty( target_ref );
+		/* only new nodes may be searched for lists, and a value loaded over an array must drop its type */
+		if ( ! bulk && (claim || lists || config_array_present()) )
+		{
+			err = config_load_merge( target_ref, config_data, datalength, lists );
+			/* a merge that failed half way has still written part of the tree */
+			if ( CONFIG_SUCCESS != err )
+				config_loaded( target_ref, 0 );
+		}
+		else if ( CONFIG_SUCCESS == (err = htuple_parse_config_string( target_ref, config_data, datalength ))
+		       && CONFIG_SUCCESS != (err = config_array_loaded( target_ref, lists )) )
+			config_loaded( target_ref, 0 );
+	}
+	if ( CONFIG_SUCCESS == err )
+	{
+		config_loaded( target_ref, bulk );
+		config_journal_record( CONFIG_JOURNAL_LOAD, target_ref, "", text, text_len );
+	}
 
-	err = htuple_set_str_value( base_ref, name, strlen(name), string, strlen(string) );
+	if ( NULL != rewritten )
+		CONFIG_FREE( rewritten );
 
 	return (err);
 }
@@ -185,39 +718,645 @@ config_result_t config_set_str( config_ref_t base_ref, const char *name, const c
 /* Parse the specified string of configuration data and insert it into the dictionary at the specified reference node. */
 config_result_t config_load( config_ref_t base_ref, const char *config_data, size_t datalength )
 {
-	config_result_t err = CONFIG_SUCCESS;
+	config_result_t err;
 
-	err =  htuple_parse_config_string( base_ref, config_data, datalength );
+	config_enter();
+	err = config_load_run( base_ref, config_data, datalength );
+	config_leave();
 
 	return (err);
 }
 
+/* config_load_json() without the lock. */
+static config_result_t config_load_json_run( config_ref_t base_ref, const char *json, size_t len )
+{
+	config_result_t err;
+	config_ref_t	target_ref;
+	int				bulk;
+
+	/* every member name is claimed as it is inserted */
+	target_ref = config_dedup_own( config_overlay_own( base_ref ) );
+	bulk = config_load_empty( target_ref );
+	err = config_json_import( target_ref, json, len );
+	/* a failed import may still have inserted part of the object */
+	config_loaded( target_ref, bulk );
+	if ( CONFIG_SUCCESS == err )
+		config_journal_record( CONFIG_JOURNAL_LOAD_JSON, target_ref, "", json, len );
+
+	return err;
+}
+
+/* Parse the specified JSON object and insert its members into the dictionary at the specified reference node. */
+config_result_t config_load_json( config_ref_t base_ref, const char *json, size_t len )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_load_json_run( base_ref, json, len );
+	config_leave();
+
+	return err;
+}
+
+/* Apply a batch of flat updates, resolving each ancestor shared by consecutive paths once; sorted batches share the most. */
+static config_result_t config_flat_apply( config_ref_t base_ref, const config_flat_batch_t *batch )
+{
+	config_ref_t	stack[CONFIG_FLAT_MAX_DEPTH + 1];	/* stack[d]: the node at the first d components of prev */
+	size_t			ends[CONFIG_FLAT_MAX_DEPTH + 1];	/* ends[d]: length of those d components in prev */
+	unsigned int	depth = 0, i;
+	const char		*prev = "";
+	config_result_t	err = CONFIG_SUCCESS;
+
+	stack[0] = config_dedup_own( config_overlay_own( base_ref ) );
+	ends[0] = 0;
+
+	for ( i = 0; i < batch->count && CONFIG_SUCCESS == err; i++ )
+	{
+		const config_flat_entry_t	*e = &batch->entries[i];
+		const char					*leaf = strrchr( e->path, CONFIG_PATH_SEPARATOR );
+		size_t						prefix = leaf ? (size_t) (leaf - e->path) : 0;
+		size_t						start, end;
+		config_ref_t				child;
+
+		/* keep the ancestors this path shares with the previous one */
+		while ( depth > 0 && (ends[depth] > prefix || CONFIG_PATH_SEPARATOR != e->path[ends[depth]]
+		                      || memcmp( e->path, prev, ends[depth] )) )
+			depth--;
+
+		/* resolve the rest of the prefix as far as it exists; htuple creates what is missing */
+		start = depth ? ends[depth] + 1 : 0;
+		while ( start < prefix && depth < CONFIG_FLAT_MAX_DEPTH )
+		{
+			for ( end = start; CONFIG_PATH_SEPARATOR != e->path[end]; end++ )
+				;
+			if ( config_walk( stack[depth], e->path + start, end - start, CONFIG_RESOLVE_WRITE, &child ) < end - start )
+				break;
+			stack[++depth] = child;
+			ends[depth] = end;
+			start = end + 1;
+		}
+		leaf = e->path + start;
+
+		if ( CONFIG_SUCCESS != (err = config_epoch_claim( stack[depth], leaf, strlen(leaf) )) )
+			break;
+		if ( e->str )
+			err = htuple_set_str_value( stack[depth], leaf, strlen(leaf), e->str, e->str_len );
+		else
+			err = htuple_set_int_value( stack[depth], leaf, strlen(leaf), e->val );
+		if ( CONFIG_SUCCESS == err )
+		{
+			config_value_changed( stack[depth], leaf );
+			if ( e->str )
+				config_journal_record( CONFIG_JOURNAL_SET_STR, stack[depth], leaf, e->str, e->str_len );
+			else
+				config_journal_record( CONFIG_JOURNAL_SET_INT, stack[depth], leaf, &e->val, sizeof(e->val) );
+		}
+		prev = e->path;
+	}
+
+	return err;
+}
+
+/* Parse the specified flat "dotted.path = value" lines and apply them as one batch at the specified reference node. */
+config_result_t config_load_flat( config_ref_t base_ref, const char *data, size_t len )
+{
+	config_result_t		err;
+	config_flat_batch_t	batch;
+
+	/* parse and sort without the lock */
+	if ( CONFIG_SUCCESS != (err = config_flat_parse( data, len, &batch )) )
+		return err;
+
+	config_enter();
+	err = config_flat_apply( base_ref, &batch );
+	config_leave();
+
+	config_flat_free( &batch );
+	return err;
+}
+
+/* Write the subtree rooted at the specified reference node as JSON. */
+config_result_t config_export_json( config_ref_t base_ref, char *buf, size_t bufsize, size_t *len )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_json_export( base_ref, buf, bufsize, len );
+	config_leave();
+
+	return err;
+}
+
+/* config_private_tree_remove() without the lock. */
+static config_result_t config_remove_run( config_ref_t base_ref )
+{
+	config_result_t err;
+
+	/* from a namespace only what it wrote itself can be removed */
+	if ( config_caller_ns && ! config_overlay_ns_private( base_ref ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	/* the layer, namespace and stage roots belong to the core, which removes them itself */
+	if ( config_overlay_root( base_ref ) || config_stage_internal( base_ref ) )
+		return CONFIG_ERR_INVALID_REFERENCE;
+
+	/* once removed the node has no path, so it is worked out first and only recorded if the removal happens */
+	config_journal_hold( CONFIG_JOURNAL_REMOVE, base_ref );
+
+	if ( ROOT_NODE == base_ref )
+	{
+		/* the root cannot be hidden from anything, so it goes at once */
+		config_dedup_forget( base_ref );
+		config_cache_forget( base_ref );
+		config_array_deleted( base_ref );
+		err = htuple_delete_private_tree( base_ref );
+	}
+	else
+		err = config_epoch_retire( base_ref );
+
+	if ( CONFIG_SUCCESS == err )
+		config_journal_commit();
+	return err;
+}
+
 /* Parse the specified string of configuration data and insert it into the dictionary at the specified reference node. */
 config_result_t config_private_tree_remove( config_ref_t base_ref )
 {
-	config_result_t err = CONFIG_SUCCESS;
-
-	err = htuple_delete_private_tree( base_ref );
+	config_result_t err;
 
+	config_enter();
+	err = config_remove_run( base_ref );
+	config_leave();
 
 	return (err);
 }
 
 
+/* Keep every node reference taken from now on valid until config_epoch_exit(), even if the node is removed. */
+config_result_t config_epoch_enter( unsigned int *epoch )
+{
+	config_enter();
+	*epoch = config_epoch_pin();
+	config_leave();
+
+	return CONFIG_SUCCESS;
+}
+
+/* Leave the section opened by config_epoch_enter(), letting removed nodes go. */
+config_result_t config_epoch_exit( unsigned int epoch )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_epoch_unpin( epoch );
+	config_leave();
+
+	return err;
+}
+
+/* Stack a new, empty overlay layer on top of the database. */
+config_result_t config_overlay_push( const char *name, config_ref_t *layer_ref )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_overlay_push_layer( name, layer_ref );
+	config_leave();
+
+	return err;
+}
+
+/* Remove an overlay layer and everything loaded into it. */
+config_result_t config_overlay_drop( const char *name )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_overlay_drop_layer( name );
+	config_leave();
+
+	return err;
+}
+
+/* Return the root node of an overlay layer. */
+config_result_t config_overlay_find( const char *name, config_ref_t *layer_ref )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_overlay_find_layer( name, layer_ref );
+	config_leave();
+
+	return err;
+}
+
+/* Journal the value node_ref holds as written to parent_ref.name. */
+static void config_journal_value( config_ref_t parent_ref, const char *name, config_ref_t node_ref )
+{
+	const char	*str;
+	int			val;
+
+	if ( CONFIG_SUCCESS == htuple_node_int_value( node_ref, &val ) )
+		config_journal_record( CONFIG_JOURNAL_SET_INT, parent_ref, name, &val, sizeof(val) );
+	else if ( NULL != (str = config_array_list( node_ref )) )
+		config_journal_record_array( parent_ref, name, str );
+	else if ( CONFIG_SUCCESS == htuple_node_str_value( node_ref, &str ) )
+		config_journal_record( CONFIG_JOURNAL_SET_STR, parent_ref, name, str, strlen(str) );
+}
+
+/* Copy the private nodes of a namespace below src_ref into the shared node dst_ref. */
+static config_result_t config_publish_copy( config_ref_t src_ref, config_ref_t dst_ref )
+{
+	config_ref_t	child, dst_child;
+	config_result_t	err = CONFIG_SUCCESS;
+	const char		*name, *str;
+	size_t			len;
+	int				val;
+
+	for ( child = config_tree_first_child( src_ref ); child && CONFIG_SUCCESS == err; child = config_tree_next_sibling( child ) )
+	{
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			return CONFIG_ERR_INVALID_REFERENCE;
+		len = strlen( name );
+
+		if ( config_tree_first_child( child ) )
+		{
+			/* an inner node: merge into what the shared view already has there */
+			if ( config_walk( dst_ref, name, len, CONFIG_RESOLVE_WRITE, &dst_child ) < len
+			  && 0 == (dst_child = config_tree_add_child( dst_ref, name, len )) )
+				return CONFIG_ERR_NO_RESOURCES;
+			config_overlay_changed();
+			config_children_invalidate( dst_ref );
+			err = config_publish_copy( child, dst_child );
+			continue;
+		}
+
+		if ( CONFIG_SUCCESS != (err = config_epoch_claim( dst_ref, name, len )) )
+			break;
+		if ( CONFIG_SUCCESS == htuple_node_int_value( child, &val ) )
+			err = htuple_set_int_value( dst_ref, name, len, val );
+		else if ( CONFIG_SUCCESS == htuple_node_str_value( child, &str ) )
+			err = htuple_set_str_value( dst_ref, name, len, str, strlen(str) );
+		else
+			continue;
+		if ( CONFIG_SUCCESS == err )
+		{
+			config_value_changed( dst_ref, name );
+			err = config_array_mark( dst_ref, name, len, config_array_is( child ) );
+		}
+		if ( CONFIG_SUCCESS == err )
+			config_journal_value( dst_ref, name, child );
+	}
+
+	return err;
+}
+
+/* Create a private namespace layered over the shared tree. */
+config_result_t config_namespace_create( unsigned int *ns )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_overlay_ns_create( ns );
+	config_leave();
+
+	return err;
+}
+
+/* Discard a namespace and everything written to it. */
+config_result_t config_namespace_destroy( unsigned int ns )
+{
+	config_result_t	err;
+	unsigned int	i;
+
+	config_enter();
+	if ( CONFIG_SUCCESS == (err = config_overlay_ns_destroy( ns )) )
+	{
+		/* threads still bound to it fall back to the shared view */
+		for ( i = 0; i < config_binding_count; )
+			if ( config_bindings[i].ns == ns )
+				config_bindings[i] = config_bindings[--config_binding_count];
+			else
+				i++;
+	}
+	config_leave();
+
+	return err;
+}
+
+/* Make the calling thread's calls see namespace ns; 0 returns it to the shared view. */
+config_result_t config_namespace_bind( unsigned int ns )
+{
+	config_result_t		err = CONFIG_SUCCESS;
+	config_binding_t	*b;
+
+	CONFIG_LOCK( config_core_lock );
+	b = config_binding();
+	if ( 0 == ns )
+	{
+		if ( b )
+			*b = config_bindings[--config_binding_count];
+	}
+	else if ( 0 == config_overlay_ns_root( ns ) )
+		err = CONFIG_ERR_INVALID_REFERENCE;
+	else if ( b )
+		b->ns = ns;
+	else if ( config_binding_count == CONFIG_MAX_BINDINGS )
+		err = CONFIG_ERR_NO_RESOURCES;
+	else
+	{
+		config_bindings[config_binding_count].thread = CONFIG_SELF();
+		config_bindings[config_binding_count].ns = ns;
+		config_binding_count++;
+	}
+	CONFIG_UNLOCK( config_core_lock );
+
+	return err;
+}
+
+/* Write everything in a namespace to the shared tree and empty the namespace. */
+config_result_t config_namespace_publish( unsigned int ns )
+{
+	config_result_t	err;
+	config_ref_t	root_ref, dst_ref;
+
+	config_enter();
+	if ( 0 == (root_ref = config_overlay_ns_root( ns )) )
+		err = CONFIG_ERR_INVALID_REFERENCE;
+	else
+	{
+		/* the writes land where a shared writer's would */
+		config_select_view( 0 );
+		dst_ref = config_dedup_own( config_overlay_own( ROOT_NODE ) );
+		err = config_publish_copy( root_ref, dst_ref );
+		if ( CONFIG_SUCCESS == err )
+			err = config_overlay_ns_reset( ns );
+		config_select_view( config_caller_ns );
+	}
+	config_leave();
+
+	return err;
+}
+
+/* Create an empty tree to build a replacement in, off the live database. */
+config_result_t config_stage_prepare( config_ref_t *stage_ref )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_stage_new( stage_ref );
+	config_leave();
+
+	return err;
+}
+
+/* Journal the leaves below node_ref as sets. */
+static void config_stage_journal( config_ref_t node_ref )
+{
+	config_ref_t	child;
+	const char		*name;
+
+	for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+	{
+		if ( CONFIG_SUCCESS != htuple_node_name( child, &name ) )
+			continue;
+		config_journal_value( node_ref, name, child );
+		config_stage_journal( child );
+	}
+}
+
+/* Replace everything below base_ref with a tree built under stage_ref, in one step. */
+config_result_t config_stage_publish( config_ref_t base_ref, config_ref_t stage_ref )
+{
+	config_result_t	err = CONFIG_ERR_INVALID_REFERENCE;
+	config_ref_t	node_ref, child;
+
+	config_enter();
+	if ( config_stage_prepared( stage_ref ) )
+	{
+		/* the swap lands where a shared load would */
+		config_select_view( 0 );
+		node_ref = config_overlay_own( base_ref );
+		/* a node already forwarding has no content of its own to unshare */
+		if ( config_stage_forward( node_ref ) == node_ref )
+			node_ref = config_dedup_own( node_ref );
+
+		/* replayed, the old children go one by one and the new leaves come back as sets */
+		if ( config_journal_active() && config_stage_valid( node_ref, stage_ref ) )
+			for ( child = config_tree_first_child( node_ref ); child; child = config_tree_next_sibling( child ) )
+				if ( ! config_overlay_internal( child ) && ! config_stage_hidden( child ) )
+					config_journal_record( CONFIG_JOURNAL_REMOVE, child, "", "", 0 );
+
+		if ( CONFIG_SUCCESS == (err = config_stage_swap( node_ref, stage_ref )) )
+		{
+			config_array_flush();
+			config_value_flush();
+			config_children_flush();
+			config_overlay_changed();
+			config_layout_invalidate();
+			config_hash_flush();
+			if ( config_journal_active() )
+				config_stage_journal( node_ref );
+		}
+		config_select_view( config_caller_ns );
+	}
+	config_leave();
+
+	return err;
+}
+
+/* Move the subtree at src_ref below new_parent_ref as new_name, without copying it. */
+config_result_t config_node_move( config_ref_t src_ref, config_ref_t new_parent_ref, const char *new_name )
+{
+	config_result_t	err = CONFIG_ERR_INVALID_REFERENCE;
+	config_ref_t	parent_ref, dst_ref;
+	size_t			len = strlen( new_name );
+
+	config_enter();
+	/* a layer or namespace may present src_ref, and a shared subtree other parents, that a move cannot follow */
+	if ( ! config_overlay_active() && ! config_dedup_active() )
+	{
+		parent_ref = config_stage_forward( new_parent_ref );
+		err = config_stage_check_move( src_ref, parent_ref, new_name, len );
+		if ( CONFIG_SUCCESS == err )
+		{
+			/* replayed, a move is the removal of the old subtree and sets recreating it */
+			config_journal_hold( CONFIG_JOURNAL_REMOVE, src_ref );
+			err = config_stage_move( src_ref, parent_ref, new_name, len, &dst_ref );
+		}
+		if ( CONFIG_SUCCESS == err )
+		{
+			config_journal_commit();
+			/* the old parent is not always known */
+			config_children_flush();
+			config_overlay_changed();
+			config_layout_invalidate();
+			config_hash_moved( config_stage_forward( dst_ref ), parent_ref );
+			if ( config_journal_active() )
+			{
+				config_journal_value( parent_ref, new_name, dst_ref );
+				config_stage_journal( dst_ref );
+			}
+		}
+	}
+	config_leave();
+
+	return err;
+}
+
+/* The node a journal entry names, for writing. */
+static config_result_t config_journal_target( const char *path, config_ref_t *node_ref )
+{
+	if ( '\0' == *path )
+	{
+		*node_ref = ROOT_NODE;
+		return CONFIG_SUCCESS;
+	}
+	return config_resolve( ROOT_NODE, path, strlen(path), CONFIG_RESOLVE_WRITE, node_ref );
+}
+
+/* Apply a parsed journal, in order. */
+static config_result_t config_journal_apply( const config_journal_batch_t *batch )
+{
+	config_flat_batch_t	sets;
+	config_ref_t		target_ref;
+	config_result_t		err = CONFIG_SUCCESS;
+	unsigned int		i;
+
+	for ( i = 0; i < batch->count && CONFIG_SUCCESS == err; i++ )
+	{
+		const config_journal_entry_t *e = &batch->entries[i];
+
+		if ( CONFIG_JOURNAL_SETS == e->op )
+		{
+			/* a run of sets goes in as one sorted batch, like an update file */
+			sets.entries = batch->sets + e->first;
+			sets.count = e->sets;
+			sets.text = NULL;
+			err = config_flat_apply( ROOT_NODE, &sets );
+			continue;
+		}
+
+		if ( CONFIG_SUCCESS != (err = config_journal_target( e->path, &target_ref )) )
+			break;
+		if ( CONFIG_JOURNAL_LOAD == e->op )
+			err = config_load_run( target_ref, e->data, e->data_len );
+		else if ( CONFIG_JOURNAL_LOAD_JSON == e->op )
+			err = config_load_json_run( target_ref, e->data, e->data_len );
+		else
+			err = config_remove_run( target_ref );
+	}
+
+	return err;
+}
+
+/* Record every change to the database from now on in a journal of the specified size; 0 stops and discards it. */
+config_result_t config_journal_start( size_t size )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_journal_start_run( size );
+	config_leave();
+
+	return err;
+}
+
+/* Copy the journal out, to be replayed later. */
+config_result_t config_journal_save( char *buf, size_t bufsize, size_t *len )
+{
+	config_result_t err;
+
+	config_enter();
+	err = config_journal_save_run( buf, bufsize, len );
+	config_leave();
+
+	return err;
+}
+
+/* Apply a saved journal to the database, coalescing superseded sets. */
+config_result_t config_journal_replay( const char *data, size_t len )
+{
+	config_result_t			err;
+	config_journal_batch_t	batch;
+
+	/* check and coalesce without the lock */
+	if ( CONFIG_SUCCESS != (err = config_journal_parse( data, len, &batch )) )
+		return err;
+
+	config_enter();
+	err = config_journal_apply( &batch );
+	config_leave();
+
+	config_journal_free( &batch );
+	return err;
+}
+
+/* Report the health of the core name index. */
+config_result_t config_index_stats( config_index_stats_t *stats )
+{
+	config_enter();
+	config_index_get_stats( stats );
+	config_leave();
+
+	return CONFIG_SUCCESS;
+}
+
+/* Turn sharing of identical subtrees on subsequent loads on or off. */
+config_result_t config_dedup_enable( int enable )
+{
+	config_enter();
+	config_dedup_set_enabled( enable );
+	config_leave();
+
+	return CONFIG_SUCCESS;
+}
+
+/* Report how many subtrees are shared and how many nodes that saves. */
+config_result_t config_dedup_stats( config_dedup_stats_t *stats )
+{
+	config_enter();
+	config_dedup_get_stats( stats );
+	config_leave();
+
+	return CONFIG_SUCCESS;
+}
+
 /* initialize the memory layout internal hash table */
 config_result_t config_initialize( void )
 {
-	if (htuple_initialize())
-		return CONFIG_SUCCESS;
-	else
-		return CONFIG_ERR_INITIALIZE_FAILED;
+	config_result_t err = CONFIG_ERR_INITIALIZE_FAILED;
+
+	config_enter();
+	if ( htuple_initialize() && CONFIG_SUCCESS == config_index_init() )
+		err = CONFIG_SUCCESS;
+	config_leave();
+
+	return err;
 }
 
 /* deinitialize memory layout internal hash table */
 config_result_t config_deinitialize(void)
 {
-	if (htuple_deinitialize())
-		return CONFIG_SUCCESS;
-	else
-		return CONFIG_ERR_DEINITIALIZE_FAILED;
+	config_result_t err = CONFIG_ERR_DEINITIALIZE_FAILED;
+
+	config_enter();
+	config_overlay_deinit();
+	config_dedup_deinit();
+	config_stage_deinit();
+	config_array_deinit();
+	config_value_flush();
+	config_children_flush();
+	config_layout_deinit();
+	config_hash_flush();
+	config_index_deinit();
+	config_epoch_deinit();
+	config_journal_deinit();
+	config_binding_count = 0;
+	config_view_ns = 0;
+	if ( htuple_deinitialize() )
+		err = CONFIG_SUCCESS;
+	config_leave();
+
+	return err;
 }
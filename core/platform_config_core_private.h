@@ -0,0 +1,585 @@
+/* 
+
+  This file is provided under a dual BSD/GPLv2 license.  When using or 
+  redistributing this file, you may do so under either license.
+
+  GPL LICENSE SUMMARY
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify 
+  it under the terms of version 2 of the GNU General Public License as
+  published by the Free Software Foundation.
+
+  This program is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License 
+  along with this program; if not, write to the Free Software 
+  Foundation, Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+  The full GNU General Public License is included in this distribution 
+  in the file called LICENSE.GPL.
+
+  Contact Information:
+
+  Intel Corporation
+  2200 Mission College Blvd.
+  Santa Clara, CA  97052
+
+  BSD LICENSE 
+
+  Copyright(c) 2007-2012 Intel Corporation. All rights reserved.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions 
+  are met:
+
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in 
+      the documentation and/or other materials provided with the 
+      distribution.
+    * Neither the name of Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived 
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Core private definitions.  Shared between the translation units that make
+ * up libplatform_config_core; nothing in here is part of the public API and
+ * none of it is visible to platform_config.h consumers.
+ */
+#ifndef _PLATFORM_CONFIG_CORE_PRIVATE_H_
+#define _PLATFORM_CONFIG_CORE_PRIVATE_H_
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#else
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#endif
+
+#include "platform_config.h"
+
+/* -------------------------------------------------------------------------------- */
+/* OS abstraction: the core is built both into platform_config.ko and into the      */
+/* userspace libplatform_config_core.so                                              */
+/* -------------------------------------------------------------------------------- */
+#ifdef __KERNEL__
+#define CONFIG_ALLOC( size )            kmalloc( (size), GFP_KERNEL )
+#define CONFIG_FREE( ptr )              kfree( ptr )
+/* bucket arrays can run to megabytes, beyond what kmalloc will hand out */
+#define CONFIG_ALLOC_LARGE( size )      vmalloc( size )
+#define CONFIG_FREE_LARGE( ptr )        vfree( ptr )
+
+#define CONFIG_DEFINE_LOCK( name )      static DEFINE_MUTEX( name )
+#define CONFIG_LOCK( name )             mutex_lock( &(name) )
+#define CONFIG_UNLOCK( name )           mutex_unlock( &(name) )
+
+typedef struct task_struct *            config_thread_t;
+#define CONFIG_SELF()                   current
+#define CONFIG_SAME_THREAD( a, b )      ((a) == (b))
+#else
+#define CONFIG_ALLOC( size )            malloc( size )
+#define CONFIG_FREE( ptr )              free( ptr )
+#define CONFIG_ALLOC_LARGE( size )      malloc( size )
+#define CONFIG_FREE_LARGE( ptr )        free( ptr )
+
+#define CONFIG_DEFINE_LOCK( name )      static pthread_mutex_t name = PTHREAD_MUTEX_INITIALIZER
+#define CONFIG_LOCK( name )             pthread_mutex_lock( &(name) )
+#define CONFIG_UNLOCK( name )           pthread_mutex_unlock( &(name) )
+
+typedef pthread_t                       config_thread_t;
+#define CONFIG_SELF()                   pthread_self()
+#define CONFIG_SAME_THREAD( a, b )      pthread_equal( (a), (b) )
+#endif
+
+/* Separator between the components of a dotted node path ("platform.memory.layout") */
+#define CONFIG_PATH_SEPARATOR           '.'
+
+/* -------------------------------------------------------------------------------- */
+/* Name index (config_index.c)                                                       */
+/*                                                                                   */
+/* Maps (parent reference, child name) to the child reference so that path lookups   */
+/* do not depend on the size of the htuple hash table.  The index is a cache: a miss */
+/* falls back to htuple and records the answer.  All calls expect the core lock to   */
+/* be held by the caller.                                                            */
+/* -------------------------------------------------------------------------------- */
+
+/* Create the (empty) index.  Safe to call when already initialized. */
+config_result_t config_index_init( void );
+
+/* Release every index entry and the bucket arrays. */
+void config_index_deinit( void );
+
+/* Locate the direct child of parent called name[0..len). Returns 0 if there is none. */
+config_ref_t config_index_lookup( config_ref_t parent, const char *name, size_t len );
+
+/* Drop every entry that refers to root_ref or any node beneath it. Call before the subtree is deleted. */
+void config_index_forget( config_ref_t root_ref );
+
+/* Drop only the entry leading to child_ref, which has been moved away from its parent. */
+void config_index_unlink( config_ref_t child_ref );
+
+/* The parent child_ref was last looked up under.  Returns 0 if that edge is not indexed. */
+int config_index_parent( config_ref_t child_ref, config_ref_t *parent_ref );
+
+/* Index every edge below root_ref at once: it was empty before a load, so none of them is indexed yet. */
+void config_index_build( config_ref_t root_ref );
+
+/* Snapshot the index geometry and counters. */
+void config_index_get_stats( config_index_stats_t *stats );
+
+/* -------------------------------------------------------------------------------- */
+/* Path resolution (platform_config_core.c)                                          */
+/* -------------------------------------------------------------------------------- */
+
+/* What the caller of config_resolve() does with the node it gets */
+#define CONFIG_RESOLVE_READ             0   /* reads it under the lock */
+#define CONFIG_RESOLVE_WRITE            1   /* modifies it */
+#define CONFIG_RESOLVE_REF              2   /* hands the reference out of the core */
+
+/*
+ * Resolve the first len bytes of a dotted path relative to base_ref.  Writers
+ * resolve with CONFIG_RESOLVE_WRITE so that every node on the way is made
+ * private first (see config_dedup_own()); references handed out are resolved
+ * with CONFIG_RESOLVE_REF so that they name nodes of their own place in the
+ * tree (see config_dedup_unalias()).
+ */
+config_result_t config_resolve( config_ref_t base_ref, const char *path, size_t len, int mode, config_ref_t *node_ref );
+
+/* root_ref and everything beneath it is about to be deleted from htuple: drop whatever the core caches about it. */
+void config_cache_forget( config_ref_t root_ref );
+
+/* The value of node_ref has changed. */
+void config_cache_invalidate( config_ref_t node_ref );
+
+/* -------------------------------------------------------------------------------- */
+/* Reference maps (config_refmap.c)                                                  */
+/* -------------------------------------------------------------------------------- */
+
+typedef struct {
+	config_ref_t	*keys;
+	unsigned long	*vals;
+	unsigned char	*used;
+	unsigned int	size;
+	unsigned int	count;
+} config_refmap_t;
+
+/* A zero-filled config_refmap_t is a valid empty map.  Updating a key already present never fails. */
+config_result_t config_refmap_put( config_refmap_t *m, config_ref_t key, unsigned long val );
+int config_refmap_get( const config_refmap_t *m, config_ref_t key, unsigned long *val );
+/* Make room for n more keys, so that the next n puts cannot fail. */
+config_result_t config_refmap_reserve( config_refmap_t *m, unsigned int n );
+int config_refmap_del( config_refmap_t *m, config_ref_t key );
+/* Iterate: start with *pos = 0; returns 0 when there are no more entries. */
+int config_refmap_next( const config_refmap_t *m, unsigned int *pos, config_ref_t *key, unsigned long *val );
+void config_refmap_free( config_refmap_t *m );
+
+/* -------------------------------------------------------------------------------- */
+/* Tree helpers (config_tree.c)                                                      */
+/* -------------------------------------------------------------------------------- */
+
+/* Longest node name config_tree_add_child() accepts */
+#define CONFIG_TREE_MAX_NAME		255
+
+/* Enumerate children the way the public API presents them. */
+config_ref_t config_tree_first_child( config_ref_t node_ref );
+config_ref_t config_tree_next_sibling( config_ref_t node_ref );
+
+/* Find or create the (valueless) child node name[0..len) of parent_ref. Returns 0 on failure. */
+config_ref_t config_tree_add_child( config_ref_t parent_ref, const char *name, size_t len );
+
+/* Number of nodes beneath node_ref, node_ref itself excluded. */
+unsigned int config_tree_count( config_ref_t node_ref );
+
+/* Copy the children of src_ref (names, values and subtrees) into dst_ref. Returns the number of nodes written. */
+unsigned int config_tree_copy( config_ref_t dst_ref, config_ref_t src_ref );
+
+/* Write the htuple children of src_ref into dst_ref as a load would, claiming each name first. */
+config_result_t config_tree_merge( config_ref_t dst_ref, config_ref_t src_ref );
+
+/* -------------------------------------------------------------------------------- */
+/* Subtree deduplication (config_dedup.c)                                            */
+/* -------------------------------------------------------------------------------- */
+
+/* The node whose children node_ref presents: the staged root it forwards to, then its canonical copy if that is an alias, else itself. */
+config_ref_t config_dedup_redirect( config_ref_t node_ref );
+
+/* About to modify node_ref or its subtree: break any sharing first. Returns node_ref, or the staged root it forwards to. */
+config_ref_t config_dedup_own( config_ref_t node_ref );
+
+/* A reference to a child of node_ref is about to leave the core: give node_ref its own children if it is an alias. */
+void config_dedup_unalias( config_ref_t node_ref );
+
+/* root_ref and its subtree are about to be deleted. */
+void config_dedup_forget( config_ref_t root_ref );
+
+/* base_ref has just been loaded into: share what duplicates existing subtrees. */
+void config_dedup_loaded( config_ref_t base_ref );
+
+/* Non-zero while any subtree is shared. */
+int config_dedup_active( void );
+
+void config_dedup_set_enabled( int enable );
+void config_dedup_get_stats( config_dedup_stats_t *stats );
+void config_dedup_deinit( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Packed integer arrays (config_array.c)                                            */
+/* -------------------------------------------------------------------------------- */
+
+/* First byte of the string htuple stores an array as; a loaded string may not start with it */
+#define CONFIG_ARRAY_TAG                '\x1f'
+
+/*
+ * Rewrite every "name = [ 1, 0x2, ... ]" list in data[0..len) into the tagged
+ * string value htuple stores it as, and count them in *lists.  *out is NULL
+ * when data holds no list; otherwise it is a NUL-terminated copy the caller
+ * frees with CONFIG_FREE().
+ */
+config_result_t config_array_rewrite( const char *data, size_t len, char **out, size_t *out_len, unsigned int *lists );
+
+/* Rewritten text holding lists lists has been parsed into the new nodes below root_ref: record which are arrays. */
+config_result_t config_array_loaded( config_ref_t root_ref, unsigned int lists );
+
+/* Parse one decimal or 0x-prefixed integer, optionally signed, spanning exactly text[0..len). Returns 0 if it is not one. */
+int config_array_parse_int( const char *text, size_t len, int *val );
+
+/* Non-zero if node_ref holds an array value. */
+int config_array_is( config_ref_t node_ref );
+/* Non-zero while any node does. */
+int config_array_present( void );
+
+/* A value has just been written to the child name[0..len) of parent_ref: record whether it is an array. */
+config_result_t config_array_mark( config_ref_t parent_ref, const char *name, size_t len, int is_array );
+
+/* Decoded elements of node_ref's array value.  *values stays valid until the node changes. */
+config_result_t config_array_get( config_ref_t node_ref, const int **values, unsigned int *count );
+
+/* node_ref's array as list text ("[1,2]"), NULL if it holds none. */
+const char *config_array_list( config_ref_t node_ref );
+
+/* node_ref's value has changed: it is no longer an array. */
+void config_array_invalidate( config_ref_t node_ref );
+/* Drop the decoded arrays below root_ref, which keep their type. */
+void config_array_forget( config_ref_t root_ref );
+/* root_ref and its subtree are being deleted from htuple. */
+void config_array_deleted( config_ref_t root_ref );
+/* Drop every decoded array. */
+void config_array_flush( void );
+void config_array_deinit( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Cross-type scalar reads (config_value.c)                                          */
+/* -------------------------------------------------------------------------------- */
+
+/* node_ref's int value, or its string value if that is a number.  Converted once per value. */
+config_result_t config_value_int( config_ref_t node_ref, int *val );
+
+/* node_ref's string value, or the decimal form of its int value.  *str stays valid until the node changes. */
+config_result_t config_value_str( config_ref_t node_ref, const char **str );
+
+void config_value_invalidate( config_ref_t node_ref );
+void config_value_forget( config_ref_t root_ref );
+void config_value_flush( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Positional child access (config_children.c)                                       */
+/* -------------------------------------------------------------------------------- */
+
+/* Number of children node_ref presents. */
+unsigned int config_children_count( config_ref_t node_ref );
+
+/* The index-th child node_ref presents, counting from 0.  Returns 0 past the end. */
+config_ref_t config_children_at( config_ref_t node_ref, unsigned int index );
+
+/* node_ref's children may have changed. */
+void config_children_invalidate( config_ref_t node_ref );
+/* Drop every child vector. */
+void config_children_flush( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Overlay layers (config_overlay.c)                                                 */
+/*                                                                                   */
+/* With no layer pushed every call below returns its argument (or the plain htuple   */
+/* answer) and costs one test.                                                       */
+/* -------------------------------------------------------------------------------- */
+
+/* The node that currently presents node_ref's path in the merged view. */
+config_ref_t config_overlay_top( config_ref_t node_ref );
+
+/* Merged lookup of the child name[0..len) of parent_ref, a node returned by config_overlay_top(). */
+config_ref_t config_overlay_child( config_ref_t parent_ref, const char *name, size_t len );
+
+/* The node a write to node_ref's path must modify, creating the path in the top layer if need be. */
+config_ref_t config_overlay_own( config_ref_t node_ref );
+
+/* Same, for child_ref (a merged child) of the already owned parent_ref.  Returns 0 on failure. */
+config_ref_t config_overlay_own_child( config_ref_t parent_ref, config_ref_t child_ref );
+
+/* Enumerate the merged view. */
+config_ref_t config_overlay_first_child( config_ref_t node_ref );
+config_ref_t config_overlay_next_sibling( config_ref_t node_ref );
+
+/* Non-zero while any layer is pushed or any namespace exists. */
+int config_overlay_active( void );
+
+/* Nodes may have been added: forget what was memoized about the tree's shape. */
+void config_overlay_changed( void );
+void config_overlay_forget( config_ref_t root_ref );
+void config_overlay_deinit( void );
+
+config_result_t config_overlay_push_layer( const char *name, config_ref_t *layer_ref );
+config_result_t config_overlay_find_layer( const char *name, config_ref_t *layer_ref );
+config_result_t config_overlay_drop_layer( const char *name );
+
+/* Make the shared view (0) or namespace ns the one all calls above see.  Returns ns, or 0 if it does not exist. */
+unsigned int config_overlay_view( unsigned int ns );
+
+/* Namespaces: private layers above all shared ones.  ns_root() returns 0 for an unknown ns. */
+config_result_t config_overlay_ns_create( unsigned int *ns );
+config_result_t config_overlay_ns_destroy( unsigned int ns );
+config_ref_t config_overlay_ns_root( unsigned int ns );
+/* Swap in a new, empty root for ns, retiring the old one. */
+config_result_t config_overlay_ns_reset( unsigned int ns );
+/* Non-zero if node_ref was written in the current view's namespace. */
+int config_overlay_ns_private( config_ref_t node_ref );
+
+/* Non-zero for the database node holding the layer and namespace roots. */
+int config_overlay_internal( config_ref_t node_ref );
+/* Non-zero for that node, a layer root or a namespace root. */
+int config_overlay_root( config_ref_t node_ref );
+
+/* -------------------------------------------------------------------------------- */
+/* Staged trees (config_stage.c)                                                     */
+/* -------------------------------------------------------------------------------- */
+
+/* Create a new, empty staged tree under the hidden holder. */
+config_result_t config_stage_new( config_ref_t *stage_ref );
+/* Non-zero if stage_ref was prepared and not yet published or discarded. */
+int config_stage_prepared( config_ref_t stage_ref );
+/* Non-zero if stage_ref may be published to node_ref: not into itself or a holder. */
+int config_stage_valid( config_ref_t node_ref, config_ref_t stage_ref );
+/* Retire the children of node_ref (or the tree it forwarded to) and forward it to stage_ref. */
+config_result_t config_stage_swap( config_ref_t node_ref, config_ref_t stage_ref );
+/* The staged root node_ref forwards to, or node_ref itself. */
+config_ref_t config_stage_forward( config_ref_t node_ref );
+/* The node forwarding to node_ref, or 0 if none does. */
+config_ref_t config_stage_base( config_ref_t node_ref );
+/* Non-zero for the database node holding the staged roots. */
+int config_stage_internal( config_ref_t node_ref );
+/* Non-zero for the holder and for moved content, which enumeration and lookups skip where htuple keeps it. */
+int config_stage_hidden( config_ref_t node_ref );
+/* Non-zero while any moved content is hidden below its old parent. */
+int config_stage_hiding( void );
+/* Refuse moving src_ref to name[0..len) below parent_ref (both forwarded) if it is not a plain rename, else free the name. */
+config_result_t config_stage_check_move( config_ref_t src_ref, config_ref_t parent_ref, const char *name, size_t len );
+/* Create name[0..len) below parent_ref and forward it to what src_ref holds, hiding src_ref where it was. */
+config_result_t config_stage_move( config_ref_t src_ref, config_ref_t parent_ref, const char *name, size_t len, config_ref_t *dst_ref );
+/* Copy hidden moved content node_ref out from below its old parent and retire it, freeing its name there. */
+config_result_t config_stage_evict( config_ref_t node_ref );
+/* Delete a tree from config_stage_new() that was never handed out. */
+void config_stage_discard( config_ref_t stage_ref );
+void config_stage_forget( config_ref_t root_ref );
+void config_stage_deinit( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Wildcard queries and aggregates (config_query.c)                                  */
+/* -------------------------------------------------------------------------------- */
+
+/* config_query() and config_aggregate() without the lock. */
+config_result_t config_query_run( config_ref_t base_ref, const char *pattern, const config_query_pred_t *pred,
+                                  config_query_result_t *results, unsigned int max, unsigned int *count );
+config_result_t config_aggregate_run( config_ref_t base_ref, const char *child_key, config_aggregate_op_t op, long long *result );
+
+/* -------------------------------------------------------------------------------- */
+/* Physical address index over the memory layout (config_layout.c)                   */
+/* -------------------------------------------------------------------------------- */
+
+/* config_layout_lookup_pa() without the lock. */
+config_result_t config_layout_lookup( unsigned long pa, config_ref_t *node_ref, unsigned long *offset );
+
+/* A set through parent_ref/leaf has succeeded. */
+void config_layout_value_changed( config_ref_t parent_ref, const char *leaf );
+
+/* The layout may have changed in a way config_layout_value_changed() is not told about. */
+void config_layout_invalidate( void );
+void config_layout_deinit( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Merkle subtree hashes (config_hash.c)                                             */
+/* -------------------------------------------------------------------------------- */
+
+unsigned long long config_hash_subtree( config_ref_t node_ref );
+
+/* config_subtree_diff() without the lock. */
+void config_hash_diff( config_ref_t a_ref, config_ref_t b_ref, config_diff_t *diffs, unsigned int max, unsigned int *count );
+
+/* A set through parent_ref has succeeded; node_ref is the node written, if it existed before (else 0). */
+void config_hash_value_changed( config_ref_t parent_ref, config_ref_t node_ref );
+
+/* node_ref (moved content) now hangs below parent_ref instead of where it was hashed. */
+void config_hash_moved( config_ref_t node_ref, config_ref_t parent_ref );
+
+/* Drop every cached hash. */
+void config_hash_flush( void );
+
+/* -------------------------------------------------------------------------------- */
+/* Deferred reclamation of removed subtrees (config_epoch.c)                         */
+/* -------------------------------------------------------------------------------- */
+
+/* config_epoch_enter() and config_epoch_exit() without the lock. */
+unsigned int config_epoch_pin( void );
+config_result_t config_epoch_unpin( unsigned int epoch );
+
+/* Hide the subtree at root_ref now and delete it once no reader can still hold references into it. */
+config_result_t config_epoch_retire( config_ref_t root_ref );
+
+/* Non-zero if node_ref is the root of a retired subtree. */
+int config_epoch_retired( config_ref_t node_ref );
+
+/* A write is about to create name[0..len) (possibly dotted) under parent_ref: free every component held by a retired or moved-away node. */
+config_result_t config_epoch_claim( config_ref_t parent_ref, const char *name, size_t len );
+
+/* Delete what no reader can still see; non-zero if retired subtrees are left. */
+int config_epoch_lingering( void );
+
+void config_epoch_deinit( void );
+
+/* -------------------------------------------------------------------------------- */
+/* JSON import and export (config_json.c)                                            */
+/* -------------------------------------------------------------------------------- */
+
+/* Insert the members of the JSON object json[0..len) beneath target_ref. */
+config_result_t config_json_import( config_ref_t target_ref, const char *json, size_t len );
+
+/* config_export_json() without the lock. */
+config_result_t config_json_export( config_ref_t node_ref, char *buf, size_t bufsize, size_t *len );
+
+/* Non-zero if name[0..len) is a name JSON members may have: letters, digits, '_' and '-'. */
+int config_json_name_ok( const char *name, size_t len );
+
+/* -------------------------------------------------------------------------------- */
+/* Flat "dotted.path = value" updates (config_flat.c)                                */
+/* -------------------------------------------------------------------------------- */
+
+/* Ancestors config_load_flat() remembers between consecutive paths; deeper ones are looked up every time */
+#define CONFIG_FLAT_MAX_DEPTH		16
+
+/* One "path = value" line; path and str are NUL-terminated. */
+typedef struct {
+	const char	*path;
+	const char	*str;			/* NULL for an integer value */
+	size_t		str_len;
+	int			val;
+} config_flat_entry_t;
+
+typedef struct {
+	config_flat_entry_t	*entries;		/* sorted by path, file order kept among equal paths */
+	unsigned int		count;
+	char				*text;			/* backing store for the paths and strings */
+} config_flat_batch_t;
+
+/* Parse data[0..len) into batch.  Nothing is allocated on failure. */
+config_result_t config_flat_parse( const char *data, size_t len, config_flat_batch_t *batch );
+void config_flat_free( config_flat_batch_t *batch );
+
+/* Stable merge sort of e[0..n) by path, using tmp[0..n) as scratch. */
+void config_flat_sort( config_flat_entry_t *e, config_flat_entry_t *tmp, unsigned int n );
+
+/* -------------------------------------------------------------------------------- */
+/* Mutation journal (config_journal.c)                                               */
+/* -------------------------------------------------------------------------------- */
+
+/* Longest path a journal record can name; longer ones stop the journal */
+#define CONFIG_JOURNAL_MAX_PATH		1023
+
+typedef enum {
+	CONFIG_JOURNAL_SETS			= 0,	/* batch entry for a run of coalesced sets; never recorded */
+	CONFIG_JOURNAL_SET_INT		= 1,
+	CONFIG_JOURNAL_SET_STR,
+	CONFIG_JOURNAL_LOAD,				/* data is config_load() text */
+	CONFIG_JOURNAL_LOAD_JSON,			/* data is config_load_json() text */
+	CONFIG_JOURNAL_REMOVE
+} config_journal_op_t;
+
+/* One step of a replay. */
+typedef struct {
+	config_journal_op_t	op;
+	const char			*path;			/* target, from the root of the database ("" for the root) */
+	const char			*data;			/* loads: the text to load */
+	size_t				data_len;
+	unsigned int		first, sets;	/* CONFIG_JOURNAL_SETS: the run in config_journal_batch_t.sets */
+} config_journal_entry_t;
+
+typedef struct {
+	config_journal_entry_t	*entries;
+	unsigned int			count;
+	config_flat_entry_t		*sets;		/* each run one set per path, in first-set order; paths are from the root */
+	unsigned int			set_count;
+} config_journal_batch_t;
+
+/* config_journal_start() and config_journal_save() without the lock. */
+config_result_t config_journal_start_run( size_t size );
+int config_journal_active( void );
+
+/* A change to node_ref[.name] has been committed.  data is the int for a set_int, the string or text otherwise. */
+void config_journal_record( config_journal_op_t op, config_ref_t node_ref, const char *name, const void *data, size_t data_len );
+
+/* The array list ("[1,2]") has been written to node_ref.name: record it as the load that recreates it. */
+void config_journal_record_array( config_ref_t node_ref, const char *name, const char *list );
+
+/* A removal of node_ref is about to be tried: work out its path while it still has one. */
+void config_journal_hold( config_journal_op_t op, config_ref_t node_ref );
+/* The removal held by config_journal_hold() succeeded: record it. */
+void config_journal_commit( void );
+
+/* Nodes may have been removed: forget remembered paths. */
+void config_journal_forget( void );
+
+config_result_t config_journal_save_run( char *buf, size_t bufsize, size_t *len );
+
+/* Check and coalesce a saved image.  The batch points into data.  Nothing is allocated on failure. */
+config_result_t config_journal_parse( const char *data, size_t len, config_journal_batch_t *batch );
+void config_journal_free( config_journal_batch_t *batch );
+void config_journal_deinit( void );
+
+#ifndef __KERNEL__
+/* -------------------------------------------------------------------------------- */
+/* Parallel traversal (config_walk.c, userspace only)                                */
+/* -------------------------------------------------------------------------------- */
+
+/* The subtree of base_ref in pre-order, with depths below base_ref.  Call with the lock held; free() both arrays. */
+config_result_t config_walk_flatten( config_ref_t base_ref, config_ref_t **refs, unsigned int **depths, unsigned int *count );
+
+/* Visit refs[0..count) on nthreads threads.  Call without the lock. */
+config_result_t config_walk_run( config_ref_t *refs, unsigned int *depths, unsigned int count,
+                                 config_walk_visitor_t visitor, void *ctx, unsigned int nthreads,
+                                 char **output, size_t *output_len );
+#endif
+
+#endif /* _PLATFORM_CONFIG_CORE_PRIVATE_H_ */
@@ -75,9 +75,72 @@ typedef enum {
 
 typedef unsigned int config_ref_t;
 
+/** Number of chain-length buckets in config_index_stats_t::chain_histogram */
+#define CONFIG_INDEX_HISTOGRAM_SIZE	8
+
+/**
+ * Health of the core name index, as returned by config_index_stats().
+ * Ratios are fixed point (x100) so the structure is usable from the kernel.
+ */
+typedef struct {
+	unsigned int	buckets;		/**< buckets in the active table(s) */
+	unsigned int	entries;		/**< live (parent, name) entries */
+	unsigned int	load_factor;	/**< entries per bucket, x100 */
+	unsigned int	tombstones;		/**< entries removed by config_private_tree_remove() but not yet reclaimed */
+	unsigned int	max_chain;		/**< longest bucket chain at the time of the call */
+	unsigned int	max_probe;		/**< most entries compared by a single lookup since initialization */
+	unsigned int	rehashing;		/**< non-zero while an incremental resize is in progress */
+	unsigned int	lookups;		/**< lookups since initialization */
+	unsigned int	misses;			/**< lookups that had to be answered by the backing store */
+	unsigned int	rekeys;			/**< times an overlong bucket made the index draw a new hash key */
+	unsigned int	chain_histogram[CONFIG_INDEX_HISTOGRAM_SIZE]; /**< buckets holding 0,1,2... entries; the last slot counts all longer chains */
+} config_index_stats_t;
+
+/** Most overlay layers that can be stacked above the database */
+#define CONFIG_OVERLAY_MAX_LAYERS	8
+
+/** Longest overlay layer name */
+#define CONFIG_OVERLAY_MAX_NAME		31
+
+/** Most namespaces that can exist at once */
+#define CONFIG_NAMESPACE_MAX		32
+
+/** Most fields one config_bind_struct() call can describe (one bit each in its presence bitmap) */
+#define CONFIG_BIND_MAX_FIELDS		32
+
+/** How config_bind_struct() stores a field */
+typedef enum {
+	CONFIG_BIND_INT,				/**< int, from an integer node (or a numeric string) */
+	CONFIG_BIND_STR,				/**< char[size], from a string node (or an integer's decimal form), always NUL-terminated */
+} config_bind_type_t;
+
+/**
+ * One field of a structure filled by config_bind_struct().  Tables are
+ * normally static and built with CONFIG_BIND_INT_FIELD() and
+ * CONFIG_BIND_STR_FIELD().
+ */
+typedef struct {
+	const char *		name;			/**< node name relative to the base node, may be dotted */
+	config_bind_type_t	type;
+	size_t				offset;			/**< offsetof() the field in the structure */
+	size_t				size;			/**< sizeof() the field */
+	int					default_int;	/**< stored when a CONFIG_BIND_INT node is absent */
+	const char *		default_str;	/**< stored when a CONFIG_BIND_STR node is absent; NULL leaves the field untouched */
+} config_bind_desc_t;
+
+/** Describe int member field of struct type s, read from node name */
+#define CONFIG_BIND_INT_FIELD( s, field, name, def ) \
+	{ (name), CONFIG_BIND_INT, offsetof( s, field ), sizeof( ((s *) 0)->field ), (def), NULL }
+
+/** Describe char array member field of struct type s, read from node name */
+#define CONFIG_BIND_STR_FIELD( s, field, name, def ) \
+	{ (name), CONFIG_BIND_STR, offsetof( s, field ), sizeof( ((s *) 0)->field ), 0, (def) }
+
 /**
  * Start at the specified reference node, locate the sub-node with the
  * specified name, and return the integer value associated with that name.
+ * A string value that is a decimal or 0x-prefixed number reads as that
+ * number.
  * @param[in] base_ref       based node reference 
  * @param[in] name           node name            
  * @param[out] val       return value
@@ -89,6 +152,7 @@ config_result_t config_get_int(
 /**
  * Start at the specified reference node, locate the sub-node with the
  * specified name, and return the string value associated with that name.
+ * An integer value reads as its decimal form.
  * @param[in] base_ref       based node reference 
  * @param[in] name           node name            
  * @param[out] string        attribute content 
@@ -99,6 +163,72 @@ config_result_t config_get_str(
             const char *    name,
             char *          string,
             size_t          bufsize ); 
+/**
+ * Start at the specified reference node, locate the sub-node with the
+ * specified name, and copy out the integer array associated with that name.
+ * Arrays are written in the configuration data as a bracketed list,
+ * e.g. <tt>gains = [ 0x10, 0x20, -3 ]</tt>.  Elements are 32-bit integers,
+ * like int values; there are no 64-bit arrays.  A string value is never
+ * an array, whatever its text, and an array is not a string: setting any
+ * other value replaces it, and config_get_str() does not return it.  A
+ * string in configuration data may not start with the byte 0x1f.
+ * @param[in] base_ref       based node reference 
+ * @param[in] name           node name            
+ * @param[out] values        element buffer
+ * @param[in] max            number of elements values can hold
+ * @param[out] count         number of elements in the array; more than max
+ *                           when values was too small to hold them all
+ */
+config_result_t config_get_int_array(
+            config_ref_t    base_ref,
+            const char *    name,
+            int *           values,
+            unsigned int    max,
+            unsigned int *  count );
+/**
+ * Start at the specified reference node, locate the sub-node with the
+ * specified name, and return one element of the integer array associated
+ * with that name.  Returns CONFIG_ERR_NOT_FOUND if index is out of range.
+ * @param[in] base_ref       based node reference 
+ * @param[in] name           node name            
+ * @param[in] index          element index, from 0
+ * @param[out] val           return value
+ */
+config_result_t config_get_int_array_elem(
+            config_ref_t    base_ref,
+            const char *    name,
+            unsigned int    index,
+            int *           val );
+
+/**
+ * Start at the specified reference node and fill a whole structure from
+ * the sub-nodes named by a descriptor table, in one call.  Fields whose
+ * node is missing, or holds the wrong type of value, get the descriptor's
+ * default.
+ *
+ * \code
+ * static const config_bind_desc_t sven_desc[] = {
+ *     CONFIG_BIND_INT_FIELD( sven_cfg_t, dismask,     "dismask",     0 ),
+ *     CONFIG_BIND_INT_FIELD( sven_cfg_t, debug_level, "debug_level", 1 ),
+ *     CONFIG_BIND_INT_FIELD( sven_cfg_t, num_bufs,    "num_bufs",    4 ),
+ * };
+ * config_node_find( ROOT_NODE, CONFIG_PATH_DRIVER_SVEN, &sven );
+ * config_bind_struct( sven, sven_desc, 3, &cfg, &present );
+ * \endcode
+ *
+ * @param[in] base_ref       based node reference 
+ * @param[in] desc           field descriptors
+ * @param[in] count          number of descriptors, at most CONFIG_BIND_MAX_FIELDS
+ * @param[out] out           structure to fill
+ * @param[out] present       bit i set if desc[i] was read from the database
+ *                           rather than defaulted (may be NULL)
+ */
+config_result_t config_bind_struct(
+            config_ref_t                base_ref,
+            const config_bind_desc_t *  desc,
+            unsigned int                count,
+            void *                      out,
+            unsigned int *              present );
 
 /** 
  * Start at the specified reference node, locate or create the sub-node with
@@ -162,6 +292,36 @@ config_result_t config_node_next_sibling(
             config_ref_t    node_ref,
             config_ref_t *  child_ref );
 
+/**
+ * Return the number of children of the specified reference node, in the
+ * order config_node_first_child() and config_node_next_sibling() visit
+ * them.  The first call on a node builds a vector of its children, so
+ * this and config_node_child_at() take constant time until the node's
+ * children change.  A reference that names no node fails with
+ * CONFIG_ERR_INVALID_REFERENCE.
+ *
+ * @param[in] node_ref       target node reference
+ * @param[out] count         number of children
+ */
+config_result_t config_node_child_count(
+            config_ref_t    node_ref,
+            unsigned int *  count );
+
+/**
+ * Find the child at the specified position (0 for the first) under the
+ * specified reference node, and return a reference to that child.  Fails
+ * with CONFIG_ERR_NOT_FOUND past the last child.  While overlays or
+ * namespaces exist this walks the children instead.
+ *
+ * @param[in] node_ref       target node reference
+ * @param[in] index          position of the child
+ * @param[out] child_ref     return child reference
+ */
+config_result_t config_node_child_at(
+            config_ref_t    node_ref,
+            unsigned int    index,
+            config_ref_t *  child_ref );
+
 /**
  * Return the name of the specified reference node. 
  * @param[in] node_ref       based node reference 
@@ -175,6 +335,7 @@ config_result_t config_node_get_name(
 
 /**
  * Return the string value associated with the specified reference node.
+ * An integer value reads as its decimal form.
  *
  * @param[in] node_ref       based node reference 
  * @param[in] string         get the node string by name            
@@ -188,6 +349,8 @@ config_result_t config_node_get_str(
 
 /**
  * Return the integer value associated with the specified reference node. 
+ * A string value that is a decimal or 0x-prefixed number reads as that
+ * number.
  *
  * @param[in] node_ref       based node reference 
  * @param[in] val           return the integer value           
@@ -211,14 +374,567 @@ config_result_t config_load(
             size_t          datalength );
 
 /**
- * Parse the specified string of configuration data and insert it into the
- * dictionary at the specified reference node.
+ * Remove the subtree rooted at the specified reference node.  The subtree
+ * disappears from every lookup and enumeration at once, but its nodes are
+ * only deleted once no caller inside config_epoch_enter() could still hold
+ * a reference into it.  A write or load that recreates the removed name
+ * before then gets the node back without children (readers keep the old
+ * ones) but with the value it had, until that is written too.  Fails with
+ * CONFIG_ERR_NO_RESOURCES, removing nothing, if memory runs out.
  * @param[in] base_ref       based node reference 
  */
 config_result_t config_private_tree_remove( 
 			config_ref_t 	base_ref );
 
+/**
+ * Move the subtree rooted at src_ref below new_parent_ref, under the name
+ * new_name, taking src_ref's own value along.  The subtree is not copied,
+ * so the cost does not depend on its size.  References to nodes below
+ * src_ref stay valid; src_ref itself keeps naming the moved subtree but
+ * still reports its old name, so look the node up again by its new path
+ * for a reference to it in its new place.  The first later write or load
+ * that reuses the old name (or removes its old parent) pays for copying
+ * the subtree out of the way.  Fails if new_name is taken, holds anything
+ * but letters, digits, '_' and '-', or lies inside the subtree, and while
+ * overlays, namespaces or shared subtrees (config_dedup_enable()) exist.
+ * @param[in] src_ref        root of the subtree to move
+ * @param[in] new_parent_ref node to move it below
+ * @param[in] new_name       single name component for it there
+ */
+config_result_t config_node_move(
+            config_ref_t    src_ref,
+            config_ref_t    new_parent_ref,
+            const char *    new_name );
+
+/**
+ * Start using node references across calls.  Every reference taken after
+ * this call stays valid (it keeps naming the same node, not a recycled one)
+ * until the matching config_epoch_exit(), even if the node is removed in
+ * the meantime.  Keep these sections short: nodes removed while any is open
+ * are not deleted until it closes.  Core API only (kernel callers and the
+ * userspace core library).
+ *
+ * @param[out] epoch         ticket to hand to config_epoch_exit()
+ */
+config_result_t config_epoch_enter(
+            unsigned int *  epoch );
+
+/**
+ * End a section opened by config_epoch_enter().
+ *
+ * @param[in] epoch          the ticket config_epoch_enter() returned
+ */
+config_result_t config_epoch_exit(
+            unsigned int    epoch );
+
+
+
+
+/**
+ * Report the bucket count, load factor, chain lengths and tombstone count of
+ * the core name index.  Intended for diagnosing slow lookups.
+ *
+ * @param[out] stats         filled in with the current index statistics
+ */
+config_result_t config_index_stats(
+            config_index_stats_t * stats );
+
+
+/**
+ * Subtree deduplication state, as returned by config_dedup_stats().
+ */
+typedef struct {
+	unsigned int	enabled;		/**< non-zero if loads are being deduplicated */
+	unsigned int	canonical;		/**< subtrees currently shared by one or more aliases */
+	unsigned int	aliases;		/**< nodes whose children are a reference to a canonical subtree */
+	unsigned int	nodes_saved;	/**< nodes released by sharing */
+	unsigned int	copies;			/**< copy-on-write splits performed */
+} config_dedup_stats_t;
+
+/**
+ * Turn subtree deduplication on or off.  While it is on, each config_load()
+ * shares subtrees that are identical to ones already in the database instead
+ * of storing them again.  Shared subtrees are split again (copy-on-write)
+ * when either copy is written, and a copy is also given its own nodes as
+ * soon as a reference below it is handed out (config_node_find(),
+ * enumeration, config_query() results, config_walk_parallel()), so node
+ * references always name one place in the tree.  Turning deduplication off
+ * does not split subtrees that are already shared.
+ *
+ * @param[in] enable         non-zero to deduplicate subsequent loads
+ */
+config_result_t config_dedup_enable(
+            int             enable );
+
+/**
+ * Report how much subtree deduplication is saving.
+ *
+ * @param[out] stats         filled in with the current deduplication state
+ */
+config_result_t config_dedup_stats(
+            config_dedup_stats_t * stats );
+
+/**
+ * Stack a new, empty overlay layer above the database (and any layers
+ * already pushed).  Load the layer's content with config_load() on the
+ * returned layer_ref.
+ *
+ * Lookups from ROOT_NODE, and from any reference obtained through it,
+ * search the layers top-down and return the first hit; enumeration shows
+ * each name once, from the highest layer that has it; writes through
+ * ROOT_NODE go to the top layer.  Nothing is copied between layers.
+ *
+ * @param[in] name           layer name, at most CONFIG_OVERLAY_MAX_NAME characters
+ * @param[out] layer_ref     root node of the new layer (may be NULL)
+ */
+config_result_t config_overlay_push(
+            const char *    name,
+            config_ref_t *  layer_ref );
+
+/**
+ * Remove an overlay layer, wherever it is in the stack, together with
+ * everything loaded into or written to it.
+ *
+ * @param[in] name           layer name
+ */
+config_result_t config_overlay_drop(
+            const char *    name );
+
+/**
+ * Return the root node of an overlay layer.
+ *
+ * @param[in] name           layer name
+ * @param[out] layer_ref     root node of the layer
+ */
+config_result_t config_overlay_find(
+            const char *    name,
+            config_ref_t *  layer_ref );
+
+/**
+ * Create a private namespace: a layer above the database and all overlay
+ * layers that only threads bound to it with config_namespace_bind() see.
+ * Their reads fall through to the shared tree for anything the namespace
+ * has not written; their writes stay in the namespace until
+ * config_namespace_publish().  Other threads never see them.
+ *
+ * A namespace can only hold additions and changes: shared nodes cannot be
+ * removed through it.
+ *
+ * @param[out] ns            namespace id, never 0
+ */
+config_result_t config_namespace_create(
+            unsigned int *  ns );
+
+/**
+ * Discard a namespace and everything written to it.  Threads still bound
+ * to it return to the shared view.
+ *
+ * @param[in] ns             namespace id
+ */
+config_result_t config_namespace_destroy(
+            unsigned int    ns );
+
+/**
+ * Make every call the calling thread makes from now on see namespace ns.
+ * Node references taken in one view must not be used in another.  Core API
+ * only: through the driver each open file descriptor has at most one
+ * namespace, created with config_namespace_create() and seen by every call
+ * made on that descriptor.
+ *
+ * @param[in] ns             namespace id, or 0 for the shared view
+ */
+config_result_t config_namespace_bind(
+            unsigned int    ns );
+
+/**
+ * Write everything in a namespace to the shared tree, where other threads
+ * see it, and leave the namespace empty.  The writes go where a shared
+ * write would (the top overlay layer, if any).  If this fails part of the
+ * namespace may already be published; the namespace is kept as it was.
+ *
+ * @param[in] ns             namespace id
+ */
+config_result_t config_namespace_publish(
+            unsigned int    ns );
+
+/**
+ * Create an empty tree, off the live database, to build a replacement for
+ * part (or all) of it in.  Fill it with config_load(), config_load_json(),
+ * config_set_int() and the like on stage_ref; nobody else sees it until
+ * config_stage_publish().  Discard it unpublished with
+ * config_private_tree_remove( stage_ref ).
+ *
+ * @param[out] stage_ref     root node of the new tree
+ */
+config_result_t config_stage_prepare(
+            config_ref_t *  stage_ref );
+
+/**
+ * Replace everything below base_ref with the tree built under stage_ref,
+ * in one step: a reader sees either the old children of base_ref or the
+ * new ones, never a mix.  base_ref keeps its own name and value.  Nothing
+ * is copied; from now on lookups, enumeration and writes through base_ref
+ * use the published tree.  The old children are removed as by
+ * config_private_tree_remove(), so references to them stay valid inside a
+ * config_epoch_enter() section and they are deleted once those readers
+ * are gone.  stage_ref cannot be published twice.
+ *
+ * @param[in] base_ref       node whose children are replaced (ROOT_NODE for the whole database)
+ * @param[in] stage_ref      root returned by config_stage_prepare()
+ */
+config_result_t config_stage_publish(
+            config_ref_t    base_ref,
+            config_ref_t    stage_ref );
+
+/** Most components a config_query() pattern may have */
+#define CONFIG_QUERY_MAX_DEPTH		16
+
+/**
+ * Comparison a config_query() predicate applies to an integer value.
+ */
+typedef enum {
+	CONFIG_QUERY_ANY			= 0,	/**< no test: every match is returned */
+	CONFIG_QUERY_EQ,
+	CONFIG_QUERY_NE,
+	CONFIG_QUERY_LT,
+	CONFIG_QUERY_LE,
+	CONFIG_QUERY_GT,
+	CONFIG_QUERY_GE
+} config_query_op_t;
+
+/**
+ * Filter for config_query(): a match is returned only if the integer node
+ * key (relative to the match, or the match itself when key is NULL or "")
+ * exists and compares to value as op says.  Values are read as by
+ * config_get_int(), so a numeric string counts as its number.
+ */
+typedef struct {
+	const char *		key;
+	config_query_op_t	op;
+	int					value;
+} config_query_pred_t;
+
+/**
+ * One config_query() match.
+ */
+typedef struct {
+	config_ref_t	node_ref;	/**< the matching node */
+	int				value;		/**< its integer value, 0 if it has none */
+	int				has_value;	/**< non-zero if the node has an integer value, or a numeric string */
+} config_query_result_t;
+
+/**
+ * Start at the specified reference node and return every node whose path
+ * matches pattern, in one call.  Pattern components are separated by '.'
+ * and are either a node name, "*" (any one child) or "**" (any number of
+ * levels, including none):
+ *
+ * \code
+ * config_query( ROOT_NODE, "platform.memory.layout.*.size", NULL, r, 32, &n );
+ * pred.key = "pmr"; pred.op = CONFIG_QUERY_EQ; pred.value = 6;
+ * config_query( ROOT_NODE, "platform.memory.layout.*", &pred, r, 32, &n );
+ * \endcode
+ *
+ * Matches are returned in tree order, each node at most once.
+ *
+ * @param[in] base_ref       based node reference
+ * @param[in] pattern        path pattern, at most CONFIG_QUERY_MAX_DEPTH components
+ * @param[in] pred           filter applied to each match (may be NULL)
+ * @param[out] results       buffer for up to max matches
+ * @param[in] max            number of entries results can hold
+ * @param[out] count         number of matches; more than max when results
+ *                           was too small to hold them all
+ */
+config_result_t config_query(
+            config_ref_t    base_ref,
+            const char *    pattern,
+            const config_query_pred_t * pred,
+            config_query_result_t * results,
+            unsigned int    max,
+            unsigned int *  count );
+
+/**
+ * Reduction config_aggregate() applies.
+ */
+typedef enum {
+	CONFIG_AGGREGATE_SUM		= 0,
+	CONFIG_AGGREGATE_MIN,
+	CONFIG_AGGREGATE_MAX,
+	CONFIG_AGGREGATE_COUNT,		/**< number of children that have the value */
+	CONFIG_AGGREGATE_OR			/**< bitwise OR */
+} config_aggregate_op_t;
+
+/**
+ * Reduce an integer value across the children of the specified reference
+ * node in one pass, without copying the values out.  Children that do not
+ * have the value are skipped.  For example, the total size of the memory
+ * layout:
+ *
+ * \code
+ * config_node_find( ROOT_NODE, "platform.memory.layout", &layout );
+ * config_aggregate( layout, "size", CONFIG_AGGREGATE_SUM, &total );
+ * \endcode
+ *
+ * Values are taken as signed ints, read as by config_get_int() (a numeric
+ * string counts as its number); the SUM is computed in 64 bits.
+ * Returns CONFIG_ERR_NOT_FOUND for MIN or MAX when no child has the value.
+ *
+ * @param[in] base_ref       node whose children are reduced
+ * @param[in] child_key      integer node beneath each child (NULL or "" for the child itself)
+ * @param[in] op             reduction
+ * @param[out] result        reduced value
+ */
+config_result_t config_aggregate(
+            config_ref_t    base_ref,
+            const char *    child_key,
+            config_aggregate_op_t op,
+            long long *     result );
+
+/**
+ * Find the entry of the memory layout (CONFIG_PATH_PLATFORM_MEMORY_LAYOUT)
+ * whose "base" and "size" values cover the physical address pa, for
+ * instance to validate a DMA buffer or decode a fault address.  Lookups
+ * take O(log n) in the number of layout entries.  Where entries overlap,
+ * the one with the highest base wins.
+ *
+ * @param[in] pa             physical address
+ * @param[out] node_ref      the layout entry containing pa
+ * @param[out] offset        pa - base of that entry (may be NULL)
+ */
+config_result_t config_layout_lookup_pa(
+            unsigned long   pa,
+            config_ref_t *  node_ref,
+            unsigned long * offset );
+
+/**
+ * Return a 64-bit hash of the names and values in the subtree rooted at the
+ * specified reference node, the node's own value included.  Equal subtrees
+ * hash alike whatever order their children were loaded in, so comparing a
+ * stored hash is enough to tell whether anything beneath a node changed.
+ * Hashes are cached, and a set only rehashes the path it changed.  A
+ * reference that names no node fails with CONFIG_ERR_INVALID_REFERENCE.
+ *
+ * @param[in] node_ref       subtree root
+ * @param[out] hash          subtree hash
+ */
+config_result_t config_subtree_hash(
+            config_ref_t    node_ref,
+            unsigned long long * hash );
+
+/**
+ * One difference reported by config_subtree_diff().
+ */
+typedef struct {
+	config_ref_t	a_ref;		/**< node in the first subtree, 0 if only the second has it */
+	config_ref_t	b_ref;		/**< node in the second subtree, 0 if only the first has it */
+} config_diff_t;
+
+/**
+ * Compare two subtrees by child name, descending only into children whose
+ * subtree hashes differ.  Reports each pair of same-named nodes whose own
+ * values differ, and the root of each subtree present on one side only.
+ *
+ * @param[in] a_ref          first subtree root
+ * @param[in] b_ref          second subtree root
+ * @param[out] diffs         buffer for up to max differences
+ * @param[in] max            number of entries diffs can hold
+ * @param[out] count         number of differences; 0 if the subtrees are
+ *                           equal, more than max when diffs was too small
+ */
+config_result_t config_subtree_diff(
+            config_ref_t    a_ref,
+            config_ref_t    b_ref,
+            config_diff_t * diffs,
+            unsigned int    max,
+            unsigned int *  count );
+
+/**
+ * Apply a list of updates, one per line, at the specified reference node:
+ *
+ *     platform.software.drivers.sven.debug_level = 3
+ *     platform.software.drivers.sven.name = "sven"
+ *
+ * Values are integers (decimal or 0x-prefixed) or double-quoted strings
+ * with \" \\ \n and \t escapes; blank lines and lines starting with '#' are
+ * ignored.  Paths are created as needed, as by config_set_int().  The whole
+ * text is checked before anything is written, so a malformed line fails the
+ * call with nothing applied; the updates are then applied under one lock,
+ * with later lines winning over earlier ones for the same path.
+ *
+ * @param[in] base_ref       based node reference
+ * @param[in] data           update lines, not necessarily NUL-terminated
+ * @param[in] len            length of data
+ */
+config_result_t config_load_flat(
+            config_ref_t    base_ref,
+            const char *    data,
+            size_t          len );
+
+/** Deepest object nesting config_load_json() accepts */
+#define CONFIG_JSON_MAX_DEPTH		64
+
+/**
+ * Parse a JSON object and insert its members into the dictionary at the
+ * specified reference node, as config_load() does for the native format.
+ * Objects become nodes, integers and strings become int and string values,
+ * true and false become 1 and 0, null becomes a node without a value, and
+ * arrays of integers become integer arrays (see config_get_int_array()).
+ * Numbers must be integers that fit in 32 bits, without leading zeros,
+ * strings may not contain \u0000 or unpaired surrogates (pairs become one
+ * UTF-8 character), and member names must be made of letters, digits, '_'
+ * and '-'.  Anything else fails the load;
+ * members read before the error stay inserted.
+ *
+ * @param[in] base_ref       based node reference
+ * @param[in] json           JSON text, not necessarily NUL-terminated
+ * @param[in] len            length of json
+ */
+config_result_t config_load_json(
+            config_ref_t    base_ref,
+            const char *    json,
+            size_t          len );
+
+/**
+ * Write the subtree rooted at the specified reference node as compact JSON,
+ * in the form config_load_json() reads.  A node with children is written as
+ * an object, so a value held by such a node is not exported.
+ *
+ * @param[in] base_ref       subtree root
+ * @param[out] buf           buffer for the NUL-terminated JSON text
+ * @param[in] bufsize        size of buf
+ * @param[out] len           bytes needed, the NUL included; when this is
+ *                           more than bufsize the call fails with
+ *                           CONFIG_ERR_NO_RESOURCES
+ */
+config_result_t config_export_json(
+            config_ref_t    base_ref,
+            char *          buf,
+            size_t          bufsize,
+            size_t *        len );
+
+/**
+ * Start recording every change made to the database (sets, loads, flat
+ * updates, removals and published namespaces) in a journal of size bytes,
+ * discarding any journal already started.  Changes that land in an overlay
+ * layer or a namespace are not recorded.  When the journal fills up,
+ * superseded sets are coalesced; if it is still full, recording stops and
+ * config_journal_save() fails with CONFIG_ERR_INVALID_REFERENCE.
+ *
+ * @param[in] size           journal size in bytes (at least 64), or 0 to stop
+ */
+config_result_t config_journal_start(
+            size_t          size );
+
+/**
+ * Copy the journal into buf, to be kept (in a file, say) across a reload
+ * of the database and handed to config_journal_replay().  The image is in
+ * native byte order.
+ *
+ * @param[out] buf           journal image
+ * @param[in] bufsize        size of buf
+ * @param[out] len           size of the image, even when bufsize is too
+ *                           small and CONFIG_ERR_NO_RESOURCES is returned
+ */
+config_result_t config_journal_save(
+            char *          buf,
+            size_t          bufsize,
+            size_t *        len );
+
+/**
+ * Re-apply a journal image saved by config_journal_save().  Of the sets
+ * between two loads or removals only the last to each path is applied, as
+ * one batch in the order the paths were first set.  Nothing is applied if
+ * the image is damaged.  A started journal records the replayed changes.
+ *
+ * @param[in] data           journal image
+ * @param[in] len            size of the image
+ */
+config_result_t config_journal_replay(
+            const char *    data,
+            size_t          len );
+
+#ifndef __KERNEL__
+/** Output buffer handed to a config_walk_parallel() visitor */
+typedef struct config_walk_buf config_walk_buf_t;
+
+/**
+ * Visitor called by config_walk_parallel() for each node.  depth is 0 for
+ * the base node.  out is NULL unless the caller asked for ordered output.
+ * Returning anything but CONFIG_SUCCESS stops the walk.
+ */
+typedef config_result_t (*config_walk_visitor_t)(
+            config_ref_t        node_ref,
+            unsigned int        depth,
+            config_walk_buf_t * out,
+            void *              ctx );
+
+/**
+ * Call visitor for every node of the subtree rooted at the specified
+ * reference node, spread over nthreads threads (userspace core library
+ * only).  Visitors run concurrently, in no particular order, and may call
+ * the rest of the API.  The walk is an epoch section (see
+ * config_epoch_enter()): a node removed meanwhile is still visited.
+ *
+ * When output is not NULL, whatever each visitor passes to
+ * config_walk_emit() is collected and returned in *output in pre-order
+ * (the order a serial recursive walk would produce), whatever the thread
+ * count.  Free *output with free().
+ *
+ * @param[in] base_ref       subtree root
+ * @param[in] visitor        called once per node
+ * @param[in] ctx            passed to visitor
+ * @param[in] nthreads       number of threads, the caller's included
+ * @param[out] output        ordered visitor output (may be NULL)
+ * @param[out] output_len    length of *output
+ */
+config_result_t config_walk_parallel(
+            config_ref_t    base_ref,
+            config_walk_visitor_t visitor,
+            void *          ctx,
+            unsigned int    nthreads,
+            char **         output,
+            size_t *        output_len );
+
+/**
+ * Append len bytes to a visitor's output.  Does nothing when out is NULL.
+ *
+ * @param[in] out            the visitor's out argument
+ * @param[in] data           bytes to append
+ * @param[in] len            number of bytes
+ */
+config_result_t config_walk_emit(
+            config_walk_buf_t * out,
+            const void *    data,
+            size_t          len );
+
+/**
+ * Read a configuration file and load it at the specified reference node
+ * (userspace only, provided by libplatform_config).  The file may contain
+ *
+ *     include "file"
+ *     include "file" at "location"
+ *
+ * directives, with file names relative to the including file.  The first
+ * form loads the named file in place; the second loads it at the given
+ * location below the including file's node, creating the location if
+ * necessary; it takes effect between the statements around it, so it may
+ * sit inside named blocks but not inside unnamed ones.  An include cycle is
+ * an error.  Expanded files are cached by content, so a fragment included
+ * many times is only scanned once; the cache holds the expanded text, which
+ * every load still parses.
+ *
+ * @param[in] base_ref       based node reference
+ * @param[in] filename       configuration file
+ */
+config_result_t config_load_file(
+            config_ref_t    base_ref,
+            const char *    filename );
 
+/**
+ * Release the fragments cached by config_load_file().
+ */
+void config_load_file_cache_clear( void );
+#endif
 
 
 /** @deprecated DEPRECATED: DRIVER PRIVATE: initialize the memory layout internal hash table */
@@ -87,14 +87,45 @@ MODULE_LICENSE("Dual BSD/GPL");
 EXPORT_SYMBOL(config_node_find);
 EXPORT_SYMBOL(config_node_first_child);
 EXPORT_SYMBOL(config_node_next_sibling);
+EXPORT_SYMBOL(config_node_child_count);
+EXPORT_SYMBOL(config_node_child_at);
 EXPORT_SYMBOL(config_node_get_name);
 EXPORT_SYMBOL(config_node_get_int);
 EXPORT_SYMBOL(config_node_get_str);
 EXPORT_SYMBOL(config_get_int);
 EXPORT_SYMBOL(config_get_str);
+EXPORT_SYMBOL(config_get_int_array);
+EXPORT_SYMBOL(config_get_int_array_elem);
+EXPORT_SYMBOL(config_bind_struct);
 EXPORT_SYMBOL(config_set_int);
 EXPORT_SYMBOL(config_set_str);
 EXPORT_SYMBOL(config_load);
+EXPORT_SYMBOL(config_index_stats);
+EXPORT_SYMBOL(config_dedup_enable);
+EXPORT_SYMBOL(config_dedup_stats);
+EXPORT_SYMBOL(config_overlay_push);
+EXPORT_SYMBOL(config_overlay_drop);
+EXPORT_SYMBOL(config_overlay_find);
+EXPORT_SYMBOL(config_query);
+EXPORT_SYMBOL(config_aggregate);
+EXPORT_SYMBOL(config_layout_lookup_pa);
+EXPORT_SYMBOL(config_subtree_hash);
+EXPORT_SYMBOL(config_subtree_diff);
+EXPORT_SYMBOL(config_load_json);
+EXPORT_SYMBOL(config_export_json);
+EXPORT_SYMBOL(config_load_flat);
+EXPORT_SYMBOL(config_epoch_enter);
+EXPORT_SYMBOL(config_epoch_exit);
+EXPORT_SYMBOL(config_namespace_create);
+EXPORT_SYMBOL(config_namespace_destroy);
+EXPORT_SYMBOL(config_namespace_bind);
+EXPORT_SYMBOL(config_namespace_publish);
+EXPORT_SYMBOL(config_journal_start);
+EXPORT_SYMBOL(config_journal_save);
+EXPORT_SYMBOL(config_journal_replay);
+EXPORT_SYMBOL(config_stage_prepare);
+EXPORT_SYMBOL(config_stage_publish);
+EXPORT_SYMBOL(config_node_move);
 //#define VERBOSE_DEBUG
 #ifdef VER
 const char *Version_string = "#@# platform_config.ko " VER;
@@ -127,6 +158,20 @@ const char *Version_string = "#@# platform_config.ko " VER;
                 __err = -EFAULT;                        \
             }                                           \
             __err;})
+
+/* copy exactly size bytes into a buffer one byte larger, left nul terminated (and never zero sized) */
+#define PLAT_GET_CONST_DATA_TERM( dst, src, size ) ({   \
+            int __err = 0;                              \
+            dst = kmalloc((size) + 1, GFP_KERNEL);      \
+            if (NULL == dst)                            \
+                __err = -ENOMEM;                        \
+            else if (copy_from_user(dst, src, size)) {  \
+                kfree(dst);                             \
+                __err = -EFAULT;                        \
+            }                                           \
+            else                                        \
+                ((char *)(dst))[size] = '\0';           \
+            __err;})
 /*-------------------------------------------------------------------------------------------------------------------*/
 /*				 Platform configuration device operation interfaces				     */
 /*-------------------------------------------------------------------------------------------------------------------*/
@@ -147,16 +192,140 @@ static int plat_cfg_open(struct inode *inode, struct file *filp)
 	return(0);
 }
 
+/* The private namespace of an open file (private_data), or 0 */
+#define PLAT_FILE_NS(filp)	((unsigned int)(unsigned long)(filp)->private_data)
+
 static int plat_cfg_release(struct inode *inode, struct file *filp)
 {
 #ifdef VERBOSE_DEBUG
 	printk(KERN_INFO "%s:%4i: %s (pid %d) released paltform_config_drv.\n",
 		       	__FILE__, __LINE__, current->comm, current->pid);
 #endif
+	/* unpublished writes go with the file */
+	if (PLAT_FILE_NS(filp))
+		config_namespace_destroy(PLAT_FILE_NS(filp));
+	filp->private_data = NULL;
 	return(0);
 }
 
-static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+/* BIND_STRUCT: data_ptr = descriptor table, val = descriptor count, string/bufsize = the structure, val_ptr = presence bitmap */
+static int plat_cfg_bind_struct(struct plat_cfg_ioctl *pc_args)
+{
+	config_bind_desc_t *p_desc = NULL;
+	char *p_struct = NULL;
+	unsigned int i, count = 0, present = 0;
+	int status = 0;
+
+	if (pc_args->val < 0 || pc_args->val > CONFIG_BIND_MAX_FIELDS || pc_args->bufsize > KMALLOC_MAX_SIZE)
+		return -EINVAL;
+
+	if ((status = PLAT_GET_CONST_DATA_TERM(p_desc, pc_args->data_ptr, pc_args->val * sizeof(*p_desc))) != 0)
+		return status;
+
+	/* the names in the table are user pointers: replace them as they are copied in */
+	for (count = 0; count < (unsigned int)pc_args->val; count++) {
+		const char __user *name = p_desc[count].name;
+		const char __user *def = p_desc[count].default_str;
+		size_t field_size = (CONFIG_BIND_INT == p_desc[count].type) ? sizeof(int) : p_desc[count].size;
+
+		p_desc[count].name = NULL;
+		p_desc[count].default_str = NULL;
+		if ((CONFIG_BIND_INT != p_desc[count].type && CONFIG_BIND_STR != p_desc[count].type)
+		  || p_desc[count].offset > pc_args->bufsize
+		  || field_size > pc_args->bufsize - p_desc[count].offset) {
+			status = -EINVAL;
+			break;
+		}
+		p_desc[count].name = strndup_user(name, PAGE_SIZE);
+		if (IS_ERR(p_desc[count].name)) {
+			status = PTR_ERR(p_desc[count].name);
+			p_desc[count].name = NULL;
+			break;
+		}
+		if (NULL != def) {
+			p_desc[count].default_str = strndup_user(def, PAGE_SIZE);
+			if (IS_ERR(p_desc[count].default_str)) {
+				status = PTR_ERR(p_desc[count].default_str);
+				p_desc[count].default_str = NULL;
+				count++;
+				break;
+			}
+		}
+	}
+
+	/* fields not in the table keep the caller's contents */
+	if (0 == status)
+		status = PLAT_GET_CONST_DATA_TERM(p_struct, pc_args->string, pc_args->bufsize);
+
+	if (0 == status) {
+		if (CONFIG_SUCCESS != config_bind_struct(pc_args->base_ref, p_desc, count, p_struct, &present))
+			status = -EINVAL;
+		else if (copy_to_user(pc_args->string, p_struct, pc_args->bufsize)
+		      || put_user(present, (unsigned int *)pc_args->val_ptr))
+			status = -EFAULT;
+		kfree(p_struct);
+	}
+
+	for (i = 0; i < count; i++) {
+		kfree(p_desc[i].name);
+		kfree(p_desc[i].default_str);
+	}
+	kfree(p_desc);
+	return status;
+}
+
+/* QUERY: const_name = pattern, config_data = predicate (may be NULL), data_ptr/bufsize = result buffer, val_ptr = match count */
+static int plat_cfg_query(struct plat_cfg_ioctl *pc_args)
+{
+	config_query_pred_t pred, *p_pred = NULL;
+	config_query_result_t *p_results = NULL;
+	char *p_pattern = NULL;
+	unsigned int count = 0;
+	int status = 0;
+
+	if (pc_args->bufsize > KMALLOC_MAX_SIZE / sizeof(*p_results))
+		return -EINVAL;
+
+	p_pattern = strndup_user(pc_args->const_name, PAGE_SIZE);
+	if (IS_ERR(p_pattern))
+		return PTR_ERR(p_pattern);
+
+	/* the predicate's key is a user pointer: replace it as it is copied in */
+	if (NULL != pc_args->config_data) {
+		if (copy_from_user(&pred, pc_args->config_data, sizeof(pred))) {
+			status = -EFAULT;
+		} else if (NULL != pred.key) {
+			pred.key = strndup_user((const char __user *)pred.key, PAGE_SIZE);
+			if (IS_ERR(pred.key)) {
+				status = PTR_ERR(pred.key);
+				pred.key = NULL;
+			}
+		}
+		p_pred = &pred;
+	}
+
+	if (0 == status) {
+		p_results = kmalloc((pc_args->bufsize ? pc_args->bufsize : 1) * sizeof(*p_results), GFP_KERNEL);
+		if (NULL == p_results)
+			status = -ENOMEM;
+	}
+
+	if (0 == status) {
+		if (CONFIG_SUCCESS != config_query(pc_args->base_ref, p_pattern, p_pred, p_results, pc_args->bufsize, &count))
+			status = -EINVAL;
+		else if (copy_to_user(pc_args->data_ptr, p_results, min_t(size_t, count, pc_args->bufsize) * sizeof(*p_results))
+		      || put_user(count, (unsigned int *)pc_args->val_ptr))
+			status = -EFAULT;
+	}
+
+	if (NULL != p_pred)
+		kfree(pred.key);
+	kfree(p_results);
+	kfree(p_pattern);
+	return status;
+}
+
+static int plat_cfg_do_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct plat_cfg_ioctl pc_args; 
 	int status = 0;
@@ -168,6 +337,15 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 	char *p_const_string = NULL;
 	char *p_name = NULL;
 	char *p_config_data = NULL;
+	int *p_values = NULL;
+	unsigned int count_data = 0;
+	config_index_stats_t index_stats;
+	config_dedup_stats_t dedup_stats;
+	long long aggregate_data = 0;
+	unsigned long offset_data = 0;
+	unsigned long long hash_data = 0;
+	config_diff_t *p_diffs = NULL;
+	size_t json_len = 0;
  
 	/* Make sure that we haven't erroneously received the ioctl call */
 	if (_IOC_TYPE(cmd) != PLATFORM_CONFIG_IOC_MAGIC)
@@ -182,8 +360,12 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 	/* make sure we have a valid pointer to our parameters */
 	if (!arg)
 		return -EINVAL;
-	/* read the parameters from user */
-	status = copy_from_user(&pc_args, (void *)arg, sizeof(struct plat_cfg_ioctl));
+	/* read the parameters from user; only numbers carrying the full size have data_ptr */
+	memset(&pc_args, 0, sizeof(pc_args));
+	if (_IOC_SIZE(cmd) == sizeof(struct plat_cfg_ioctl))
+		status = copy_from_user(&pc_args, (void *)arg, sizeof(struct plat_cfg_ioctl));
+	else
+		status = copy_from_user(&pc_args, (void *)arg, offsetof(struct plat_cfg_ioctl, data_ptr));
 	
 	if (status)
 	{
@@ -205,6 +387,7 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 		printk(KERN_INFO "%s:%4i: -----config_data   = %lux\n", __FILE__, __LINE__, (unsigned long)pc_args.config_data);
 		printk(KERN_INFO "%s:%4i: -----bufsize       = %d\n", __FILE__, __LINE__, pc_args.bufsize);
 		printk(KERN_INFO "%s:%4i: -----node_ptr      = %lux\n", __FILE__, __LINE__, (unsigned long)pc_args.node_ptr);
+		printk(KERN_INFO "%s:%4i: -----data_ptr      = %lux\n", __FILE__, __LINE__, (unsigned long)pc_args.data_ptr);
 	}
 #endif
 	
@@ -250,6 +433,102 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
             kfree(p_string);
             break;
 
+        case PLATFORM_CONFIG_IOC_GET_INT_ARRAY:
+            if (pc_args.bufsize > KMALLOC_MAX_SIZE / sizeof(int))
+                return -EINVAL;
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            p_values = kmalloc((pc_args.bufsize ? pc_args.bufsize : 1) * sizeof(int), GFP_KERNEL);
+            if (NULL == p_values) {
+                kfree(p_const_name);
+                return -ENOMEM;
+            }
+            pc_status = config_get_int_array(pc_args.base_ref, p_const_name, p_values, pc_args.bufsize, &count_data);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (copy_to_user(pc_args.data_ptr, p_values, min_t(size_t, count_data, pc_args.bufsize) * sizeof(int))
+                  || put_user(count_data, (unsigned int *)pc_args.val_ptr))
+                pc_status = -EINVAL;
+            kfree(p_const_name);
+            kfree(p_values);
+            break;
+
+        case PLATFORM_CONFIG_IOC_BIND_STRUCT:
+            pc_status = plat_cfg_bind_struct(&pc_args);
+            break;
+
+        case PLATFORM_CONFIG_IOC_QUERY:
+            pc_status = plat_cfg_query(&pc_args);
+            break;
+
+        case PLATFORM_CONFIG_IOC_AGGREGATE:
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            pc_status = config_aggregate(pc_args.base_ref, p_const_name, (config_aggregate_op_t)pc_args.val, &aggregate_data);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (copy_to_user(pc_args.data_ptr, &aggregate_data, sizeof(aggregate_data)))
+                pc_status = -EINVAL;
+            kfree(p_const_name);
+            break;
+
+        case PLATFORM_CONFIG_IOC_LAYOUT_LOOKUP_PA:
+            /* bufsize carries the physical address */
+            pc_status = config_layout_lookup_pa((unsigned long)pc_args.bufsize, &node_data, &offset_data);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (put_user(node_data, (int *)pc_args.node_ptr)
+                  || (pc_args.data_ptr && copy_to_user(pc_args.data_ptr, &offset_data, sizeof(offset_data))))
+                pc_status = -EINVAL;
+            break;
+
+        case PLATFORM_CONFIG_IOC_SUBTREE_HASH:
+            pc_status = config_subtree_hash(pc_args.base_ref, &hash_data);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (copy_to_user(pc_args.data_ptr, &hash_data, sizeof(hash_data)))
+                pc_status = -EINVAL;
+            break;
+
+        case PLATFORM_CONFIG_IOC_SUBTREE_DIFF:
+            /* base_ref and val are the two subtrees */
+            if (pc_args.bufsize > KMALLOC_MAX_SIZE / sizeof(config_diff_t))
+                return -EINVAL;
+            p_diffs = kmalloc((pc_args.bufsize ? pc_args.bufsize : 1) * sizeof(config_diff_t), GFP_KERNEL);
+            if (NULL == p_diffs)
+                return -ENOMEM;
+            pc_status = config_subtree_diff(pc_args.base_ref, (config_ref_t)pc_args.val, p_diffs, pc_args.bufsize, &count_data);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (copy_to_user(pc_args.data_ptr, p_diffs, min_t(size_t, count_data, pc_args.bufsize) * sizeof(config_diff_t))
+                  || put_user(count_data, (unsigned int *)pc_args.val_ptr))
+                pc_status = -EINVAL;
+            kfree(p_diffs);
+            break;
+
+        case PLATFORM_CONFIG_IOC_GET_INT_ARRAY_ELEM:
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            pc_status = config_get_int_array_elem(pc_args.base_ref, p_const_name, (unsigned int)pc_args.val, &val_data);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (put_user(val_data, pc_args.val_ptr))
+                pc_status = -EINVAL;
+            kfree(p_const_name);
+            break;
+
         case PLATFORM_CONFIG_IOC_SET_INT:
             if (!IS_ROOT)
                 return -EACCES;
@@ -295,6 +574,47 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
             kfree(p_const_name);
             break;
 
+        case PLATFORM_CONFIG_IOC_OVERLAY_PUSH:
+            if (!IS_ROOT)
+                return -EACCES;
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            pc_status = config_overlay_push(p_const_name, &node_data );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (put_user(node_data, (int *)pc_args.node_ptr))
+                pc_status = -EINVAL;
+            kfree(p_const_name);
+            break;
+
+        case PLATFORM_CONFIG_IOC_OVERLAY_DROP:
+            if (!IS_ROOT)
+                return -EACCES;
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            pc_status = config_overlay_drop(p_const_name);
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            kfree(p_const_name);
+            break;
+
+        case PLATFORM_CONFIG_IOC_OVERLAY_FIND:
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            pc_status = config_overlay_find(p_const_name, &node_data );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (put_user(node_data, (int *)pc_args.node_ptr))
+                pc_status = -EINVAL;
+            kfree(p_const_name);
+            break;
+
         case PLATFORM_CONFIG_IOC_NODE_FIRST_CHILD:
             pc_status = config_node_first_child(pc_args.base_ref, &node_data );
             if (CONFIG_SUCCESS != pc_status )
@@ -315,6 +635,26 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
                 pc_status = -EINVAL;
             break;
 
+        case PLATFORM_CONFIG_IOC_NODE_CHILD_COUNT:
+            pc_status = config_node_child_count(pc_args.base_ref, &count_data );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            if (put_user(count_data, (unsigned int *)pc_args.val_ptr))
+                pc_status = -EINVAL;
+            break;
+
+        case PLATFORM_CONFIG_IOC_NODE_CHILD_AT:
+            pc_status = config_node_child_at(pc_args.base_ref, (unsigned int)pc_args.val, &node_data );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            if (put_user(node_data, (int *)pc_args.node_ptr))
+                pc_status = -EINVAL;
+            break;
+
         case PLATFORM_CONFIG_IOC_NODE_GET_NAME:
             p_name = kmalloc(pc_args.bufsize, GFP_KERNEL);
             if (NULL == p_name)
@@ -378,6 +718,217 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
             kfree(p_config_data);
             break;
 
+        case PLATFORM_CONFIG_IOC_LOAD_JSON:
+            if (!IS_ROOT)
+                return -EACCES;
+            if((pc_status = PLAT_GET_CONST_DATA(p_config_data, pc_args.config_data, pc_args.bufsize))
+                 != CONFIG_SUCCESS) {
+                break;
+            }
+            pc_status = config_load_json(pc_args.base_ref, p_config_data, pc_args.bufsize );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            kfree(p_config_data);
+            break;
+
+        case PLATFORM_CONFIG_IOC_LOAD_FLAT:
+            if (!IS_ROOT)
+                return -EACCES;
+            if((pc_status = PLAT_GET_CONST_DATA(p_config_data, pc_args.config_data, pc_args.bufsize))
+                 != CONFIG_SUCCESS) {
+                break;
+            }
+            pc_status = config_load_flat(pc_args.base_ref, p_config_data, pc_args.bufsize );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            kfree(p_config_data);
+            break;
+
+        case PLATFORM_CONFIG_IOC_EXPORT_JSON:
+            if (pc_args.bufsize > KMALLOC_MAX_SIZE)
+                return -EINVAL;
+            p_string = kmalloc(pc_args.bufsize ? pc_args.bufsize : 1, GFP_KERNEL);
+            if (NULL == p_string)
+                return -ENOMEM;
+            /* a buffer that is too small still reports the length needed */
+            pc_status = config_export_json(pc_args.base_ref, p_string, pc_args.bufsize, &json_len);
+            if (CONFIG_SUCCESS != pc_status && CONFIG_ERR_NO_RESOURCES != pc_status)
+            {
+                pc_status = -EINVAL;
+            }
+            else if (copy_to_user(pc_args.string, p_string, min_t(size_t, json_len, pc_args.bufsize))
+                  || copy_to_user(pc_args.data_ptr, &json_len, sizeof(json_len)))
+                pc_status = -EINVAL;
+            else
+                pc_status = CONFIG_SUCCESS;
+            kfree(p_string);
+            break;
+
+        case PLATFORM_CONFIG_IOC_JOURNAL_START:
+            if (!IS_ROOT)
+                return -EACCES;
+            pc_status = config_journal_start( pc_args.bufsize );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            break;
+
+        case PLATFORM_CONFIG_IOC_JOURNAL_SAVE:
+            if (pc_args.bufsize > KMALLOC_MAX_SIZE)
+                return -EINVAL;
+            p_string = kmalloc(pc_args.bufsize ? pc_args.bufsize : 1, GFP_KERNEL);
+            if (NULL == p_string)
+                return -ENOMEM;
+            /* a buffer that is too small still reports the length needed */
+            pc_status = config_journal_save(p_string, pc_args.bufsize, &json_len);
+            if (CONFIG_SUCCESS != pc_status && CONFIG_ERR_NO_RESOURCES != pc_status)
+            {
+                pc_status = -EINVAL;
+            }
+            else if (copy_to_user(pc_args.string, p_string, min_t(size_t, json_len, pc_args.bufsize))
+                  || copy_to_user(pc_args.data_ptr, &json_len, sizeof(json_len)))
+                pc_status = -EINVAL;
+            else
+                pc_status = CONFIG_SUCCESS;
+            kfree(p_string);
+            break;
+
+        case PLATFORM_CONFIG_IOC_JOURNAL_REPLAY:
+            if (!IS_ROOT)
+                return -EACCES;
+            if((pc_status = PLAT_GET_CONST_DATA(p_config_data, pc_args.config_data, pc_args.bufsize))
+                 != CONFIG_SUCCESS) {
+                break;
+            }
+            pc_status = config_journal_replay(p_config_data, pc_args.bufsize );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            kfree(p_config_data);
+            break;
+
+        case PLATFORM_CONFIG_IOC_STAGE_PREPARE:
+            if (!IS_ROOT)
+                return -EACCES;
+            pc_status = config_stage_prepare( &node_data );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (put_user(node_data, (int *)pc_args.node_ptr))
+                pc_status = -EINVAL;
+            break;
+
+        case PLATFORM_CONFIG_IOC_STAGE_PUBLISH:
+            if (!IS_ROOT)
+                return -EACCES;
+            pc_status = config_stage_publish( pc_args.base_ref, (config_ref_t) pc_args.val );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            break;
+
+        case PLATFORM_CONFIG_IOC_NODE_MOVE:
+            if (!IS_ROOT)
+                return -EACCES;
+            if((pc_status = PLAT_GET_CONST_NAME(p_const_name,pc_args.const_name)) != CONFIG_SUCCESS)
+                break;
+            pc_status = config_node_move( pc_args.base_ref, (config_ref_t) pc_args.val, p_const_name );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            kfree(p_const_name);
+            break;
+
+        case PLATFORM_CONFIG_IOC_NS_CREATE:
+            if (!IS_ROOT)
+                return -EACCES;
+            if (PLAT_FILE_NS(filp))
+                return -EBUSY;
+            pc_status = config_namespace_create( &count_data );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            else if (cmpxchg(&filp->private_data, NULL,
+                             (void *)(unsigned long)count_data) != NULL)
+            {
+                /* another thread on this file created one first */
+                config_namespace_destroy( count_data );
+                return -EBUSY;
+            }
+            else if (put_user(count_data, (int *)pc_args.val_ptr))
+            {
+                filp->private_data = NULL;
+                config_namespace_destroy( count_data );
+                pc_status = -EINVAL;
+            }
+            break;
+
+        case PLATFORM_CONFIG_IOC_NS_PUBLISH:
+            if (!IS_ROOT)
+                return -EACCES;
+            if (!PLAT_FILE_NS(filp) || pc_args.val != PLAT_FILE_NS(filp))
+                return -EINVAL;
+            pc_status = config_namespace_publish( PLAT_FILE_NS(filp) );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            break;
+
+        case PLATFORM_CONFIG_IOC_NS_DISCARD:
+            /* take the namespace off the file before destroying it, so
+               two discards cannot both destroy it */
+            if (!pc_args.val || cmpxchg(&filp->private_data,
+                                        (void *)(unsigned long)pc_args.val, NULL)
+                                != (void *)(unsigned long)pc_args.val)
+                return -EINVAL;
+            pc_status = config_namespace_destroy( pc_args.val );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            break;
+
+        case PLATFORM_CONFIG_IOC_INDEX_STATS:
+            pc_status = config_index_stats( &index_stats );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            if (copy_to_user(pc_args.data_ptr, &index_stats, sizeof(index_stats)))
+                pc_status = -EINVAL;
+            break;
+
+        case PLATFORM_CONFIG_IOC_DEDUP_ENABLE:
+            if (!IS_ROOT)
+                return -EACCES;
+            pc_status = config_dedup_enable( pc_args.val );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            break;
+
+        case PLATFORM_CONFIG_IOC_DEDUP_STATS:
+            pc_status = config_dedup_stats( &dedup_stats );
+            if (CONFIG_SUCCESS != pc_status )
+            {
+                pc_status = -EINVAL;
+            }
+            if (copy_to_user(pc_args.data_ptr, &dedup_stats, sizeof(dedup_stats)))
+                pc_status = -EINVAL;
+            break;
+
 		default:
 			pc_status = -ENOTTY;
 	}
@@ -385,6 +936,20 @@ static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 	return pc_status;
 }
 
+/* Run an ioctl in the view of the file: its private namespace if it has one */
+static int plat_cfg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	unsigned int ns = PLAT_FILE_NS(filp);
+	int status;
+
+	if (ns && CONFIG_SUCCESS != config_namespace_bind(ns))
+		return -EBUSY;
+	status = plat_cfg_do_ioctl(filp, cmd, arg);
+	if (ns)
+		config_namespace_bind(0);
+	return status;
+}
+
 static struct file_operations plat_cfg_fops = {
 	.owner		= THIS_MODULE,
 	.open	 	= plat_cfg_open,
@@ -174,6 +174,149 @@ config_result_t config_deinitialize( void );
 */
 #define PLATFORM_CONFIG_IOC_REMOVE		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 14, char *)
 
+/** \def PLATFORM_CONFIG_IOC_INDEX_STATS
+    \brief IOCTL number to Read The Name Index Statistics
+*/
+#define PLATFORM_CONFIG_IOC_INDEX_STATS		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 15, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_DEDUP_ENABLE
+    \brief IOCTL number to Turn Subtree Deduplication On or Off
+*/
+#define PLATFORM_CONFIG_IOC_DEDUP_ENABLE	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 16, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_DEDUP_STATS
+    \brief IOCTL number to Read The Subtree Deduplication Statistics
+*/
+#define PLATFORM_CONFIG_IOC_DEDUP_STATS		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 17, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_GET_INT_ARRAY
+    \brief IOCTL number to Get The Integer Array Value
+*/
+#define PLATFORM_CONFIG_IOC_GET_INT_ARRAY	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 18, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_GET_INT_ARRAY_ELEM
+    \brief IOCTL number to Get One Element of The Integer Array Value
+*/
+#define PLATFORM_CONFIG_IOC_GET_INT_ARRAY_ELEM	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 19, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_BIND_STRUCT
+    \brief IOCTL number to Fill a Structure From a Descriptor Table
+*/
+#define PLATFORM_CONFIG_IOC_BIND_STRUCT		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 20, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_OVERLAY_PUSH
+    \brief IOCTL number to Stack a New Overlay Layer
+*/
+#define PLATFORM_CONFIG_IOC_OVERLAY_PUSH	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 21, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_OVERLAY_DROP
+    \brief IOCTL number to Remove an Overlay Layer
+*/
+#define PLATFORM_CONFIG_IOC_OVERLAY_DROP	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 22, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_OVERLAY_FIND
+    \brief IOCTL number to Find The Root Node of an Overlay Layer
+*/
+#define PLATFORM_CONFIG_IOC_OVERLAY_FIND	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 23, struct plat_cfg_ioctl)
+/** \def PLATFORM_CONFIG_IOC_QUERY
+    \brief IOCTL number to Return The Nodes Matching a Wildcard Pattern
+*/
+#define PLATFORM_CONFIG_IOC_QUERY		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 24, struct plat_cfg_ioctl)
+/** \def PLATFORM_CONFIG_IOC_AGGREGATE
+    \brief IOCTL number to Reduce an Integer Value Across The Children of a Node
+*/
+#define PLATFORM_CONFIG_IOC_AGGREGATE	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 25, struct plat_cfg_ioctl)
+/** \def PLATFORM_CONFIG_IOC_LAYOUT_LOOKUP_PA
+    \brief IOCTL number to Find The Memory Layout Entry Containing a Physical Address
+*/
+#define PLATFORM_CONFIG_IOC_LAYOUT_LOOKUP_PA	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 26, struct plat_cfg_ioctl)
+/** \def PLATFORM_CONFIG_IOC_SUBTREE_HASH
+    \brief IOCTL number to Get The Content Hash of a Subtree
+*/
+#define PLATFORM_CONFIG_IOC_SUBTREE_HASH	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 27, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_SUBTREE_DIFF
+    \brief IOCTL number to Compare Two Subtrees
+*/
+#define PLATFORM_CONFIG_IOC_SUBTREE_DIFF	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 28, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_LOAD_JSON
+    \brief IOCTL number to Load JSON Configuration Data
+*/
+#define PLATFORM_CONFIG_IOC_LOAD_JSON		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 29, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_EXPORT_JSON
+    \brief IOCTL number to Write a Subtree as JSON
+*/
+#define PLATFORM_CONFIG_IOC_EXPORT_JSON		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 30, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_LOAD_FLAT
+    \brief IOCTL number to Apply a Batch of "path = value" Updates
+*/
+#define PLATFORM_CONFIG_IOC_LOAD_FLAT		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 31, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_NS_CREATE
+    \brief IOCTL number to Give The File Descriptor a Private Namespace
+*/
+#define PLATFORM_CONFIG_IOC_NS_CREATE		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 32, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_NS_PUBLISH
+    \brief IOCTL number to Publish The File Descriptor's Namespace
+*/
+#define PLATFORM_CONFIG_IOC_NS_PUBLISH		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 33, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_NS_DISCARD
+    \brief IOCTL number to Discard The File Descriptor's Namespace
+*/
+#define PLATFORM_CONFIG_IOC_NS_DISCARD		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 34, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_JOURNAL_START
+    \brief IOCTL number to Start (or Stop) Journaling Changes
+*/
+#define PLATFORM_CONFIG_IOC_JOURNAL_START	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 35, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_JOURNAL_SAVE
+    \brief IOCTL number to Copy Out The Journal
+*/
+#define PLATFORM_CONFIG_IOC_JOURNAL_SAVE	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 36, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_JOURNAL_REPLAY
+    \brief IOCTL number to Replay a Saved Journal
+*/
+#define PLATFORM_CONFIG_IOC_JOURNAL_REPLAY	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 37, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_STAGE_PREPARE
+    \brief IOCTL number to Create a Tree to Build a Replacement In
+*/
+#define PLATFORM_CONFIG_IOC_STAGE_PREPARE	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 38, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_STAGE_PUBLISH
+    \brief IOCTL number to Swap a Prepared Tree In
+*/
+#define PLATFORM_CONFIG_IOC_STAGE_PUBLISH	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 39, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_NODE_MOVE
+    \brief IOCTL number to Move a Subtree to a New Parent or Name
+*/
+#define PLATFORM_CONFIG_IOC_NODE_MOVE		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 40, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_NODE_CHILD_COUNT
+    \brief IOCTL number to Count the Children of a Node
+*/
+#define PLATFORM_CONFIG_IOC_NODE_CHILD_COUNT	_IOR(PLATFORM_CONFIG_IOC_MAGIC, 41, struct plat_cfg_ioctl)
+
+/** \def PLATFORM_CONFIG_IOC_NODE_CHILD_AT
+    \brief IOCTL number to Get the Child at a Position
+*/
+#define PLATFORM_CONFIG_IOC_NODE_CHILD_AT		_IOR(PLATFORM_CONFIG_IOC_MAGIC, 42, struct plat_cfg_ioctl)
+
+/*
+ * Arguments of every ioctl.  data_ptr was appended for the ioctls from
+ * PLATFORM_CONFIG_IOC_INDEX_STATS on, whose numbers encode the size of the
+ * whole structure.  The original ones (1-14) still encode a char *, and
+ * for them the driver reads the structure only up to data_ptr, so callers
+ * built against the old, shorter layout keep working.
+ */
 struct plat_cfg_ioctl {
 	config_ref_t	base_ref;
 	const char *	const_name;
@@ -185,6 +328,7 @@ struct plat_cfg_ioctl {
 	const char *	config_data;
 	size_t 			bufsize;
 	config_ref_t *	node_ptr;
+	void *			data_ptr;
 };
 
 /*@)*/